@@ -0,0 +1,417 @@
+/**
+ * Standalone micro-benchmarks for the CPU side geometry and acceleration structure paths:
+ * loadObj, VoxelData construction, triangle/cell overlap tests (AABB::intersectsTri and SAT), incremental VoxelData updates and per-ray voxel grid traversal.
+ * Only the CPU side sources get compiled in (no window, no graphics device and no Vulkan or GLFW headers/libraries), so this builds and runs on headless machines just fine.
+ * Benchmark.vcxproj builds it on Windows; on Linux, it can be built from this directory with:
+ *	g++ -std=c++17 -O2 -I../Libraries/glm Benchmark.cpp __Test__/Objects/VoxelData.cpp __Test__/Objects/VoxelTraversal.cpp __Test__/Objects/RayTriangle.cpp __ThirdParty__/TinyObjLoader/tiny_obj_loader.cc -lpthread -o benchmark
+ * Usage (from this directory, since the bundled meshes are loaded from __InputGeometry__):
+ *	./benchmark [output file (benchmark.json by default)] [repetitions (3 by default)]
+ */
+#include "__Test__/Objects/VoxelTraversal.h"
+#include "__Test__/FileHelpers.h"
+#include "__Test__/CpuHelpers.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+
+namespace {
+	/**
+	 Benchmark progress goes here.
+	 @param text Message to log.
+	 */
+	static void log(const char* text) {
+		std::cout << "<LOG> " << text << std::endl;
+	}
+
+	/**
+	 * Timing of a repeated job (seconds).
+	 */
+	struct Timing {
+		float minTime;
+		float meanTime;
+	};
+
+	/**
+	 Runs a job several times and times each run.
+	 @param repetitions Number of runs.
+	 @param job Job to time.
+	 @return fastest and average run time.
+	 */
+	template<typename Job>
+	inline static Timing measure(uint32_t repetitions, const Job& job) {
+		Timing timing = { std::numeric_limits<float>::infinity(), 0.0f };
+		for (uint32_t i = 0; i < repetitions; i++) {
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			job();
+			const float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+			timing.minTime = std::min(timing.minTime, time);
+			timing.meanTime += (time / repetitions);
+		}
+		return timing;
+	}
+
+	/**
+	 * Benchmark scene (mesh with the same plane under it, main.cpp renders).
+	 */
+	struct Scene {
+		std::string name;
+		std::vector<Test::PNCVertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	/**
+	 Appends the plane from main.cpp to the geometry.
+	 @param scene Scene to append to.
+	 */
+	static void appendPlane(Scene& scene) {
+		const Test::PNCVertex PLANE_VERTS[] = {
+			{{-2.0f, -2.0f, -1.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f, 0.0f}},
+			{{-2.0f, 2.0f, -1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f, 0.0f}},
+			{{2.0f, -2.0f, -1.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 1.0f}},
+			{{2.0f, 2.0f, -1.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f}}
+		};
+		const uint32_t PLANE_INDICES[] = { 0, 2, 1, 2, 3, 1 };
+		const uint32_t baseIndex = static_cast<uint32_t>(scene.vertices.size());
+		for (size_t i = 0; i < 4; i++) scene.vertices.push_back(PLANE_VERTS[i]);
+		for (size_t i = 0; i < 6; i++) scene.indices.push_back(PLANE_INDICES[i] + baseIndex);
+	}
+
+	/**
+	 Generates a UV sphere with unit radius (same orientation as the bundled ones).
+	 @param numSegments Number of segments around Z axis.
+	 @param numRings Number of rings from pole to pole.
+	 @param scene Scene to append to.
+	 */
+	static void generateSphere(uint32_t numSegments, uint32_t numRings, Scene& scene) {
+		const float PI = 3.14159265358979f;
+		const uint32_t baseIndex = static_cast<uint32_t>(scene.vertices.size());
+		for (uint32_t ring = 0; ring <= numRings; ring++)
+			for (uint32_t segment = 0; segment <= numSegments; segment++) {
+				const float theta = (PI * ring / numRings);
+				const float phi = (2.0f * PI * segment / numSegments);
+				const glm::vec3 position(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+				scene.vertices.push_back({ position, position, { 1.0f, 1.0f, 1.0f } });
+			}
+		for (uint32_t ring = 0; ring < numRings; ring++)
+			for (uint32_t segment = 0; segment < numSegments; segment++) {
+				const uint32_t a = baseIndex + (ring * (numSegments + 1)) + segment;
+				const uint32_t b = (a + 1), c = (a + numSegments + 1), d = (c + 1);
+				const uint32_t QUAD[] = { a, c, b, b, c, d };
+				for (size_t i = 0; i < 6; i++) scene.indices.push_back(QUAD[i]);
+			}
+	}
+
+	/**
+	 Primary rays of the initial camera view from main.cpp.
+	 @param width Horizontal ray count.
+	 @param height Vertical ray count.
+	 @param eye Camera position (filled in).
+	 @param directions Ray directions (filled in).
+	 */
+	static void cameraRays(uint32_t width, uint32_t height, glm::vec3& eye, std::vector<glm::vec3>& directions) {
+		eye = glm::vec3(0.0f, -4.0f, 2.0f);
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), width / (float)height, 0.1f, 100.0f);
+		projection[1][1] *= -1;
+		const glm::mat4 inverseViewProjection = glm::inverse(projection * glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+		directions.clear();
+		for (uint32_t y = 0; y < height; y++)
+			for (uint32_t x = 0; x < width; x++) {
+				const glm::vec4 target = inverseViewProjection * glm::vec4(
+					(((x + 0.5f) / width) * 2.0f) - 1.0f, (((y + 0.5f) / height) * 2.0f) - 1.0f, 1.0f, 1.0f);
+				directions.push_back(glm::normalize((glm::vec3(target) / target.w) - eye));
+			}
+	}
+
+	/**
+	 Compares linked list voxel grids cell by cell (entry order depends on the update history, so only the sets of triangles per cell are compared).
+	 @param data Voxel data to check.
+	 @param reference Voxel data, it has to match.
+	 @return number of cells with different content or empty space distance.
+	 */
+	static size_t countVoxelMismatches(const Test::VoxelData& data, const Test::VoxelData& reference) {
+		if (data.voxels.size() != reference.voxels.size() || data.emptyDistances.size() != reference.emptyDistances.size())
+			return std::max(data.voxels.size(), reference.voxels.size());
+		const auto cellContent = [](const Test::VoxelData& grid, size_t voxelId) {
+			std::vector<uint32_t> triangles;
+			for (Test::VoxelData::VoxelEntryId entryId = grid.voxels[voxelId]; entryId != ~((Test::VoxelData::VoxelEntryId)0); entryId = grid.voxelEntries[entryId].next)
+				triangles.push_back(grid.voxelEntries[entryId].triangle);
+			std::sort(triangles.begin(), triangles.end());
+			return triangles;
+		};
+		size_t numMismatches = 0;
+		for (size_t voxelId = 0; voxelId < data.voxels.size(); voxelId++)
+			if (cellContent(data, voxelId) != cellContent(reference, voxelId) || data.emptyDistances[voxelId] != reference.emptyDistances[voxelId]) numMismatches++;
+		return numMismatches;
+	}
+
+	// JSON helpers (names are always plain identifiers/file names, so nothing gets escaped):
+	inline static std::string jsonString(const std::string& text) {
+		return ("\"" + text + "\"");
+	}
+
+	inline static std::string jsonDivisions(const glm::uvec3& divisions) {
+		std::stringstream stream;
+		stream << "[" << divisions.x << ", " << divisions.y << ", " << divisions.z << "]";
+		return stream.str();
+	}
+
+	inline static void writeSection(std::ostream& stream, const char* name, const std::vector<std::string>& records, bool last) {
+		stream << "\t\"" << name << "\": [";
+		for (size_t i = 0; i < records.size(); i++)
+			stream << ((i > 0) ? "," : "") << "\n\t\t{ " << records[i] << " }";
+		stream << (records.empty() ? "" : "\n\t") << "]" << (last ? "" : ",") << "\n";
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	typedef Test::VoxelData VoxelData;
+	const char* outputFile = (argc > 1) ? argv[1] : "benchmark.json";
+	const uint32_t repetitions = (argc > 2) ? std::max(std::atoi(argv[2]), 1) : 3u;
+
+	// Thread counts (powers of two up to the hardware thread count and the hardware thread count itself):
+	const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<uint32_t> threadCounts;
+	for (uint32_t count = 1; count < hardwareThreads; count *= 2) threadCounts.push_back(count);
+	threadCounts.push_back(hardwareThreads);
+
+	// Grid resolutions (zero means automatic, see VoxelData::autoDivisions()):
+	const glm::uvec3 RESOLUTIONS[] = { { 16, 16, 16 }, { 32, 32, 32 }, { 64, 64, 64 }, { 0, 0, 0 } };
+
+	std::vector<std::string> loadRecords, buildRecords, overlapRecords, updateRecords, traversalRecords;
+
+	// Set, if the implementations that have to agree with each other do not (results still get written, but the run fails):
+	bool crossCheckFailed = false;
+
+	// Scenes (bundled meshes get their loadObj timed on the way):
+	std::vector<Scene> scenes;
+	{
+		const char* BUNDLED_MESHES[] = { "lp-sphere.obj", "unit-sphere.obj" };
+		for (size_t i = 0; i < 2; i++) {
+			const std::string filename = (std::string("__InputGeometry__/") + BUNDLED_MESHES[i]);
+			Scene scene;
+			scene.name = BUNDLED_MESHES[i];
+			bool loaded = true;
+			const Timing timing = measure(repetitions, [&]() {
+				scene.vertices.clear();
+				scene.indices.clear();
+				loaded = Test::loadObj(filename.c_str(), scene.vertices, scene.indices, glm::vec3(1.0f, 1.0f, 1.0f), log);
+				});
+			if (!loaded) {
+				log(("[Error] Benchmark - Failed to load " + filename).c_str());
+				return 1;
+			}
+			std::stringstream stream;
+			stream << "\"mesh\": " << jsonString(scene.name) << ", \"vertices\": " << scene.vertices.size() << ", \"triangles\": " << (scene.indices.size() / 3)
+				<< ", \"minTime\": " << timing.minTime << ", \"meanTime\": " << timing.meanTime;
+			loadRecords.push_back(stream.str());
+			log(("loadObj - " + stream.str()).c_str());
+			appendPlane(scene);
+			scenes.push_back(scene);
+		}
+		const uint32_t GENERATED_SEGMENTS[] = { 64, 256 };
+		for (size_t i = 0; i < 2; i++) {
+			Scene scene;
+			std::stringstream name;
+			name << "generated-sphere-" << GENERATED_SEGMENTS[i] << "x" << (GENERATED_SEGMENTS[i] / 2);
+			scene.name = name.str();
+			generateSphere(GENERATED_SEGMENTS[i], GENERATED_SEGMENTS[i] / 2, scene);
+			appendPlane(scene);
+			scenes.push_back(scene);
+		}
+	}
+
+	glm::vec3 eye;
+	std::vector<glm::vec3> directions;
+	cameraRays(256, 144, eye, directions);
+
+	for (size_t sceneId = 0; sceneId < scenes.size(); sceneId++) {
+		const Scene& scene = scenes[sceneId];
+		const size_t numTriangles = (scene.indices.size() / 3);
+		// Brute force closest hits per ray (ground truth for the traversal; does not depend on the resolution, so it gets computed once per scene):
+		std::vector<char> groundTruthHits;
+		std::vector<float> groundTruthDistances;
+		for (size_t resolutionId = 0; resolutionId < (sizeof(RESOLUTIONS) / sizeof(RESOLUTIONS[0])); resolutionId++) {
+			const glm::uvec3 divisions = VoxelData::computeSettings(scene.vertices, scene.indices, RESOLUTIONS[resolutionId]).numDivisions;
+			const std::string prefix = ("\"mesh\": " + jsonString(scene.name) + ", \"divisions\": " + jsonDivisions(divisions));
+
+			// VoxelData construction:
+			for (size_t threadId = 0; threadId < threadCounts.size(); threadId++) {
+				size_t totalRefs = 0;
+				const Timing timing = measure(repetitions, [&]() {
+					const VoxelData data(scene.vertices, scene.indices, divisions, threadCounts[threadId]);
+					totalRefs = data.report.totalRefs;
+					});
+				std::stringstream stream;
+				stream << prefix << ", \"triangles\": " << numTriangles << ", \"threads\": " << threadCounts[threadId]
+					<< ", \"totalRefs\": " << totalRefs << ", \"minTime\": " << timing.minTime << ", \"meanTime\": " << timing.meanTime;
+				buildRecords.push_back(stream.str());
+				log(("VoxelData - " + stream.str()).c_str());
+			}
+
+			// Triangle/cell overlap tests on their own (clipping is the recursive AABB::intersectsTri; both have to find exactly the same cells):
+			{
+				const VoxelData::OverlapTest TESTS[] = { VoxelData::OVERLAP_CLIPPING, VoxelData::OVERLAP_SAT };
+				const char* TEST_NAMES[] = { "clipping", "sat" };
+				size_t numOverlaps[2] = { 0, 0 };
+				for (size_t testId = 0; testId < 2; testId++) {
+					VoxelData::OverlapBenchmark best = {};
+					for (uint32_t i = 0; i < repetitions; i++) {
+						const VoxelData::OverlapBenchmark result = VoxelData::benchmarkOverlapTests(scene.vertices, scene.indices, divisions, TESTS[testId]);
+						if (i == 0 || result.testTime < best.testTime) best = result;
+					}
+					std::stringstream stream;
+					stream << prefix << ", \"test\": " << jsonString(TEST_NAMES[testId]) << ", \"tests\": " << best.numTests
+						<< ", \"overlaps\": " << best.numOverlaps << ", \"nsPerTest\": " << best.testTime;
+					overlapRecords.push_back(stream.str());
+					log(("Overlap tests - " + stream.str()).c_str());
+					numOverlaps[testId] = best.numOverlaps;
+				}
+				if (numOverlaps[0] != numOverlaps[1]) {
+					log(("[Error] Benchmark - Overlap tests disagree (" + prefix + ")").c_str());
+					crossCheckFailed = true;
+				}
+			}
+
+			// Incremental updates (every 50th mesh vertex moves sideways, without touching the grid bounds; result has to match a fresh build of the moved geometry):
+			{
+				std::vector<Test::PNCVertex> movedVertices = scene.vertices;
+				std::vector<bool> moved(movedVertices.size(), false);
+				for (size_t i = 0; i < movedVertices.size(); i += 50)
+					if (std::abs(movedVertices[i].position.x) < 1.5f) {
+						movedVertices[i].position.x += 0.25f;
+						moved[i] = true;
+					}
+				std::vector<uint32_t> changedTriangles;
+				for (size_t i = 0; i < numTriangles; i++)
+					if (moved[scene.indices[i * 3]] || moved[scene.indices[(i * 3) + 1]] || moved[scene.indices[(i * 3) + 2]]) changedTriangles.push_back(static_cast<uint32_t>(i));
+
+				const VoxelData original(scene.vertices, scene.indices, divisions, hardwareThreads);
+				VoxelData updated = original;
+				Timing updateTiming = { std::numeric_limits<float>::infinity(), 0.0f };
+				bool applied = true;
+				for (uint32_t i = 0; i < repetitions; i++) {
+					updated = original;
+					const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					applied &= updated.update(movedVertices, scene.indices, changedTriangles);
+					const float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+					updateTiming.minTime = std::min(updateTiming.minTime, time);
+					updateTiming.meanTime += (time / repetitions);
+				}
+				const Timing rebuildTiming = measure(repetitions, [&]() { const VoxelData rebuilt(movedVertices, scene.indices, divisions, hardwareThreads); });
+				const VoxelData rebuilt(movedVertices, scene.indices, divisions, hardwareThreads);
+				size_t numMismatches = (applied ? countVoxelMismatches(updated, rebuilt) : updated.voxels.size());
+				if (rebuilt.settings.gridStart != original.settings.gridStart || rebuilt.settings.gridEnd != original.settings.gridEnd) numMismatches++;
+
+				// Rejected updates (unknown triangle and not enough entry capacity) must leave the data as it was:
+				{
+					VoxelData rejected = original;
+					std::vector<uint32_t> unknownTriangle = changedTriangles;
+					unknownTriangle.push_back(static_cast<uint32_t>(numTriangles));
+					if (rejected.update(movedVertices, scene.indices, unknownTriangle) || countVoxelMismatches(rejected, original) > 0) numMismatches++;
+					if (updated.voxelEntries.size() > original.voxelEntries.size()) {
+						rejected = original;
+						if (rejected.update(movedVertices, scene.indices, changedTriangles, nullptr, VoxelData::OVERLAP_CLIPPING, original.voxelEntries.size())
+							|| countVoxelMismatches(rejected, original) > 0 || rejected.voxelEntries.size() != original.voxelEntries.size()) numMismatches++;
+					}
+				}
+				std::stringstream stream;
+				stream << prefix << ", \"changedTriangles\": " << changedTriangles.size() << ", \"updateTime\": " << updateTiming.minTime
+					<< ", \"rebuildTime\": " << rebuildTiming.minTime << ", \"mismatches\": " << numMismatches;
+				updateRecords.push_back(stream.str());
+				log(("Update - " + stream.str()).c_str());
+				if (numMismatches > 0) {
+					log(("[Error] Benchmark - Updated voxel grid does not match the rebuilt one (" + prefix + ")").c_str());
+					crossCheckFailed = true;
+				}
+			}
+
+			// Per-ray traversal (closest hit of the primary rays; rays are split evenly between the threads):
+			{
+				const VoxelData data(scene.vertices, scene.indices, divisions, hardwareThreads);
+				const Test::VoxelTraversal traversal(data, scene.vertices, scene.indices);
+				const Test::VoxelTraversal::Mode MODES[] = { Test::VoxelTraversal::MODE_CELL_STEPPING, Test::VoxelTraversal::MODE_INTEGER_DDA };
+				const char* MODE_NAMES[] = { "cellStepping", "integerDDA" };
+				if (groundTruthHits.empty()) {
+					groundTruthHits.resize(directions.size());
+					groundTruthDistances.resize(directions.size());
+					Test::runOnThreads(hardwareThreads, [&](size_t thread) {
+						for (size_t i = thread; i < directions.size(); i += hardwareThreads) {
+							Test::VoxelTraversal::Hit hit = {};
+							groundTruthHits[i] = traversal.raycastBruteForce(eye, directions[i], hit);
+							groundTruthDistances[i] = hit.distance;
+						}
+						});
+				}
+				for (size_t mode = 0; mode < 2; mode++) {
+					// Mismatches with brute force (untimed; same criteria as logTraversalAccuracy() in main.cpp):
+					size_t numMismatches = 0;
+					for (size_t i = 0; i < directions.size(); i++) {
+						Test::VoxelTraversal::Hit hit = {};
+						const bool wasHit = traversal.raycast(eye, directions[i], MODES[mode], hit);
+						if (wasHit != (groundTruthHits[i] != 0) || (wasHit && std::abs(hit.distance - groundTruthDistances[i]) > 0.0001f)) numMismatches++;
+					}
+					if (numMismatches > 0) {
+						log(("[Error] Benchmark - Traversal does not match brute force (" + prefix + ", mode: " + MODE_NAMES[mode] + ")").c_str());
+						crossCheckFailed = true;
+					}
+					for (size_t threadId = 0; threadId < threadCounts.size(); threadId++) {
+						const size_t numThreads = threadCounts[threadId];
+						std::vector<size_t> hits(numThreads, 0);
+						const Timing timing = measure(repetitions, [&]() {
+							Test::runOnThreads(numThreads, [&](size_t thread) {
+								const size_t first = ((directions.size() * thread) / numThreads);
+								const size_t last = ((directions.size() * (thread + 1)) / numThreads);
+								size_t numHits = 0;
+								Test::VoxelTraversal::Hit hit;
+								for (size_t i = first; i < last; i++)
+									if (traversal.raycast(eye, directions[i], MODES[mode], hit)) numHits++;
+								hits[thread] = numHits;
+								});
+							});
+						size_t numHits = 0;
+						for (size_t i = 0; i < hits.size(); i++) numHits += hits[i];
+						std::stringstream stream;
+						stream << prefix << ", \"mode\": " << jsonString(MODE_NAMES[mode]) << ", \"threads\": " << numThreads
+							<< ", \"rays\": " << directions.size() << ", \"hits\": " << numHits
+							<< ", \"minTime\": " << timing.minTime << ", \"meanTime\": " << timing.meanTime
+							<< ", \"nsPerRay\": " << ((timing.minTime * 1000000000.0f) / directions.size())
+							<< ", \"megaRaysPerSecond\": " << ((timing.minTime > 0.0f) ? (directions.size() / timing.minTime / 1000000.0f) : 0.0f)
+							<< ", \"mismatches\": " << numMismatches;
+						traversalRecords.push_back(stream.str());
+						log(("Traversal - " + stream.str()).c_str());
+					}
+				}
+			}
+		}
+	}
+
+	// Results (times are in seconds):
+	std::ofstream file(outputFile);
+	if (!file.is_open()) {
+		log((std::string("[Error] Benchmark - Failed to open ") + outputFile).c_str());
+		return 2;
+	}
+	file << "{\n\t\"hardwareThreads\": " << hardwareThreads << ",\n\t\"repetitions\": " << repetitions << ",\n";
+	writeSection(file, "loadObj", loadRecords, false);
+	writeSection(file, "voxelBuild", buildRecords, false);
+	writeSection(file, "overlapTests", overlapRecords, false);
+	writeSection(file, "updates", updateRecords, false);
+	writeSection(file, "traversal", traversalRecords, true);
+	file << "}\n";
+	if (!file.good()) {
+		log((std::string("[Error] Benchmark - Failed to write ") + outputFile).c_str());
+		return 2;
+	}
+	log((std::string("Benchmark - results written to ") + outputFile).c_str());
+	if (crossCheckFailed) {
+		log("[Error] Benchmark - Cross-checks failed (see the errors above)");
+		return 3;
+	}
+	return 0;
+}
@@ -31,7 +31,7 @@ namespace Test {
 	SwapChain::SwapChain(const std::shared_ptr<GraphicsDevice>& device, void(*logFn)(const char*))
 		: m_device(device)
 		, m_swapChain(VK_NULL_HANDLE), m_renderPass(VK_NULL_HANDLE)
-		, m_pixelFormat{}, m_size{}
+		, m_pixelFormat{}, m_imageUsage(0), m_size{}
 		, m_imageAvailable(VK_NULL_HANDLE), m_renderFinished(VK_NULL_HANDLE)
 		, m_initialized(false), m_logFn(logFn) {
 		if (m_device->initialized()) {
@@ -99,6 +99,14 @@ namespace Test {
 		return m_frameBuffers[index];
 	}
 
+	VkImage SwapChain::image(size_t index)const {
+		return m_images[index];
+	}
+
+	VkImageUsageFlags SwapChain::imageUsage()const {
+		return m_imageUsage;
+	}
+
 	Image& SwapChain::depthBuffer() {
 		return *m_depthBuffer;
 	}
@@ -174,7 +182,8 @@ namespace Test {
 			createInfo.imageColorSpace = m_pixelFormat.colorSpace;
 			createInfo.imageExtent = m_size = pickResolution(info, m_device->window());
 			createInfo.imageArrayLayers = 1;
-			createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			m_imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (info.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+			createInfo.imageUsage = m_imageUsage;
 
 			if (queueFamilyIndices[0] != queueFamilyIndices[1]) {
 				createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
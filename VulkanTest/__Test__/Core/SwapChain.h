@@ -84,6 +84,19 @@ namespace Test {
 		*/
 		VkFramebuffer frameBuffer(size_t index)const;
 
+		/**
+		Gives access to swap chain image by index (for the renderers that copy to it instead of drawing through frameBuffer()).
+		@param index Image index.
+		@return swap chain image.
+		*/
+		VkImage image(size_t index)const;
+
+		/**
+		Usage flags, the swap chain images were created with (transfer destination is only there, if the surface supports it).
+		@return image usage.
+		*/
+		VkImageUsageFlags imageUsage()const;
+
 		/**
 		Depth buffer.
 		@return image for depth attachment.
@@ -151,6 +164,8 @@ namespace Test {
 
 		VkSurfaceFormatKHR m_pixelFormat;
 
+		VkImageUsageFlags m_imageUsage;
+
 		VkExtent2D m_size;
 
 		std::unique_ptr<Image> m_depthBuffer;
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * Here we have a few inline helpers for splitting CPU work between threads and hashing data (no graphics API involved, so the CPU side tools can use these without Vulkan).
+ */
+namespace Test {
+	/**
+	Runs a job on several threads and waits for all of them to finish.
+	@param numThreads Number of threads to run (0 and 1 both mean "run on the calling thread").
+	@param job Job to execute (receives the thread index as the only argument).
+	*/
+	template<typename Job>
+	inline static void runOnThreads(size_t numThreads, const Job& job) {
+		if (numThreads <= 1) {
+			job(0);
+			return;
+		}
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < numThreads; i++)
+			threads.push_back(std::thread(job, i));
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+	}
+
+	// 64 bit FNV-1a:
+	static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+	static const uint64_t FNV_PRIME = 1099511628211ull;
+
+	/**
+	Mixes bytes into a 64 bit FNV-1a hash.
+	@param hash Hash to update (start with FNV_OFFSET_BASIS).
+	@param data Bytes to hash.
+	@param size Number of bytes.
+	*/
+	inline static void hashBytes(uint64_t& hash, const void* data, size_t size) {
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+	}
+}
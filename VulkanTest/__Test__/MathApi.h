@@ -0,0 +1,10 @@
+/**
+ * Math library include statements (kept apart from Api.h, so that the CPU side code builds without GLFW and Vulkan)...
+ */
+
+#pragma once
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
@@ -0,0 +1,179 @@
+#include "BVH.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+	typedef Test::BVH::BVHData::Node Node;
+
+	struct Bounds {
+		glm::vec3 start;
+		glm::vec3 end;
+
+		inline Bounds()
+			: start(std::numeric_limits<float>::infinity()), end(-std::numeric_limits<float>::infinity()) {}
+
+		inline void include(const glm::vec3& point) {
+			start = glm::min(start, point);
+			end = glm::max(end, point);
+		}
+
+		inline void include(const Bounds& bounds) {
+			start = glm::min(start, bounds.start);
+			end = glm::max(end, bounds.end);
+		}
+
+		inline float surfaceArea()const {
+			if (start.x > end.x || start.y > end.y || start.z > end.z) return 0.0f;
+			const glm::vec3 size = (end - start);
+			return (2.0f * ((size.x * size.y) + (size.y * size.z) + (size.z * size.x)));
+		}
+	};
+
+	struct BuildTask {
+		// First triangle within the sorted triangle list.
+		uint32_t begin;
+
+		// End of the triangle range within the sorted triangle list.
+		uint32_t end;
+
+		// Parent node, waiting for it's right child index (NO_PARENT for the root and left children).
+		uint32_t parent;
+	};
+
+#define NO_PARENT (~((uint32_t)0))
+
+	// Leaves get force-split above this size, even if SAH thinks one big leaf would be cheaper:
+	static const uint32_t MAX_LEAF_SIZE = 64;
+
+	// Cost of visiting a node, relative to the cost of a single triangle intersection:
+	static const float TRAVERSAL_COST = 1.0f;
+}
+
+namespace Test {
+	BVH::BVHData::BVHData(const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, uint32_t maxLeafSize, uint32_t numBins) {
+		const uint32_t numTriangles = static_cast<uint32_t>(indexBuffer.size() / 3);
+		if (numBins < 2) numBins = 2;
+		if (maxLeafSize < 1) maxLeafSize = 1;
+
+		// Triangle bounds and centroids:
+		std::vector<Bounds> triangleBounds(numTriangles);
+		std::vector<glm::vec3> centroids(numTriangles);
+		std::vector<uint32_t> triangles(numTriangles);
+		for (uint32_t i = 0; i < numTriangles; i++) {
+			Bounds& bounds = triangleBounds[i];
+			bounds.include(verts[indexBuffer[(i * 3)]].position);
+			bounds.include(verts[indexBuffer[(i * 3) + 1]].position);
+			bounds.include(verts[indexBuffer[(i * 3) + 2]].position);
+			centroids[i] = ((bounds.start + bounds.end) * 0.5f);
+			triangles[i] = i;
+		}
+
+		// Nodes are created in depth-first order (left subtree gets processed before the right one, so the left child is always right after the parent):
+		std::vector<BuildTask> tasks;
+		tasks.push_back(BuildTask{ 0, numTriangles, NO_PARENT });
+		std::vector<uint32_t> binCounts(numBins);
+		std::vector<Bounds> binBounds(numBins);
+		std::vector<float> rightCosts(numBins);
+		while (!tasks.empty()) {
+			const BuildTask task = tasks.back();
+			tasks.pop_back();
+
+			const uint32_t nodeId = static_cast<uint32_t>(nodes.size());
+			if (task.parent != NO_PARENT) nodes[task.parent].firstChildOrRef = nodeId;
+
+			Bounds bounds, centroidBounds;
+			for (uint32_t i = task.begin; i < task.end; i++) {
+				bounds.include(triangleBounds[triangles[i]]);
+				centroidBounds.include(centroids[triangles[i]]);
+			}
+			{
+				Node node;
+				node.boundsStart = bounds.start;
+				node.boundsEnd = bounds.end;
+				node.firstChildOrRef = 0;
+				node.numRefs = 0;
+				nodes.push_back(node);
+			}
+
+			// Looking for the cheapest split:
+			const uint32_t count = (task.end - task.begin);
+			uint32_t bestAxis = 0;
+			uint32_t bestSplit = 0;
+			float bestCost = std::numeric_limits<float>::infinity();
+			if (count > maxLeafSize) {
+				const float nodeArea = bounds.surfaceArea();
+				for (uint32_t axis = 0; axis < 3; axis++) {
+					const float axisStart = centroidBounds.start[axis];
+					const float axisSize = (centroidBounds.end[axis] - axisStart);
+					if (axisSize <= 0.0f) continue;
+					const float binScale = (static_cast<float>(numBins) / axisSize);
+
+					std::fill(binCounts.begin(), binCounts.end(), 0);
+					std::fill(binBounds.begin(), binBounds.end(), Bounds());
+					for (uint32_t i = task.begin; i < task.end; i++) {
+						const uint32_t triangle = triangles[i];
+						const uint32_t bin = std::min(static_cast<uint32_t>((centroids[triangle][axis] - axisStart) * binScale), numBins - 1);
+						binCounts[bin]++;
+						binBounds[bin].include(triangleBounds[triangle]);
+					}
+
+					// Sweeping from the right to get costs of the right sides, than from the left to evaluate splits:
+					{
+						Bounds right;
+						uint32_t rightCount = 0;
+						for (uint32_t bin = numBins - 1; bin > 0; bin--) {
+							right.include(binBounds[bin]);
+							rightCount += binCounts[bin];
+							rightCosts[bin] = (right.surfaceArea() * rightCount);
+						}
+					}
+					{
+						Bounds left;
+						uint32_t leftCount = 0;
+						for (uint32_t split = 1; split < numBins; split++) {
+							left.include(binBounds[split - 1]);
+							leftCount += binCounts[split - 1];
+							if (leftCount <= 0 || leftCount >= count) continue;
+							const float cost = TRAVERSAL_COST + (((left.surfaceArea() * leftCount) + rightCosts[split]) / nodeArea);
+							if (cost < bestCost) {
+								bestCost = cost;
+								bestAxis = axis;
+								bestSplit = split;
+							}
+						}
+					}
+				}
+			}
+
+			// Leaf:
+			if (bestSplit == 0 || (bestCost >= static_cast<float>(count) && count <= MAX_LEAF_SIZE)) {
+				Node& node = nodes[nodeId];
+				node.firstChildOrRef = static_cast<uint32_t>(triangleRefs.size());
+				node.numRefs = count;
+				for (uint32_t i = task.begin; i < task.end; i++)
+					triangleRefs.push_back(triangles[i] * 3);
+				continue;
+			}
+
+			// Interior node:
+			const float axisStart = centroidBounds.start[bestAxis];
+			const float binScale = (static_cast<float>(numBins) / (centroidBounds.end[bestAxis] - axisStart));
+			const uint32_t middle = static_cast<uint32_t>(std::partition(triangles.begin() + task.begin, triangles.begin() + task.end, [&](uint32_t triangle) {
+				return std::min(static_cast<uint32_t>((centroids[triangle][bestAxis] - axisStart) * binScale), numBins - 1) < bestSplit;
+				}) - triangles.begin());
+			tasks.push_back(BuildTask{ middle, task.end, nodeId });
+			tasks.push_back(BuildTask{ task.begin, middle, NO_PARENT });
+		}
+	}
+
+	BVH::BVH(const std::shared_ptr<GraphicsDevice>& device, const BVHData& data, void(*logFn)(const char*))
+		: nodes(device, static_cast<uint32_t>(data.nodes.size()), data.nodes.data(), logFn)
+		, triangleRefs(device, std::max(static_cast<uint32_t>(data.triangleRefs.size()), 1u), data.triangleRefs.empty() ? nullptr : data.triangleRefs.data(), logFn) { }
+
+	BVH::BVH(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, uint32_t maxLeafSize, void(*logFn)(const char*))
+		: BVH(device, BVHData(verts, indexBuffer, maxLeafSize), logFn) { }
+
+	bool BVH::initialized()const {
+		return (nodes.buffer() != VK_NULL_HANDLE && triangleRefs.buffer() != VK_NULL_HANDLE);
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "Buffers.h"
+#include "Inputs.h"
+
+namespace Test {
+	/**
+	 * Bounding volume hierarchy for arbitrary geometry, built with binned surface area heuristic.
+	 * This is an alternative to VoxelGrid, that does not care much about how unevenly the triangles are spread across the scene.
+	 */
+	struct BVH {
+		/**
+		 * CPU "Clone" of the BVH, containing nodes and triangle references.
+		 */
+		struct BVHData {
+			/**
+			 * Flattened BVH node (32 bytes, so that it's the same on CPU and GPU without any extra padding).
+			 * Nodes are stored in depth-first order, so left child of an interior node always comes right after it's parent.
+			 */
+			struct Node {
+				// Lower left nearest corner of the node bounds.
+				alignas(16) glm::vec3 boundsStart;
+
+				// Index of the right child for interior nodes, or index of the first triangle reference for leaves.
+				uint32_t firstChildOrRef;
+
+				// Upper right furthest corner of the node bounds.
+				alignas(16) glm::vec3 boundsEnd;
+
+				// Number of triangle references for leaves (0 for interior nodes).
+				uint32_t numRefs;
+			};
+
+			// Flattened nodes (first one is the root).
+			std::vector<Node> nodes;
+
+			// Triangle references (index buffer offsets of the first vertex index), grouped per leaf.
+			std::vector<uint32_t> triangleRefs;
+
+			/**
+			Builds BVH.
+			Note: Every split is chosen by evaluating surface area heuristic on a fixed number of centroid bins along each axis;
+				Node gets turned into a leaf if it has few enough triangles, or if no split is cheaper than just intersecting all of them.
+			@param verts Mesh vertices.
+			@param indexBuffer Mesh indices.
+			@param maxLeafSize Leaves with up to this many triangles are not split any further.
+			@param numBins Number of SAH bins to evaluate per split.
+			*/
+			BVHData(const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, uint32_t maxLeafSize = 4, uint32_t numBins = 16);
+		};
+
+
+
+
+
+		/**
+		Uploads existing BVH data to GPU.
+		@param device Logical device to upload to.
+		@param data Baked BVH data.
+		@param logFn One function that will help us if anything goes wrong.
+		*/
+		BVH(const std::shared_ptr<GraphicsDevice>& device, const BVHData& data, void(*logFn)(const char*) = nullptr);
+
+		/**
+		Builds BVH data and uploads it to GPU.
+		@param device Logical device to upload to.
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param maxLeafSize Leaves with up to this many triangles are not split any further.
+		@param logFn One function that will help us if anything goes wrong.
+		*/
+		BVH(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer,
+			uint32_t maxLeafSize = 4, void(*logFn)(const char*) = nullptr);
+
+		/**
+		Tells if anything went wronf during initialisation.
+		@return true, if all buffers are allocated.
+		*/
+		bool initialized()const;
+
+
+
+		// Flattened nodes (same as BVHData).
+		const Buffer<BVHData::Node, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> nodes;
+
+		// Triangle references (same as BVHData).
+		const Buffer<uint32_t, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> triangleRefs;
+	};
+}
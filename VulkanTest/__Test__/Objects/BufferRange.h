@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+namespace Test {
+	/**
+	 * Range of elements within a buffer (kept apart from Buffers.h, so that the CPU side code can report ranges without pulling in the graphics API).
+	 */
+	struct BufferRange {
+		// Index of the first element.
+		uint32_t first;
+
+		// Number of elements.
+		uint32_t count;
+	};
+}
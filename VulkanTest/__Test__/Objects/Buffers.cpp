@@ -66,7 +66,7 @@ namespace {
 		return true;
 	}
 
-	inline static VkCommandBuffer createCopyOperation(Test::GraphicsDevice& device, VkDeviceSize size, VkBuffer src, VkBuffer dst) {
+	inline static VkCommandBuffer createCopyOperation(Test::GraphicsDevice& device, VkBuffer src, VkBuffer dst, const VkBufferCopy* regions, uint32_t numRegions, VkCommandBufferUsageFlags flags) {
 		VkCommandBufferAllocateInfo allocInfo = {};
 		{
 			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -79,19 +79,24 @@ namespace {
 		{
 			VkCommandBufferBeginInfo begin = {};
 			begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-			begin.flags = 0;
+			begin.flags = flags;
 			vkBeginCommandBuffer(commandBuffer, &begin);
 		}
-		{
-			VkBufferCopy copy = {};
-			copy.srcOffset = 0;
-			copy.dstOffset = 0;
-			copy.size = size;
-			vkCmdCopyBuffer(commandBuffer, src, dst, 1, &copy);
-		}
+		vkCmdCopyBuffer(commandBuffer, src, dst, numRegions, regions);
 		vkEndCommandBuffer(commandBuffer);
 		return commandBuffer;
 	}
+
+	inline static void submitAndWait(Test::GraphicsDevice& device, VkCommandBuffer commandBuffer) {
+		VkSubmitInfo info = {};
+		{
+			info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			info.commandBufferCount = 1;
+			info.pCommandBuffers = &commandBuffer;
+		}
+		vkQueueSubmit(device.graphicsQueue(), 1, &info, VK_NULL_HANDLE);
+		vkQueueWaitIdle(device.graphicsQueue());
+	}
 }
 
 
@@ -149,13 +154,19 @@ namespace Test {
 	}
 
 	BaseBuffer::BaseBuffer(const std::shared_ptr<GraphicsDevice>& device, VkBufferUsageFlags usage, uint32_t size, const void* data, void(*logFn)(const char*))
-		: BaseStagingBuffer(device, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size, data, logFn)
+		: BaseStagingBuffer(device, (VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT), size, data, logFn)
 		, m_buffer(VK_NULL_HANDLE), m_bufferMemory(VK_NULL_HANDLE)
 		, m_commandBuffer(VK_NULL_HANDLE) {
 		if (createBuffer(graphicsDevice(), size,
-			(VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			(VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | usage), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 			m_buffer, m_bufferMemory, logFn)) {
-			m_commandBuffer = createCopyOperation(graphicsDevice(), size, stagingBuffer(), m_buffer);
+			VkBufferCopy copy = {};
+			{
+				copy.srcOffset = 0;
+				copy.dstOffset = 0;
+				copy.size = size;
+			}
+			m_commandBuffer = createCopyOperation(graphicsDevice(), stagingBuffer(), m_buffer, &copy, 1, 0);
 			if (data != nullptr)
 				setData(data);
 		}
@@ -189,14 +200,7 @@ namespace Test {
 
 	void BaseBuffer::unmapData() {
 		unmapStagingBuffer();
-		VkSubmitInfo info = {};
-		{
-			info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-			info.commandBufferCount = 1;
-			info.pCommandBuffers = &m_commandBuffer;
-		}
-		vkQueueSubmit(graphicsDevice().graphicsQueue(), 1, &info, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsDevice().graphicsQueue());
+		submitAndWait(graphicsDevice(), m_commandBuffer);
 	}
 
 	void BaseBuffer::setData(const void* data) {
@@ -205,6 +209,65 @@ namespace Test {
 		unmapData();
 	}
 
+	void BaseBuffer::setData(const void* data, const VkBufferCopy* regions, uint32_t numRegions) {
+		if (numRegions <= 0) return;
+		else if (m_buffer == VK_NULL_HANDLE) return;
+		{
+			char* mappedData = (char*)mapData();
+			for (uint32_t i = 0; i < numRegions; i++)
+				memcpy(mappedData + regions[i].srcOffset, ((const char*)data) + regions[i].srcOffset, regions[i].size);
+			unmapStagingBuffer();
+		}
+		// Source offsets refer to both, data and the staging buffer (the command buffer is recorded each time, since regions differ between calls):
+		VkCommandBuffer commandBuffer = createCopyOperation(graphicsDevice(), stagingBuffer(), m_buffer, regions, numRegions, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		submitAndWait(graphicsDevice(), commandBuffer);
+		vkFreeCommandBuffers(graphicsDevice().logicalDevice(), graphicsDevice().commandPool(), 1, &commandBuffer);
+	}
+
+	void BaseBuffer::getData(void* data) {
+		if (m_buffer == VK_NULL_HANDLE) return;
+		VkCommandBufferAllocateInfo allocInfo = {};
+		{
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = graphicsDevice().commandPool();
+			allocInfo.commandBufferCount = 1;
+		}
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(graphicsDevice().logicalDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) return;
+		{
+			VkCommandBufferBeginInfo begin = {};
+			begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(commandBuffer, &begin);
+		}
+		// Writes from the earlier submissions (compute passes included) have to be visible to the copy and the copy has to be visible to the host:
+		VkMemoryBarrier barrier = {};
+		{
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		VkBufferCopy copy = {};
+		{
+			copy.srcOffset = 0;
+			copy.dstOffset = 0;
+			copy.size = numBytes();
+		}
+		vkCmdCopyBuffer(commandBuffer, m_buffer, stagingBuffer(), 1, &copy);
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		vkEndCommandBuffer(commandBuffer);
+		submitAndWait(graphicsDevice(), commandBuffer);
+		vkFreeCommandBuffers(graphicsDevice().logicalDevice(), graphicsDevice().commandPool(), 1, &commandBuffer);
+
+		// (staging buffer now mirrors the device memory, so a later mapData()/unmapData() pair does not revert anything)
+		memcpy(data, mapStagingBuffer(), numBytes());
+		unmapStagingBuffer();
+	}
+
 	VkBuffer BaseBuffer::buffer()const {
 		return m_buffer;
 	}
@@ -306,6 +369,10 @@ namespace Test {
 		return m_view;
 	}
 
+	VkImage Image::image()const {
+		return m_image;
+	}
+
 
 
 	void Image::log(const char* message)const { 
@@ -1,5 +1,6 @@
 #pragma once
 #include "../Core/GraphicsDevice.h"
+#include "BufferRange.h"
 
 /** 
 Note for all buffers:
@@ -95,9 +96,15 @@ namespace Test {
 		// Sets content of the entire buffer memory.
 		void setData(const void* data);
 
+		// Updates given regions of the buffer memory (srcOffset is an offset within data, dstOffset is an offset within the buffer).
+		void setData(const void* data, const VkBufferCopy* regions, uint32_t numRegions);
+
 		// Unmaps buffer data and updates the memory.
 		void unmapData();
 
+		// Copies content of the entire buffer memory back to data (waits for the device; meant for validation, not for per-frame use).
+		void getData(void* data);
+
 
 	private:
 		VkBuffer m_buffer;
@@ -158,6 +165,26 @@ namespace Test {
 		@param content Content to set (should point to an array which has no less elements than the buffer).
 		*/
 		inline void setContent(const ElemType* content) { setData(content); }
+
+		/**
+		Updates given element ranges of the buffer, leaving the rest of it intact.
+		@param content Content to take the ranges from (should point to an array which has no less elements than the buffer; ranges are read from the same positions they get written to).
+		@param ranges Element ranges to update (should be within the buffer).
+		*/
+		inline void setContent(const ElemType* content, const std::vector<BufferRange>& ranges) {
+			std::vector<VkBufferCopy> regions(ranges.size());
+			for (size_t i = 0; i < ranges.size(); i++) {
+				regions[i].srcOffset = regions[i].dstOffset = (static_cast<VkDeviceSize>(ranges[i].first) * sizeof(ElemType));
+				regions[i].size = (static_cast<VkDeviceSize>(ranges[i].count) * sizeof(ElemType));
+			}
+			setData(content, regions.data(), static_cast<uint32_t>(regions.size()));
+		}
+
+		/**
+		Reads back the content of the entire buffer (slow; waits for everything, submitted before, to finish).
+		@param content Array to store the content in (should have no less elements than the buffer).
+		*/
+		inline void getContent(ElemType* content) { getData(content); }
 	};
 
 
@@ -297,6 +324,12 @@ namespace Test {
 		*/
 		VkImageView view()const;
 
+		/**
+		Underlying image handle (for layout transitions and copies).
+		@return image.
+		*/
+		VkImage image()const;
+
 
 	private:
 		const std::shared_ptr<GraphicsDevice>& m_device;
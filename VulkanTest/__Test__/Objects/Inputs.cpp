@@ -1,4 +1,5 @@
 #include "Inputs.h"
+#include "../Api.h"
 
 namespace {
 	inline static VkVertexInputBindingDescription VertexBindingDescription() {
@@ -1,7 +1,11 @@
 #pragma once
-#include "../Api.h"
+#include "../MathApi.h"
 #include <vector>
 
+// Vulkan vertex input descriptions are only referenced here (Inputs.cpp fills them in), so the CPU side code can use the vertex types without the Vulkan headers:
+struct VkVertexInputBindingDescription;
+struct VkVertexInputAttributeDescription;
+
 namespace Test {
 	/**
 	 * Vertex, containing position, normal and vertex color information.
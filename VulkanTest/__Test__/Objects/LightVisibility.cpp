@@ -0,0 +1,275 @@
+#include "LightVisibility.h"
+#include "RayTriangle.h"
+#include "../CpuHelpers.h"
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+namespace {
+	typedef Test::LightVisibility::CellOccluders CellOccluders;
+
+	/**
+	 * Convex hull of the light and a cell box (the volume, every shadow ray towards the cell passes through),
+	 * described by it's bounding box and the planes, that bound it (face planes of the box that do not face the light,
+	 * as well as the planes through the light and the silhouette edges of the box).
+	 */
+	struct Shaft {
+		// Bounding box of the shaft.
+		glm::vec3 start, end;
+
+		// Plane normals (xyz, pointing outwards) and offsets (w); points with dot(normal, point) > offset + tolerance are outside.
+		glm::vec4 planes[18];
+
+		// Number of planes, found for the shaft.
+		size_t numPlanes;
+
+		// Distance, the points have to be outside a plane by, to be considered outside.
+		float tolerance;
+	};
+
+	/**
+	Builds shaft between the light and a box.
+	@param light Light position.
+	@param boxStart Lower left nearest corner of the box.
+	@param boxEnd Upper right furthest corner of the box.
+	@return shaft.
+	*/
+	inline static Shaft makeShaft(const glm::vec3& light, const glm::vec3& boxStart, const glm::vec3& boxEnd) {
+		Shaft shaft;
+		shaft.start = glm::min(boxStart, light);
+		shaft.end = glm::max(boxEnd, light);
+		shaft.numPlanes = 0;
+		const glm::vec3 magnitude = glm::max(glm::abs(shaft.start), glm::abs(shaft.end));
+		shaft.tolerance = (std::max(std::max(magnitude.x, magnitude.y), magnitude.z) * 0.00001f);
+
+		// Box faces, the light is not in front of:
+		for (glm::length_t axis = 0; axis < 3; axis++) {
+			if (light[axis] >= boxStart[axis]) {
+				glm::vec4 plane(0.0f);
+				plane[axis] = -1.0f;
+				plane.w = -boxStart[axis];
+				shaft.planes[shaft.numPlanes++] = plane;
+			}
+			if (light[axis] <= boxEnd[axis]) {
+				glm::vec4 plane(0.0f);
+				plane[axis] = 1.0f;
+				plane.w = boxEnd[axis];
+				shaft.planes[shaft.numPlanes++] = plane;
+			}
+		}
+
+		// Planes through the light and the box edges, that have the entire box on one side (silhouette edges):
+		glm::vec3 corners[8];
+		for (size_t i = 0; i < 8; i++)
+			corners[i] = glm::vec3(((i & 1) != 0) ? boxEnd.x : boxStart.x, ((i & 2) != 0) ? boxEnd.y : boxStart.y, ((i & 4) != 0) ? boxEnd.z : boxStart.z);
+		for (size_t i = 0; i < 8; i++)
+			for (size_t bit = 1; bit < 8; bit <<= 1) {
+				if ((i & bit) != 0) continue;
+				const glm::vec3& a = corners[i];
+				const glm::vec3& b = corners[i | bit];
+				glm::vec3 normal = glm::cross(b - a, light - a);
+				const float normalLength = glm::length(normal);
+				if (!(normalLength > 0.0f)) continue;
+				normal /= normalLength;
+				const float offset = glm::dot(normal, a);
+				float minDelta = 0.0f, maxDelta = 0.0f;
+				for (size_t j = 0; j < 8; j++) {
+					const float delta = (glm::dot(normal, corners[j]) - offset);
+					minDelta = std::min(minDelta, delta);
+					maxDelta = std::max(maxDelta, delta);
+				}
+				if (maxDelta <= shaft.tolerance) shaft.planes[shaft.numPlanes++] = glm::vec4(normal, offset);
+				else if (minDelta >= -shaft.tolerance) shaft.planes[shaft.numPlanes++] = glm::vec4(-normal, -offset);
+			}
+		return shaft;
+	}
+
+	/**
+	Tells, if the triangle is guaranteed to be outside the shaft (false negatives are fine, false positives are not).
+	@param shaft Shaft.
+	@param a First vertex.
+	@param b Second vertex.
+	@param c Third vertex.
+	@param start Lower left nearest corner of the triangle bounds.
+	@param end Upper right furthest corner of the triangle bounds.
+	@return true, if the triangle got separated from the shaft.
+	*/
+	inline static bool outside(const Shaft& shaft, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& start, const glm::vec3& end) {
+		if (start.x > shaft.end.x || start.y > shaft.end.y || start.z > shaft.end.z
+			|| end.x < shaft.start.x || end.y < shaft.start.y || end.z < shaft.start.z) return true;
+		for (size_t i = 0; i < shaft.numPlanes; i++) {
+			const glm::vec3 normal(shaft.planes[i]);
+			const float offset = (shaft.planes[i].w + shaft.tolerance);
+			if (glm::dot(normal, a) > offset && glm::dot(normal, b) > offset && glm::dot(normal, c) > offset) return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Triangle, that may block shadow rays (faces the light).
+	 */
+	struct Candidate {
+		// Index buffer offset of the triangle.
+		uint32_t triangle;
+
+		// Triangle bounds.
+		glm::vec3 start, end;
+	};
+}
+
+namespace Test {
+	LightVisibility::VisibilityData::VisibilityData(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const VoxelData::GridSettings& gridSettings,
+		const glm::vec3& lightPosition, uint32_t maxOccluders, uint32_t numThreads)
+		: geometry(geometryKey(verts, indexBuffer)) {
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		settings.lightPosition = lightPosition;
+		settings.gridStart = gridSettings.gridStart;
+		settings.gridEnd = gridSettings.gridEnd;
+		settings.numDivisions = gridSettings.numDivisions;
+		const glm::uvec3& numDivisions = settings.numDivisions;
+		const glm::vec3 cellSize = ((settings.gridEnd - settings.gridStart) / glm::vec3(numDivisions));
+		const size_t numCells = (static_cast<size_t>(numDivisions.x) * numDivisions.y * numDivisions.z);
+		const size_t numTriangles = (indexBuffer.size() / 3);
+
+		// Cells, the triangle bounds touch, are the only ones the shaded points can be in (the rest of the cells stay TRACE_CELL):
+		std::vector<bool> classify(numCells, false);
+		std::vector<Candidate> candidates;
+		for (size_t i = 0; i < numTriangles; i++) {
+			const glm::vec3& a = verts[indexBuffer[(i * 3)]].position;
+			const glm::vec3& b = verts[indexBuffer[(i * 3) + 1]].position;
+			const glm::vec3& c = verts[indexBuffer[(i * 3) + 2]].position;
+			const glm::vec3 start = glm::min(glm::min(a, b), c);
+			const glm::vec3 end = glm::max(glm::max(a, b), c);
+			const glm::ivec3 first = glm::clamp(glm::ivec3(glm::floor((start - settings.gridStart) / cellSize)), glm::ivec3(0), glm::ivec3(numDivisions) - 1);
+			const glm::ivec3 last = glm::clamp(glm::ivec3(glm::floor((end - settings.gridStart) / cellSize)), glm::ivec3(0), glm::ivec3(numDivisions) - 1);
+			for (int z = first.z; z <= last.z; z++)
+				for (int y = first.y; y <= last.y; y++)
+					for (int x = first.x; x <= last.x; x++)
+						classify[(static_cast<size_t>(numDivisions.x) * ((static_cast<size_t>(z) * numDivisions.y) + y)) + x] = true;
+
+			// Ray/triangle test only hits front faces, so the triangles, facing away from the light, can never block it (edge-on ones are kept, since rounding decides):
+			const glm::vec3 normal = glm::cross(b - a, c - a);
+			const glm::vec3 toLight = (lightPosition - a);
+			if (glm::dot(normal, toLight) < -(0.000001f * glm::length(normal) * glm::length(toLight))) continue;
+			candidates.push_back({ static_cast<uint32_t>(i * 3), start, end });
+		}
+
+		// Each worker collects the occluders of a contiguous range of cells:
+		struct WorkerLists {
+			std::vector<uint32_t> counts;
+			std::vector<uint32_t> occluders;
+		};
+		const size_t numWorkers = std::max(std::min(static_cast<size_t>(numThreads), numCells), static_cast<size_t>(1));
+		std::vector<WorkerLists> lists(numWorkers);
+		runOnThreads(numWorkers, [&](size_t workerId) {
+			WorkerLists& workerLists = lists[workerId];
+			const size_t firstCell = ((numCells * workerId) / numWorkers);
+			const size_t endCell = ((numCells * (workerId + 1)) / numWorkers);
+			for (size_t cellId = firstCell; cellId < endCell; cellId++) {
+				if (!classify[cellId]) {
+					workerLists.counts.push_back(CellOccluders::TRACE_CELL);
+					continue;
+				}
+				const glm::uvec3 cell(
+					static_cast<uint32_t>(cellId % numDivisions.x),
+					static_cast<uint32_t>((cellId / numDivisions.x) % numDivisions.y),
+					static_cast<uint32_t>(cellId / (static_cast<size_t>(numDivisions.x) * numDivisions.y)));
+				// Cell gets slightly expanded, so that the points, rounding moves just outside the cell, are still covered:
+				const glm::vec3 cellStart = (settings.gridStart + (cellSize * glm::vec3(cell)));
+				const glm::vec3 padding = ((cellSize * 0.001f) + 0.00001f);
+				const Shaft shaft = makeShaft(lightPosition, cellStart - padding, cellStart + cellSize + padding);
+				const size_t listStart = workerLists.occluders.size();
+				uint32_t count = 0;
+				for (size_t i = 0; i < candidates.size(); i++) {
+					const Candidate& candidate = candidates[i];
+					if (outside(shaft, verts[indexBuffer[candidate.triangle]].position, verts[indexBuffer[candidate.triangle + 1]].position, verts[indexBuffer[candidate.triangle + 2]].position,
+						candidate.start, candidate.end)) continue;
+					else if (count >= maxOccluders) {
+						count = CellOccluders::TRACE_CELL;
+						break;
+					}
+					workerLists.occluders.push_back(candidate.triangle);
+					count++;
+				}
+				if (count == CellOccluders::TRACE_CELL) workerLists.occluders.resize(listStart);
+				workerLists.counts.push_back(count);
+			}
+			});
+
+		// Lists are concatenated in cell order:
+		cells.resize(numCells);
+		{
+			size_t cellId = 0;
+			for (size_t workerId = 0; workerId < lists.size(); workerId++) {
+				const WorkerLists& workerLists = lists[workerId];
+				size_t workerOffset = 0;
+				for (size_t i = 0; i < workerLists.counts.size(); i++) {
+					CellOccluders& range = cells[cellId++];
+					range.offset = static_cast<uint32_t>(occluders.size() + workerOffset);
+					range.count = workerLists.counts[i];
+					if (range.count != CellOccluders::TRACE_CELL) workerOffset += range.count;
+				}
+				occluders.insert(occluders.end(), workerLists.occluders.begin(), workerLists.occluders.end());
+			}
+		}
+
+		// Build report:
+		{
+			report.numClassifiedCells = report.numLitCells = report.numListedCells = report.numTracedCells = 0;
+			for (size_t cellId = 0; cellId < numCells; cellId++) {
+				if (!classify[cellId]) continue;
+				report.numClassifiedCells++;
+				if (cells[cellId].count == 0) report.numLitCells++;
+				else if (cells[cellId].count == CellOccluders::TRACE_CELL) report.numTracedCells++;
+				else report.numListedCells++;
+			}
+			report.totalRefs = occluders.size();
+			report.meanOccluders = (report.numListedCells > 0) ? (static_cast<float>(report.totalRefs) / report.numListedCells) : 0.0f;
+			const std::chrono::duration<float> buildTime = (std::chrono::steady_clock::now() - startTime);
+			report.buildTime = buildTime.count();
+		}
+	}
+
+	bool LightVisibility::VisibilityData::occluded(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const glm::vec3& point, float maxDistance, bool& known)const {
+		known = false;
+		const glm::vec3 cellSize = ((settings.gridEnd - settings.gridStart) / glm::vec3(settings.numDivisions));
+		const glm::ivec3 cell = glm::ivec3(glm::floor((point - settings.gridStart) / cellSize));
+		if (cell.x < 0 || cell.y < 0 || cell.z < 0
+			|| cell.x >= static_cast<int>(settings.numDivisions.x) || cell.y >= static_cast<int>(settings.numDivisions.y) || cell.z >= static_cast<int>(settings.numDivisions.z)) return false;
+		const CellOccluders& range = cells[(static_cast<size_t>(settings.numDivisions.x) * ((static_cast<size_t>(cell.z) * settings.numDivisions.y) + cell.y)) + cell.x];
+		if (range.count == CellOccluders::TRACE_CELL) return false;
+		known = true;
+		const RayTriangle::Ray ray = RayTriangle::prepare(settings.lightPosition, glm::normalize(point - settings.lightPosition));
+		for (uint32_t i = range.offset; i < (range.offset + range.count); i++) {
+			float distance;
+			glm::vec3 barycentrics;
+			if (RayTriangle::cast(ray, verts[indexBuffer[occluders[i]]].position, verts[indexBuffer[occluders[i] + 1]].position, verts[indexBuffer[occluders[i] + 2]].position, distance, barycentrics)
+				&& distance < maxDistance) return true;
+		}
+		return false;
+	}
+
+	uint64_t LightVisibility::geometryKey(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer) {
+		uint64_t hash = FNV_OFFSET_BASIS;
+		for (size_t i = 0; i < verts.size(); i++)
+			hashBytes(hash, &verts[i].position, sizeof(glm::vec3));
+		if (!indexBuffer.empty())
+			hashBytes(hash, indexBuffer.data(), sizeof(uint32_t) * indexBuffer.size());
+		return hash;
+	}
+
+	LightVisibility::LightVisibility(const std::shared_ptr<GraphicsDevice>& device, const VisibilityData& data, void(*logFn)(const char*))
+		: geometry(data.geometry), lightPosition(data.settings.lightPosition), report(data.report)
+		, settings(device, &data.settings, logFn)
+		, cells(device, static_cast<uint32_t>(std::max(data.cells.size(), static_cast<size_t>(1))), data.cells.empty() ? nullptr : data.cells.data(), logFn)
+		, occluders(device, static_cast<uint32_t>(std::max(data.occluders.size(), static_cast<size_t>(1))), data.occluders.empty() ? nullptr : data.occluders.data(), logFn) { }
+
+	bool LightVisibility::initialized()const {
+		return (settings.stagingBuffer() != VK_NULL_HANDLE && cells.buffer() != VK_NULL_HANDLE && occluders.buffer() != VK_NULL_HANDLE);
+	}
+
+	bool LightVisibility::upToDate(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const glm::vec3& lightPosition)const {
+		return (this->lightPosition == lightPosition && geometry == geometryKey(verts, indexBuffer));
+	}
+}
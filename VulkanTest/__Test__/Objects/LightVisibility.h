@@ -0,0 +1,175 @@
+#pragma once
+#include "VoxelGrid.h"
+
+namespace Test {
+	/**
+	 * Cached shadow ray occluders of a static point light, per non-empty cell of a regular grid.
+	 * Each cell gets the list of triangles, that could possibly block any segment from the light to any point inside the cell
+	 * (only the ones facing the light, since the ray/triangle test ignores back faces, and only the ones, a shaft culling test could not separate from the convex hull of the light and the cell).
+	 * Shaders look up the cell, the shaded point is in, and test the listed triangles directly; empty lists mean the cell is fully lit and the shadow ray is skipped altogether.
+	 * Cells with too many occluders (or no geometry) are marked as "trace", in which case the shaders fall back to the regular grid walk.
+	 * Content is only valid for the light position it got built for (shaders compare it to the current light and fall back to the grid walk on mismatch),
+	 * so it has to be rebuilt whenever the light or the geometry changes (see upToDate()).
+	 */
+	struct LightVisibility {
+		/**
+		 * Light and grid the occluders got collected for (same layout as LightVisibilitySettings from the shaders).
+		 */
+		struct Settings {
+			// Light position, the occluders got collected for.
+			alignas(16) glm::vec3 lightPosition;
+
+			// Lower left nearest corner of the grid.
+			alignas(16) glm::vec3 gridStart;
+
+			// Upper right furthest corner of the grid.
+			alignas(16) glm::vec3 gridEnd;
+
+			// Number of cells per axis.
+			alignas(16) glm::uvec3 numDivisions;
+		};
+
+		/**
+		 * Range of cell occluders within the occluder buffer (same layout as LightOccluderRange from the shaders).
+		 */
+		struct CellOccluders {
+			// Count, telling that the cell has to be traced regularly (too many occluders or no geometry inside).
+			static constexpr uint32_t TRACE_CELL = (~0u);
+
+			// Index of the first occluder of the cell.
+			uint32_t offset;
+
+			// Number of occluders (0 means fully lit; TRACE_CELL means unknown).
+			uint32_t count;
+		};
+
+		/**
+		 * Statistics, gathered during the build.
+		 */
+		struct BuildReport {
+			// Number of cells with geometry inside (the only ones that get classified).
+			size_t numClassifiedCells;
+
+			// Number of classified cells with no occluders (shadow rays get skipped).
+			size_t numLitCells;
+
+			// Number of classified cells with short occluder lists (shadow rays test the listed triangles only).
+			size_t numListedCells;
+
+			// Number of classified cells with too many occluders (shadow rays walk the grid).
+			size_t numTracedCells;
+
+			// Average number of occluders per listed cell.
+			float meanOccluders;
+
+			// Total number of occluder references.
+			size_t totalRefs;
+
+			// Build time in seconds.
+			float buildTime;
+		};
+
+		/**
+		 * CPU "Clone" of the light visibility data.
+		 */
+		struct VisibilityData {
+			// Default number of occluders, a cell can list before it gets marked as TRACE_CELL.
+			static constexpr uint32_t DEFAULT_MAX_OCCLUDERS = 32;
+
+			// Settings.
+			Settings settings;
+
+			// Flattened occluder ranges per cell.
+			std::vector<CellOccluders> cells;
+
+			// Occluding triangles (index buffer offsets, just like the voxel grid triangle references), grouped per cell in ascending order.
+			std::vector<uint32_t> occluders;
+
+			// Key of the geometry, the data got built from (see geometryKey()).
+			uint64_t geometry;
+
+			// Build statistics.
+			BuildReport report;
+
+			/**
+			Collects occluders for every non-empty cell.
+			Note: When numThreads is greater than 1, cells are split between worker threads and the lists are concatenated in cell order afterwards,
+				so the content is identical to the single-threaded build.
+			@param verts Mesh vertices.
+			@param indexBuffer Mesh indices.
+			@param gridSettings Grid bounds and resolution (usually the ones of the voxel grid, the shadow rays walk otherwise; subDivisions are ignored).
+			@param lightPosition Light position.
+			@param maxOccluders Cells with more occluders than this are marked as TRACE_CELL.
+			@param numThreads Number of worker threads to use for the build (0 and 1 both mean "build on the calling thread").
+			*/
+			VisibilityData(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const VoxelData::GridSettings& gridSettings,
+				const glm::vec3& lightPosition, uint32_t maxOccluders = DEFAULT_MAX_OCCLUDERS, uint32_t numThreads = 1);
+
+			/**
+			CPU mirror of the cached shadow ray test from the shaders (ray goes from the light towards the point; hits within [0, maxDistance) block it).
+			@param verts Mesh vertices (same as the ones, the data got built from).
+			@param indexBuffer Mesh indices.
+			@param point Shaded point.
+			@param maxDistance Maximal distance from the light to the blocking hit.
+			@param known Receives false, if the point has to be traced regularly (point outside the grid or TRACE_CELL).
+			@return true, if one of the cell occluders blocks the ray (meaningless, if known is false).
+			*/
+			bool occluded(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const glm::vec3& point, float maxDistance, bool& known)const;
+		};
+
+		/**
+		Calculates the key of the geometry, occluders depend on (only vertex positions are hashed).
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@return 64 bit FNV-1a hash.
+		*/
+		static uint64_t geometryKey(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer);
+
+
+
+
+
+		/**
+		Uploads existing visibility data to GPU.
+		@param device Logical device to upload to.
+		@param data Baked visibility data.
+		@param logFn One function that will help us if anything goes wrong.
+		*/
+		LightVisibility(const std::shared_ptr<GraphicsDevice>& device, const VisibilityData& data, void(*logFn)(const char*) = nullptr);
+
+		/**
+		Tells if anything went wrong during initialisation.
+		@return true, if every single buffer is valid.
+		*/
+		bool initialized()const;
+
+		/**
+		Tells, if the content is still valid for the scene (otherwise it has to be rebuilt; until then, shaders trace the shadow rays regularly, as long as the light position differs).
+		@param verts Current mesh vertices.
+		@param indexBuffer Current mesh indices.
+		@param lightPosition Current light position.
+		@return true, if neither the light, nor the geometry have changed since the build.
+		*/
+		bool upToDate(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const glm::vec3& lightPosition)const;
+
+
+
+		// Key of the geometry, the data got built from (same as VisibilityData).
+		const uint64_t geometry;
+
+		// Light position, the data got built for (same as VisibilityData::settings).
+		const glm::vec3 lightPosition;
+
+		// Build statistics (same as VisibilityData).
+		const BuildReport report;
+
+		// Constant buffer, holding the light position and the grid settings (same as VisibilityData).
+		const ConstantBuffer<Settings> settings;
+
+		// Flattened occluder ranges per cell (same as VisibilityData).
+		const Buffer<CellOccluders, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> cells;
+
+		// Occluding triangles (same as VisibilityData; a single placeholder element, if there are none).
+		const Buffer<uint32_t, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> occluders;
+	};
+}
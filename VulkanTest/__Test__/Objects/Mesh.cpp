@@ -1,9 +1,19 @@
 #include "Mesh.h"
 
+namespace {
+	inline static std::vector<glm::vec4> positions(const std::vector<Test::PNCVertex>& verts) {
+		std::vector<glm::vec4> result(verts.size());
+		for (size_t i = 0; i < verts.size(); i++)
+			result[i] = glm::vec4(verts[i].position, 1.0f);
+		return result;
+	}
+}
+
 namespace Test {
 	Mesh::Mesh(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, void(*logFn)(const char*))
 		: m_graphicsDevice(device)
 		, m_vertexBuffer(m_graphicsDevice, static_cast<uint32_t>(verts.size()), verts.data(), logFn)
+		, m_positionBuffer(m_graphicsDevice, static_cast<uint32_t>(verts.size()), positions(verts).data(), logFn)
 		, m_indexBuffer(m_graphicsDevice, static_cast<uint32_t>(indexBuffer.size()), indexBuffer.data(), logFn) {}
 
 	const std::shared_ptr<GraphicsDevice>& Mesh::device()const {
@@ -12,7 +22,7 @@ namespace Test {
 
 	bool Mesh::initialized()const {
 		return m_graphicsDevice != nullptr && m_graphicsDevice->initialized() 
-			&& m_vertexBuffer.buffer() != VK_NULL_HANDLE && m_indexBuffer.buffer() != VK_NULL_HANDLE;
+			&& m_vertexBuffer.buffer() != VK_NULL_HANDLE && m_positionBuffer.buffer() != VK_NULL_HANDLE && m_indexBuffer.buffer() != VK_NULL_HANDLE;
 	}
 
 	uint32_t Mesh::numVertices()const {
@@ -23,6 +33,10 @@ namespace Test {
 		return m_vertexBuffer.buffer();
 	}
 
+	VkBuffer Mesh::positionBuffer()const {
+		return m_positionBuffer.buffer();
+	}
+
 	uint32_t Mesh::numIndices()const {
 		return m_indexBuffer.size();
 	}
@@ -41,6 +41,13 @@ namespace Test {
 		*/
 		VkBuffer vertexBuffer()const;
 
+		/**
+		Storage buffer, containing vertex positions alone (vec4 per vertex, w unused, same order as the vertex buffer).
+		Ray tracers read these during traversal (16 bytes instead of the whole 48 byte vertex) and fetch the rest of the attributes from vertexBuffer() for the closest hit only.
+		@return position buffer.
+		*/
+		VkBuffer positionBuffer()const;
+
 		/**
 		Number of indices within the mesh (3 times the polycount).
 		@return amount of element s within the index buffer.
@@ -60,6 +67,7 @@ namespace Test {
 	private:
 		const std::shared_ptr<GraphicsDevice> m_graphicsDevice;
 		VertexBuffer<PNCVertex> m_vertexBuffer;
+		Buffer<glm::vec4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> m_positionBuffer;
 		IndexBuffer m_indexBuffer;
 	};
 }
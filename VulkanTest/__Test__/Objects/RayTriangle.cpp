@@ -0,0 +1,224 @@
+#include "RayTriangle.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+
+namespace {
+	/**
+	Projection-based test with six square roots, the shaders used before the watertight kernel (kept for the benchmark only).
+	@param origin Ray origin.
+	@param direction Ray direction.
+	@param a First vertex.
+	@param b Second vertex.
+	@param c Third vertex.
+	@param distance Hit distance (written only on hit).
+	@return true, if the ray hits the front face of the triangle.
+	*/
+	inline static bool castLegacy(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& distance) {
+		const glm::vec3 normal = glm::cross((b - a), (c - a));
+		const float deltaProjection = glm::dot((a - origin), normal);
+		if (deltaProjection > 0.0f) return false;
+		const float dirProjection = glm::dot(direction, normal);
+		if ((deltaProjection * dirProjection) <= 0) return false;
+		const float dist = deltaProjection / dirProjection;
+		const glm::vec3 point = origin + direction * dist;
+		if (point != a && point != b && point != c) {
+			const glm::vec3 ab = (b - a);
+			const glm::vec3 bc = (c - b);
+			const glm::vec3 ca = (a - c);
+			const glm::vec3 ax = (point - a);
+			const glm::vec3 bx = (point - b);
+			const glm::vec3 cx = (point - c);
+			if (!(glm::dot(ab, ax) / std::sqrt(glm::dot(ax, ax)) + 0.00015f >= -glm::dot(ab, ca) / std::sqrt(glm::dot(ca, ca))
+				&& glm::dot(bc, bx) / std::sqrt(glm::dot(bx, bx)) + 0.00015f >= -glm::dot(bc, ab) / std::sqrt(glm::dot(ab, ab))
+				&& glm::dot(ca, cx) / std::sqrt(glm::dot(cx, cx)) + 0.00015f >= -glm::dot(ca, bc) / std::sqrt(glm::dot(bc, bc)))) return false;
+		}
+		distance = dist;
+		return true;
+	}
+
+	/**
+	Tests the ray against every triangle of the list with both kernels.
+	@param origin Ray origin.
+	@param direction Ray direction.
+	@param triangles Triangle vertices (three per triangle).
+	@param watertightDistance Closest hit distance from the watertight kernel (infinity, if none).
+	@param legacyDistance Closest hit distance from the legacy kernel (infinity, if none).
+	*/
+	inline static void castOnAll(const glm::vec3& origin, const glm::vec3& direction, const std::vector<glm::vec3>& triangles, float& watertightDistance, float& legacyDistance) {
+		const Test::RayTriangle::Ray ray = Test::RayTriangle::prepare(origin, direction);
+		watertightDistance = legacyDistance = std::numeric_limits<float>::infinity();
+		for (size_t i = 0; (i + 2) < triangles.size(); i += 3) {
+			float dist;
+			glm::vec3 barycentrics;
+			if (Test::RayTriangle::cast(ray, triangles[i], triangles[i + 1], triangles[i + 2], dist, barycentrics))
+				watertightDistance = std::min(watertightDistance, dist);
+			if (castLegacy(origin, direction, triangles[i], triangles[i + 1], triangles[i + 2], dist))
+				legacyDistance = std::min(legacyDistance, dist);
+		}
+	}
+}
+
+namespace Test {
+	RayTriangle::Ray RayTriangle::prepare(const glm::vec3& origin, const glm::vec3& direction) {
+		// Dominant axis becomes Z; X and Y get swapped for negative directions, so that the winding stays the same:
+		const glm::vec3 absDirection = glm::abs(direction);
+		const int kz = (absDirection.x > absDirection.y) ? ((absDirection.x > absDirection.z) ? 0 : 2) : ((absDirection.y > absDirection.z) ? 1 : 2);
+		int kx = ((kz + 1) % 3);
+		int ky = ((kx + 1) % 3);
+		if (direction[kz] < 0.0f) std::swap(kx, ky);
+
+		// Paper divides X and Y by the Z direction; we multiply the rest instead (same signs, no rounded reciprocals, hence exact same results on GPU):
+		Ray ray;
+		ray.origin = origin;
+		ray.shear = glm::mat3(0.0f);
+		ray.shear[kx][0] = direction[kz];
+		ray.shear[kz][0] = -direction[kx];
+		ray.shear[ky][1] = direction[kz];
+		ray.shear[kz][1] = -direction[ky];
+		ray.shear[kz][2] = (direction[kz] < 0.0f) ? -1.0f : 1.0f;
+		ray.invScale = (1.0f / absDirection[kz]);
+		return ray;
+	}
+
+	bool RayTriangle::cast(const Ray& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& distance, glm::vec3& barycentrics) {
+		const glm::vec3 A = (ray.shear * (a - ray.origin));
+		const glm::vec3 B = (ray.shear * (b - ray.origin));
+		const glm::vec3 C = (ray.shear * (c - ray.origin));
+		const float U = ((C.x * B.y) - (C.y * B.x));
+		const float V = ((A.x * C.y) - (A.y * C.x));
+		const float W = ((B.x * A.y) - (B.y * A.x));
+		if (U < 0.0f || V < 0.0f || W < 0.0f) return false;
+		const float det = (U + V + W);
+		if (det <= 0.0f) return false;
+		const float T = ((U * A.z) + (V * B.z) + (W * C.z));
+		if (T <= 0.0f) return false;
+		const float invDet = (1.0f / det);
+		distance = ((T * invDet) * ray.invScale);
+		barycentrics = (glm::vec3(U, V, W) * invDet);
+		return true;
+	}
+
+	RayTriangle::BenchmarkReport RayTriangle::benchmark(size_t numTests) {
+		BenchmarkReport report = {};
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<float> random(-1.0f, 1.0f);
+		const auto randomVector = [&]() { return glm::vec3(random(generator), random(generator), random(generator)); };
+
+		// Timing (each ray gets tested against a few random triangles, about half of which it hits; ray preparation is included):
+		{
+			const size_t TRIANGLES_PER_RAY = 16;
+			const size_t numRays = std::max(numTests / TRIANGLES_PER_RAY, static_cast<size_t>(1));
+			report.numTests = (numRays * TRIANGLES_PER_RAY);
+			std::vector<glm::vec3> origins(numRays), directions(numRays), triangles(report.numTests * 3);
+			for (size_t i = 0; i < numRays; i++) {
+				origins[i] = (randomVector() * 4.0f);
+				directions[i] = glm::normalize((randomVector() * 0.5f) - origins[i]);
+			}
+			for (size_t i = 0; i < triangles.size(); i++)
+				triangles[i] = randomVector();
+
+			size_t numHits = 0;
+			std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+			for (size_t rayId = 0; rayId < numRays; rayId++) {
+				const Ray ray = prepare(origins[rayId], directions[rayId]);
+				const glm::vec3* triangle = (triangles.data() + (rayId * TRIANGLES_PER_RAY * 3));
+				for (size_t i = 0; i < TRIANGLES_PER_RAY; i++, triangle += 3) {
+					float dist;
+					glm::vec3 barycentrics;
+					if (cast(ray, triangle[0], triangle[1], triangle[2], dist, barycentrics)) numHits++;
+				}
+			}
+			report.watertightTime = (std::chrono::duration<float>(std::chrono::system_clock::now() - start).count() * 1000000000.0f / report.numTests);
+
+			start = std::chrono::system_clock::now();
+			for (size_t rayId = 0; rayId < numRays; rayId++) {
+				const glm::vec3* triangle = (triangles.data() + (rayId * TRIANGLES_PER_RAY * 3));
+				for (size_t i = 0; i < TRIANGLES_PER_RAY; i++, triangle += 3) {
+					float dist;
+					if (castLegacy(origins[rayId], directions[rayId], triangle[0], triangle[1], triangle[2], dist)) numHits++;
+				}
+			}
+			report.legacyTime = (std::chrono::duration<float>(std::chrono::system_clock::now() - start).count() * 1000000000.0f / report.numTests);
+
+			// Keeps the loops from being optimized away:
+			if (numHits > (report.numTests * 2)) report.numTests = numHits;
+		}
+
+		// Bumpy height field with jittered vertices (front faces look up), so that the edges are not axis aligned:
+		const size_t GRID_SIZE = 16;
+		std::vector<glm::vec3> grid;
+		{
+			std::vector<glm::vec3> verts;
+			for (size_t y = 0; y < GRID_SIZE; y++)
+				for (size_t x = 0; x < GRID_SIZE; x++)
+					verts.push_back(glm::vec3(
+						(static_cast<float>(x) + (random(generator) * 0.25f)) / (GRID_SIZE - 1),
+						(static_cast<float>(y) + (random(generator) * 0.25f)) / (GRID_SIZE - 1),
+						random(generator) * 0.01f));
+			for (size_t y = 0; (y + 1) < GRID_SIZE; y++)
+				for (size_t x = 0; (x + 1) < GRID_SIZE; x++) {
+					const glm::vec3& v00 = verts[(y * GRID_SIZE) + x];
+					const glm::vec3& v10 = verts[(y * GRID_SIZE) + x + 1];
+					const glm::vec3& v01 = verts[((y + 1) * GRID_SIZE) + x];
+					const glm::vec3& v11 = verts[((y + 1) * GRID_SIZE) + x + 1];
+					grid.insert(grid.end(), { v00, v10, v11, v00, v11, v01 });
+				}
+		}
+
+		// Rays aimed at the shared edges and vertices from above (every single one of them has to hit something):
+		const size_t NUM_EDGE_RAYS = 4096;
+		for (size_t i = 0; i < NUM_EDGE_RAYS; i++) {
+			// Interior edges and vertices only (the ones on the border are not shared):
+			const size_t triangle = (static_cast<size_t>(generator()) % (grid.size() / 3));
+			const size_t cellX = ((triangle / 2) % (GRID_SIZE - 1)), cellY = ((triangle / 2) / (GRID_SIZE - 1));
+			if (cellX == 0 || cellY == 0 || (cellX + 2) >= GRID_SIZE || (cellY + 2) >= GRID_SIZE) continue;
+			const glm::vec3* vertex = (grid.data() + (triangle * 3));
+			const size_t edge = (static_cast<size_t>(generator()) % 3);
+			const glm::vec3 target = ((i % 8) == 0) ? vertex[edge] : glm::mix(vertex[edge], vertex[(edge + 1) % 3], (random(generator) + 1.0f) * 0.5f);
+			const glm::vec3 origin = (target + glm::vec3(random(generator), random(generator), 2.0f));
+			const glm::vec3 direction = glm::normalize(target - origin);
+			float watertightDistance, legacyDistance;
+			castOnAll(origin, direction, grid, watertightDistance, legacyDistance);
+			report.numEdgeRays++;
+			if (std::isinf(watertightDistance)) report.watertightEdgeMisses++;
+			else if (std::abs(watertightDistance - glm::length(target - origin)) > 0.0001f) report.watertightDistanceErrors++;
+			if (std::isinf(legacyDistance)) report.legacyEdgeMisses++;
+		}
+
+		// Rays that should not hit anything:
+		{
+			const auto castInvalid = [&](const glm::vec3& origin, const glm::vec3& direction, const std::vector<glm::vec3>& triangles) {
+				float watertightDistance, legacyDistance;
+				castOnAll(origin, direction, triangles, watertightDistance, legacyDistance);
+				report.numInvalidRays++;
+				if (!std::isinf(watertightDistance)) report.watertightFalseHits++;
+				if (!std::isinf(legacyDistance)) report.legacyFalseHits++;
+			};
+			const glm::vec3 FLAT[] = { glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+			const std::vector<glm::vec3> flat(FLAT, FLAT + 3);
+			for (size_t i = 0; i < 256; i++) {
+				const glm::vec3 target = glm::mix(FLAT[i % 3], FLAT[(i + 1) % 3], (random(generator) + 1.0f) * 0.5f);
+
+				// Back faces of the height field (same targets as above, looked at from below):
+				{
+					const glm::vec3* vertex = (grid.data() + ((static_cast<size_t>(generator()) % (grid.size() / 3)) * 3));
+					const glm::vec3 gridTarget = ((vertex[0] + vertex[1] + vertex[2]) / 3.0f);
+					const glm::vec3 origin = (gridTarget + glm::vec3(random(generator), random(generator), -2.0f));
+					castInvalid(origin, glm::normalize(gridTarget - origin), grid);
+				}
+
+				// Rays within the plane of the triangle:
+				{
+					const glm::vec3 direction = glm::normalize(glm::vec3(random(generator), random(generator), 0.0f));
+					castInvalid(target - direction, direction, flat);
+				}
+			}
+		}
+		return report;
+	}
+}
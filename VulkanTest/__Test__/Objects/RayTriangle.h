@@ -0,0 +1,92 @@
+#pragma once
+#include "../MathApi.h"
+#include <glm/mat3x3.hpp>
+#include <cstddef>
+
+namespace Test {
+	/**
+	 * Watertight ray/triangle intersection (Woop, Benthin & Wald, "Watertight Ray/Triangle Intersection"), mirror of RayTriangle.glsl.
+	 * Vertices are moved to the ray space (ray along +Z) with a per-ray shear that uses no divisions, so the edge functions and the hit/miss decision
+	 * come out bit-identical on CPU and GPU (as long as neither side contracts multiply-adds; shaders mark the math as precise).
+	 * Shared edges get the exact same edge function values (with opposite signs) from both neighbours, so rays can not slip through the cracks.
+	 * Only front faces get hit (counterclockwise, when looked at against the ray), just like with the old shader test.
+ * Zero-area triangles, the ray passes right through, may still report a hit (rounding decides), just like in the paper.
+	 */
+	struct RayTriangle {
+		/**
+		 * Ray, prepared for the intersection tests (same as TriangleRay from RayTriangle.glsl).
+		 */
+		struct Ray {
+			// Ray origin.
+			glm::vec3 origin;
+
+			// Permutation and shear, that moves the vertices (relative to the origin) to the ray space.
+			glm::mat3 shear;
+
+			// Inverse of the ray direction length along its dominant axis (ray space distances get multiplied by it).
+			float invScale;
+		};
+
+		/**
+		 * Micro-benchmark results (see benchmark()).
+		 */
+		struct BenchmarkReport {
+			// Number of ray/triangle tests, each kernel got timed on.
+			size_t numTests;
+
+			// Average time per test with the watertight kernel (nanoseconds).
+			float watertightTime;
+
+			// Average time per test with the previous projection-based kernel with six square roots (nanoseconds).
+			float legacyTime;
+
+			// Number of rays, aimed at the shared edges and vertices of a closed triangle strip.
+			size_t numEdgeRays;
+
+			// Number of the edge rays, the watertight kernel let through (should always be 0).
+			size_t watertightEdgeMisses;
+
+			// Number of the edge rays, the legacy kernel let through.
+			size_t legacyEdgeMisses;
+
+			// Number of the edge rays, the watertight kernel reported the wrong distance for (more than 0.0001 off).
+			size_t watertightDistanceErrors;
+
+			// Number of rays, that should never hit anything (back faces and rays within the triangle plane).
+			size_t numInvalidRays;
+
+			// Number of the invalid rays, the watertight kernel reported a hit for (should always be 0).
+			size_t watertightFalseHits;
+
+			// Number of the invalid rays, the legacy kernel reported a hit for.
+			size_t legacyFalseHits;
+		};
+
+		/**
+		Prepares a ray for the intersection tests (once per ray).
+		@param origin Ray origin.
+		@param direction Ray direction (does not have to be normalized; distances are measured in direction lengths).
+		@return ray space transformation.
+		*/
+		static Ray prepare(const glm::vec3& origin, const glm::vec3& direction);
+
+		/**
+		Casts ray on a triangle.
+		@param ray Prepared ray.
+		@param a First vertex.
+		@param b Second vertex.
+		@param c Third vertex.
+		@param distance Hit distance (written only on hit).
+		@param barycentrics Weights of a, b and c at the hit point (written only on hit).
+		@return true, if the ray hits the front face of the triangle.
+		*/
+		static bool cast(const Ray& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& distance, glm::vec3& barycentrics);
+
+		/**
+		Times the kernel against the legacy one and counts hit/miss errors of both on the edge cases.
+		@param numTests Number of random ray/triangle tests to time each kernel on.
+		@return benchmark results.
+		*/
+		static BenchmarkReport benchmark(size_t numTests);
+	};
+}
@@ -0,0 +1,406 @@
+#include "TrianglePackets.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define TRIANGLE_PACKETS_AVX2
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+// Only the functions below get compiled for AVX2 (FMA is left out on purpose, so that nothing gets contracted):
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+	typedef Test::TrianglePackets TrianglePackets;
+
+	static const float INF = std::numeric_limits<float>::infinity();
+
+	/**
+	Scalar fallback of both kernels: lanes get tested one by one.
+	@param rayOf Function, returning the prepared ray of a lane.
+	@param vertsOf Function, filling in the triangle vertices of a lane.
+	@param hits Hits per lane.
+	@return hit mask.
+	*/
+	template<typename RayOf, typename VertsOf>
+	inline static uint32_t castLanes(const RayOf& rayOf, const VertsOf& vertsOf, TrianglePackets::LaneHits& hits) {
+		uint32_t mask = 0;
+		for (uint32_t i = 0; i < TrianglePackets::WIDTH; i++) {
+			glm::vec3 a, b, c;
+			vertsOf(i, a, b, c);
+			float distance;
+			glm::vec3 barycentrics;
+			if (Test::RayTriangle::cast(rayOf(i), a, b, c, distance, barycentrics)) {
+				hits.distance[i] = distance;
+				hits.u[i] = barycentrics.x;
+				hits.v[i] = barycentrics.y;
+				hits.w[i] = barycentrics.z;
+				mask |= (1u << i);
+			}
+		}
+		return mask;
+	}
+
+#ifdef TRIANGLE_PACKETS_AVX2
+	/**
+	 * Eight lanes of rays (either the same ray broadcasted or a ray packet).
+	 */
+	struct RayLanes {
+		__m256 origin[3];
+		__m256 shear[9];
+		__m256 invScale;
+	};
+
+	// Same as glm's mat3 * vec3 (left to right sums):
+	AVX2_TARGET inline static __m256 shearRow(const RayLanes& ray, int row, const __m256& x, const __m256& y, const __m256& z) {
+		return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ray.shear[row], x), _mm256_mul_ps(ray.shear[3 + row], y)), _mm256_mul_ps(ray.shear[6 + row], z));
+	}
+
+	/**
+	Mirror of RayTriangle::cast() for eight lanes (comparisons are negated the same way, so NaNs end up on the same side, too).
+	@param ray Ray lanes.
+	@param vertex Vertex lanes (a.xyz, b.xyz and c.xyz).
+	@param hits Hits per lane.
+	@return hit mask.
+	*/
+	AVX2_TARGET inline static uint32_t castAVX2(const RayLanes& ray, const __m256 vertex[9], TrianglePackets::LaneHits& hits) {
+		__m256 A[3], B[3], C[3];
+		{
+			const __m256 ax = _mm256_sub_ps(vertex[0], ray.origin[0]), ay = _mm256_sub_ps(vertex[1], ray.origin[1]), az = _mm256_sub_ps(vertex[2], ray.origin[2]);
+			const __m256 bx = _mm256_sub_ps(vertex[3], ray.origin[0]), by = _mm256_sub_ps(vertex[4], ray.origin[1]), bz = _mm256_sub_ps(vertex[5], ray.origin[2]);
+			const __m256 cx = _mm256_sub_ps(vertex[6], ray.origin[0]), cy = _mm256_sub_ps(vertex[7], ray.origin[1]), cz = _mm256_sub_ps(vertex[8], ray.origin[2]);
+			for (int row = 0; row < 3; row++) {
+				A[row] = shearRow(ray, row, ax, ay, az);
+				B[row] = shearRow(ray, row, bx, by, bz);
+				C[row] = shearRow(ray, row, cx, cy, cz);
+			}
+		}
+		const __m256 U = _mm256_sub_ps(_mm256_mul_ps(C[0], B[1]), _mm256_mul_ps(C[1], B[0]));
+		const __m256 V = _mm256_sub_ps(_mm256_mul_ps(A[0], C[1]), _mm256_mul_ps(A[1], C[0]));
+		const __m256 W = _mm256_sub_ps(_mm256_mul_ps(B[0], A[1]), _mm256_mul_ps(B[1], A[0]));
+		const __m256 zero = _mm256_setzero_ps();
+		__m256 mask = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(U, zero, _CMP_NLT_UQ), _mm256_cmp_ps(V, zero, _CMP_NLT_UQ)), _mm256_cmp_ps(W, zero, _CMP_NLT_UQ));
+		if (_mm256_movemask_ps(mask) == 0) return 0;
+		const __m256 det = _mm256_add_ps(_mm256_add_ps(U, V), W);
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(det, zero, _CMP_NLE_UQ));
+		const __m256 T = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(U, A[2]), _mm256_mul_ps(V, B[2])), _mm256_mul_ps(W, C[2]));
+		mask = _mm256_and_ps(mask, _mm256_cmp_ps(T, zero, _CMP_NLE_UQ));
+		const uint32_t bits = static_cast<uint32_t>(_mm256_movemask_ps(mask));
+		if (bits == 0) return 0;
+		const __m256 invDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+		_mm256_store_ps(hits.distance, _mm256_mul_ps(_mm256_mul_ps(T, invDet), ray.invScale));
+		_mm256_store_ps(hits.u, _mm256_mul_ps(U, invDet));
+		_mm256_store_ps(hits.v, _mm256_mul_ps(V, invDet));
+		_mm256_store_ps(hits.w, _mm256_mul_ps(W, invDet));
+		return bits;
+	}
+
+	AVX2_TARGET static uint32_t castBlockAVX2(const Test::RayTriangle::Ray& ray, const TrianglePackets::Block& block, TrianglePackets::LaneHits& hits) {
+		RayLanes lanes;
+		for (int i = 0; i < 3; i++) lanes.origin[i] = _mm256_set1_ps(ray.origin[i]);
+		for (int column = 0; column < 3; column++)
+			for (int row = 0; row < 3; row++)
+				lanes.shear[(column * 3) + row] = _mm256_set1_ps(ray.shear[column][row]);
+		lanes.invScale = _mm256_set1_ps(ray.invScale);
+		const __m256 vertex[9] = {
+			_mm256_load_ps(block.ax), _mm256_load_ps(block.ay), _mm256_load_ps(block.az),
+			_mm256_load_ps(block.bx), _mm256_load_ps(block.by), _mm256_load_ps(block.bz),
+			_mm256_load_ps(block.cx), _mm256_load_ps(block.cy), _mm256_load_ps(block.cz)
+		};
+		return castAVX2(lanes, vertex, hits);
+	}
+
+	AVX2_TARGET inline static void loadPacketAVX2(const TrianglePackets::RayPacket& rays, RayLanes& lanes) {
+		lanes.origin[0] = _mm256_load_ps(rays.originX);
+		lanes.origin[1] = _mm256_load_ps(rays.originY);
+		lanes.origin[2] = _mm256_load_ps(rays.originZ);
+		for (int i = 0; i < 9; i++) lanes.shear[i] = _mm256_load_ps(rays.shear[i]);
+		lanes.invScale = _mm256_load_ps(rays.invScale);
+	}
+
+	AVX2_TARGET inline static uint32_t castPacketAVX2(const RayLanes& lanes, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, TrianglePackets::LaneHits& hits) {
+		const __m256 vertex[9] = {
+			_mm256_set1_ps(a.x), _mm256_set1_ps(a.y), _mm256_set1_ps(a.z),
+			_mm256_set1_ps(b.x), _mm256_set1_ps(b.y), _mm256_set1_ps(b.z),
+			_mm256_set1_ps(c.x), _mm256_set1_ps(c.y), _mm256_set1_ps(c.z)
+		};
+		return castAVX2(lanes, vertex, hits);
+	}
+
+	AVX2_TARGET static uint32_t castPacketAVX2(const TrianglePackets::RayPacket& rays, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, TrianglePackets::LaneHits& hits) {
+		RayLanes lanes;
+		loadPacketAVX2(rays, lanes);
+		return castPacketAVX2(lanes, a, b, c, hits);
+	}
+#endif
+
+	inline static uint32_t castBlock(TrianglePackets::InstructionSet instructionSet, const Test::RayTriangle::Ray& ray, const TrianglePackets::Block& block, TrianglePackets::LaneHits& hits) {
+#ifdef TRIANGLE_PACKETS_AVX2
+		if (instructionSet == TrianglePackets::INSTRUCTION_SET_AVX2) return castBlockAVX2(ray, block, hits);
+#endif
+		return castLanes([&](uint32_t) -> const Test::RayTriangle::Ray& { return ray; }, [&](uint32_t i, glm::vec3& a, glm::vec3& b, glm::vec3& c) {
+			a = glm::vec3(block.ax[i], block.ay[i], block.az[i]);
+			b = glm::vec3(block.bx[i], block.by[i], block.bz[i]);
+			c = glm::vec3(block.cx[i], block.cy[i], block.cz[i]);
+		}, hits);
+	}
+
+	inline static uint32_t castPacket(TrianglePackets::InstructionSet instructionSet,
+		const TrianglePackets::RayPacket& rays, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, TrianglePackets::LaneHits& hits) {
+#ifdef TRIANGLE_PACKETS_AVX2
+		if (instructionSet == TrianglePackets::INSTRUCTION_SET_AVX2) return castPacketAVX2(rays, a, b, c, hits);
+#endif
+		return castLanes([&](uint32_t i) { return rays.lane(i); }, [&](uint32_t, glm::vec3& pa, glm::vec3& pb, glm::vec3& pc) {
+			pa = a;
+			pb = b;
+			pc = c;
+		}, hits);
+	}
+
+	// Keeps the lane hit, if it's closer than the current one (lanes are visited in triangle order, so ties go to the first triangle, just like with the scalar loop):
+	inline static void keepCloser(const TrianglePackets::LaneHits& hits, uint32_t lane, uint32_t triangle, TrianglePackets::Hit& closest) {
+		if (hits.distance[lane] < closest.distance) {
+			closest.distance = hits.distance[lane];
+			closest.triangle = triangle;
+			closest.barycentrics = glm::vec3(hits.u[lane], hits.v[lane], hits.w[lane]);
+		}
+	}
+
+	inline static bool raycastBlocks(TrianglePackets::InstructionSet instructionSet, const std::vector<TrianglePackets::Block>& blocks,
+		const glm::vec3& origin, const glm::vec3& direction, TrianglePackets::Hit& hit) {
+		const Test::RayTriangle::Ray ray = Test::RayTriangle::prepare(origin, direction);
+		TrianglePackets::Hit closest = {};
+		closest.distance = INF;
+		TrianglePackets::LaneHits hits;
+		for (size_t blockId = 0; blockId < blocks.size(); blockId++) {
+			uint32_t mask = castBlock(instructionSet, ray, blocks[blockId], hits);
+			for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1)
+				if ((mask & 1) != 0) keepCloser(hits, lane, blocks[blockId].triangle[lane], closest);
+		}
+		if (std::isinf(closest.distance)) return false;
+		hit = closest;
+		return true;
+	}
+
+	/**
+	Closest hits of a ray packet.
+	@param blocks Triangle blocks.
+	@param castTriangle Function, testing the packet against a single triangle (a, b, c, hits) and returning the hit mask.
+	@param closest Closest hit per lane.
+	@return hit mask.
+	*/
+	template<typename CastTriangle>
+	inline static uint32_t raycastPacket(const std::vector<TrianglePackets::Block>& blocks, const CastTriangle& castTriangle, TrianglePackets::Hit closest[TrianglePackets::WIDTH]) {
+		for (uint32_t i = 0; i < TrianglePackets::WIDTH; i++) closest[i].distance = INF;
+		uint32_t hitMask = 0;
+		TrianglePackets::LaneHits hits;
+		for (size_t blockId = 0; blockId < blocks.size(); blockId++) {
+			const TrianglePackets::Block& block = blocks[blockId];
+			for (uint32_t t = 0; t < TrianglePackets::WIDTH; t++) {
+				if (block.triangle[t] == TrianglePackets::NO_TRIANGLE) break;
+				uint32_t mask = castTriangle(
+					glm::vec3(block.ax[t], block.ay[t], block.az[t]), glm::vec3(block.bx[t], block.by[t], block.bz[t]), glm::vec3(block.cx[t], block.cy[t], block.cz[t]), hits);
+				hitMask |= mask;
+				for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1)
+					if ((mask & 1) != 0) keepCloser(hits, lane, block.triangle[t], closest[lane]);
+			}
+		}
+		return hitMask;
+	}
+
+#ifdef TRIANGLE_PACKETS_AVX2
+	// Packet registers get loaded only once for all the triangles:
+	AVX2_TARGET static uint32_t raycastPacketAVX2(const std::vector<TrianglePackets::Block>& blocks, const TrianglePackets::RayPacket& rays, TrianglePackets::Hit closest[TrianglePackets::WIDTH]) {
+		RayLanes lanes;
+		loadPacketAVX2(rays, lanes);
+		return raycastPacket(blocks, [&](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, TrianglePackets::LaneHits& hits) AVX2_TARGET {
+			return castPacketAVX2(lanes, a, b, c, hits);
+		}, closest);
+	}
+#endif
+
+	inline static uint32_t raycastPacket(TrianglePackets::InstructionSet instructionSet, const std::vector<TrianglePackets::Block>& blocks,
+		const TrianglePackets::RayPacket& rays, TrianglePackets::Hit closest[TrianglePackets::WIDTH]) {
+#ifdef TRIANGLE_PACKETS_AVX2
+		if (instructionSet == TrianglePackets::INSTRUCTION_SET_AVX2) return raycastPacketAVX2(blocks, rays, closest);
+#endif
+		return raycastPacket(blocks, [&](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, TrianglePackets::LaneHits& hits) {
+			return castPacket(instructionSet, rays, a, b, c, hits);
+		}, closest);
+	}
+
+	inline static bool sameHit(bool hitA, const TrianglePackets::Hit& a, bool hitB, const TrianglePackets::Hit& b) {
+		if (hitA != hitB) return false;
+		else return ((!hitA) || (a.distance == b.distance && a.triangle == b.triangle && a.barycentrics == b.barycentrics));
+	}
+}
+
+namespace Test {
+	TrianglePackets::RayPacket::RayPacket(const RayTriangle::Ray* rays, size_t numRays) {
+		for (size_t i = 0; i < WIDTH; i++) {
+			const RayTriangle::Ray& ray = rays[std::min(i, numRays - 1)];
+			originX[i] = ray.origin.x;
+			originY[i] = ray.origin.y;
+			originZ[i] = ray.origin.z;
+			for (int column = 0; column < 3; column++)
+				for (int row = 0; row < 3; row++)
+					shear[(column * 3) + row][i] = ray.shear[column][row];
+			invScale[i] = ray.invScale;
+		}
+	}
+
+	RayTriangle::Ray TrianglePackets::RayPacket::lane(size_t lane)const {
+		RayTriangle::Ray ray;
+		ray.origin = glm::vec3(originX[lane], originY[lane], originZ[lane]);
+		for (int column = 0; column < 3; column++)
+			for (int row = 0; row < 3; row++)
+				ray.shear[column][row] = shear[(column * 3) + row][lane];
+		ray.invScale = invScale[lane];
+		return ray;
+	}
+
+	TrianglePackets::InstructionSet TrianglePackets::detectInstructionSet() {
+#if defined(TRIANGLE_PACKETS_AVX2) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return INSTRUCTION_SET_SCALAR;
+		__cpuid(info, 1);
+		// OSXSAVE and AVX, as well as the OS saving the YMM registers:
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) return INSTRUCTION_SET_SCALAR;
+		__cpuidex(info, 7, 0);
+		return ((info[1] & (1 << 5)) != 0) ? INSTRUCTION_SET_AVX2 : INSTRUCTION_SET_SCALAR;
+#elif defined(TRIANGLE_PACKETS_AVX2)
+		return __builtin_cpu_supports("avx2") ? INSTRUCTION_SET_AVX2 : INSTRUCTION_SET_SCALAR;
+#else
+		return INSTRUCTION_SET_SCALAR;
+#endif
+	}
+
+	TrianglePackets::TrianglePackets(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, InstructionSet instructionSet)
+		: m_instructionSet((instructionSet == INSTRUCTION_SET_AVX2 && detectInstructionSet() == INSTRUCTION_SET_AVX2) ? INSTRUCTION_SET_AVX2 : INSTRUCTION_SET_SCALAR)
+		, m_numTriangles(indexBuffer.size() / 3) {
+		m_blocks.resize((m_numTriangles + WIDTH - 1) / WIDTH);
+		for (size_t blockId = 0; blockId < m_blocks.size(); blockId++) {
+			Block& block = m_blocks[blockId];
+			for (size_t lane = 0; lane < WIDTH; lane++) {
+				const size_t triangle = (((blockId * WIDTH) + lane) * 3);
+				const bool padding = (triangle >= (m_numTriangles * 3));
+				const glm::vec3 a = padding ? glm::vec3(0.0f) : verts[indexBuffer[triangle]].position;
+				const glm::vec3 b = padding ? glm::vec3(0.0f) : verts[indexBuffer[triangle + 1]].position;
+				const glm::vec3 c = padding ? glm::vec3(0.0f) : verts[indexBuffer[triangle + 2]].position;
+				block.ax[lane] = a.x; block.ay[lane] = a.y; block.az[lane] = a.z;
+				block.bx[lane] = b.x; block.by[lane] = b.y; block.bz[lane] = b.z;
+				block.cx[lane] = c.x; block.cy[lane] = c.y; block.cz[lane] = c.z;
+				block.triangle[lane] = padding ? NO_TRIANGLE : static_cast<uint32_t>(triangle);
+			}
+		}
+	}
+
+	TrianglePackets::InstructionSet TrianglePackets::instructionSet()const {
+		return m_instructionSet;
+	}
+
+	const std::vector<TrianglePackets::Block>& TrianglePackets::blocks()const {
+		return m_blocks;
+	}
+
+	uint32_t TrianglePackets::cast(const RayTriangle::Ray& ray, const Block& block, LaneHits& hits)const {
+		return castBlock(m_instructionSet, ray, block, hits);
+	}
+
+	uint32_t TrianglePackets::cast(const RayPacket& rays, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, LaneHits& hits)const {
+		return castPacket(m_instructionSet, rays, a, b, c, hits);
+	}
+
+	bool TrianglePackets::raycast(const glm::vec3& origin, const glm::vec3& direction, Hit& hit)const {
+		return raycastBlocks(m_instructionSet, m_blocks, origin, direction, hit);
+	}
+
+	uint32_t TrianglePackets::raycast(const RayPacket& rays, Hit hits[WIDTH])const {
+		return raycastPacket(m_instructionSet, m_blocks, rays, hits);
+	}
+
+	TrianglePackets::BenchmarkReport TrianglePackets::benchmark(const std::vector<glm::vec3>& origins, const std::vector<glm::vec3>& directions)const {
+		BenchmarkReport report = {};
+		report.numRays = std::min(origins.size(), directions.size());
+		report.numTriangles = m_numTriangles;
+		report.instructionSet = detectInstructionSet();
+		if (report.numRays == 0) return report;
+		const auto rate = [&](const std::chrono::steady_clock::time_point& start) {
+			const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+			return (seconds > 0.0f) ? (static_cast<float>(report.numRays) / seconds / 1000000.0f) : 0.0f;
+		};
+
+		// Scalar loop (reference):
+		std::vector<Hit> reference(report.numRays);
+		std::vector<bool> referenceHit(report.numRays);
+		{
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < report.numRays; i++) {
+				const RayTriangle::Ray ray = RayTriangle::prepare(origins[i], directions[i]);
+				Hit closest = {};
+				closest.distance = INF;
+				for (size_t blockId = 0; blockId < m_blocks.size(); blockId++) {
+					const Block& block = m_blocks[blockId];
+					for (uint32_t t = 0; t < WIDTH && block.triangle[t] != NO_TRIANGLE; t++) {
+						float distance;
+						glm::vec3 barycentrics;
+						if (RayTriangle::cast(ray, glm::vec3(block.ax[t], block.ay[t], block.az[t]), glm::vec3(block.bx[t], block.by[t], block.bz[t]), glm::vec3(block.cx[t], block.cy[t], block.cz[t]),
+							distance, barycentrics) && distance < closest.distance) {
+							closest.distance = distance;
+							closest.triangle = block.triangle[t];
+							closest.barycentrics = barycentrics;
+						}
+					}
+				}
+				referenceHit[i] = !std::isinf(closest.distance);
+				reference[i] = closest;
+			}
+			report.scalarRate = rate(start);
+		}
+
+		// One ray against eight triangles:
+		const auto timeBlocks = [&](InstructionSet instructionSet) {
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::vector<Hit> hits(report.numRays);
+			std::vector<bool> hit(report.numRays);
+			for (size_t i = 0; i < report.numRays; i++)
+				hit[i] = raycastBlocks(instructionSet, m_blocks, origins[i], directions[i], hits[i]);
+			const float result = rate(start);
+			for (size_t i = 0; i < report.numRays; i++)
+				if (!sameHit(hit[i], hits[i], referenceHit[i], reference[i])) report.mismatches++;
+			return result;
+		};
+
+		// Eight rays against one triangle:
+		const auto timePackets = [&](InstructionSet instructionSet) {
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::vector<Hit> hits(report.numRays + WIDTH);
+			std::vector<uint32_t> masks((report.numRays + WIDTH - 1) / WIDTH);
+			for (size_t first = 0; first < report.numRays; first += WIDTH) {
+				RayTriangle::Ray rays[WIDTH];
+				const size_t numRays = std::min(static_cast<size_t>(WIDTH), report.numRays - first);
+				for (size_t i = 0; i < numRays; i++) rays[i] = RayTriangle::prepare(origins[first + i], directions[first + i]);
+				masks[first / WIDTH] = raycastPacket(instructionSet, m_blocks, RayPacket(rays, numRays), hits.data() + first);
+			}
+			const float result = rate(start);
+			for (size_t i = 0; i < report.numRays; i++)
+				if (!sameHit((masks[i / WIDTH] & (1u << (i % WIDTH))) != 0, hits[i], referenceHit[i], reference[i])) report.mismatches++;
+			return result;
+		};
+
+		report.blockFallbackRate = timeBlocks(INSTRUCTION_SET_SCALAR);
+		report.packetFallbackRate = timePackets(INSTRUCTION_SET_SCALAR);
+		if (report.instructionSet == INSTRUCTION_SET_AVX2) {
+			report.blockAVX2Rate = timeBlocks(INSTRUCTION_SET_AVX2);
+			report.packetAVX2Rate = timePackets(INSTRUCTION_SET_AVX2);
+		}
+		return report;
+	}
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include "RayTriangle.h"
+#include "Inputs.h"
+#include <vector>
+
+namespace Test {
+	/**
+	 * Eight-wide variants of the watertight ray/triangle kernel (RayTriangle) for the CPU ray queries:
+	 *	0. One ray against a block of eight triangles (the mesh gets copied to SoA blocks for that);
+	 *	1. Eight rays (RayPacket) against a single triangle.
+	 * Both perform the exact same operations in the same order as RayTriangle::cast() (no fused multiply-adds), so the hits, distances and barycentrics
+	 * are bit-identical to the scalar kernel (and the shaders).
+	 * AVX2 code paths get picked at runtime (see detectInstructionSet()); on the CPUs without AVX2 and on the non-x86 targets, lanes are simply tested one by one.
+	 */
+	class TrianglePackets {
+	public:
+		// Number of lanes per block and per ray packet.
+		enum { WIDTH = 8 };
+
+		// Triangle index of the padding lanes (padding triangles have all vertices at the origin and never get hit).
+		static const uint32_t NO_TRIANGLE = (~0u);
+
+		/**
+		 * Kernel implementation.
+		 */
+		enum InstructionSet : uint32_t {
+			// Portable fallback (lanes get tested one by one with RayTriangle::cast()).
+			INSTRUCTION_SET_SCALAR = 0,
+
+			// 256 bit AVX2 registers (all eight lanes at once).
+			INSTRUCTION_SET_AVX2 = 1
+		};
+
+		/**
+		 * Eight triangles in SoA layout.
+		 */
+		struct Block {
+			alignas(32) float ax[WIDTH];
+			alignas(32) float ay[WIDTH];
+			alignas(32) float az[WIDTH];
+			alignas(32) float bx[WIDTH];
+			alignas(32) float by[WIDTH];
+			alignas(32) float bz[WIDTH];
+			alignas(32) float cx[WIDTH];
+			alignas(32) float cy[WIDTH];
+			alignas(32) float cz[WIDTH];
+
+			// Index buffer offsets of the triangles (triangle index * 3; NO_TRIANGLE for the padding lanes).
+			alignas(32) uint32_t triangle[WIDTH];
+		};
+
+		/**
+		 * Eight prepared rays in SoA layout (see RayTriangle::Ray).
+		 */
+		struct RayPacket {
+			alignas(32) float originX[WIDTH];
+			alignas(32) float originY[WIDTH];
+			alignas(32) float originZ[WIDTH];
+
+			// Shear matrix elements (column * 3 + row).
+			alignas(32) float shear[9][WIDTH];
+
+			alignas(32) float invScale[WIDTH];
+
+			/**
+			Packs the rays (lanes past numRays repeat the last ray).
+			@param rays Prepared rays.
+			@param numRays Number of rays (1 - WIDTH).
+			*/
+			RayPacket(const RayTriangle::Ray* rays, size_t numRays);
+
+			/**
+			Unpacks a single ray.
+			@param lane Lane index.
+			@return prepared ray.
+			*/
+			RayTriangle::Ray lane(size_t lane)const;
+		};
+
+		/**
+		 * Hits of the eight lanes of a single test (valid only for the lanes, the mask has set).
+		 */
+		struct LaneHits {
+			alignas(32) float distance[WIDTH];
+			alignas(32) float u[WIDTH];
+			alignas(32) float v[WIDTH];
+			alignas(32) float w[WIDTH];
+		};
+
+		/**
+		 * Closest hit along a ray.
+		 */
+		struct Hit {
+			// Distance from the ray origin (in ray direction lengths).
+			float distance;
+
+			// Index buffer offset of the triangle (triangle index * 3).
+			uint32_t triangle;
+
+			// Weights of the triangle vertices at the hit point.
+			glm::vec3 barycentrics;
+		};
+
+		/**
+		 * Throughput of the kernels (closest hit against every single triangle; see benchmark()).
+		 */
+		struct BenchmarkReport {
+			// Number of rays, each kernel got timed on.
+			size_t numRays;
+
+			// Number of triangles, each ray got tested against.
+			size_t numTriangles;
+
+			// Best instruction set, the CPU supports.
+			InstructionSet instructionSet;
+
+			// Scalar RayTriangle::cast() loop (millions of rays per second).
+			float scalarRate;
+
+			// One ray against eight triangles with the portable fallback (millions of rays per second).
+			float blockFallbackRate;
+
+			// One ray against eight triangles with AVX2 (millions of rays per second; 0, if not supported).
+			float blockAVX2Rate;
+
+			// Eight rays against one triangle with the portable fallback (millions of rays per second).
+			float packetFallbackRate;
+
+			// Eight rays against one triangle with AVX2 (millions of rays per second; 0, if not supported).
+			float packetAVX2Rate;
+
+			// Number of closest hits, any of the eight-wide kernels disagreed with the scalar loop on (should always be 0).
+			size_t mismatches;
+		};
+
+		/**
+		Tells, which instruction set the CPU (and the OS) supports.
+		@return best supported instruction set.
+		*/
+		static InstructionSet detectInstructionSet();
+
+		/**
+		Copies the mesh triangles to SoA blocks (last block gets padded).
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param instructionSet Kernel implementation (anything, the CPU does not support, falls back to INSTRUCTION_SET_SCALAR).
+		*/
+		TrianglePackets(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, InstructionSet instructionSet = detectInstructionSet());
+
+		/**
+		Kernel implementation in use.
+		@return instruction set.
+		*/
+		InstructionSet instructionSet()const;
+
+		/**
+		Triangle blocks.
+		@return blocks in triangle order.
+		*/
+		const std::vector<Block>& blocks()const;
+
+		/**
+		Casts one ray on a block of eight triangles.
+		@param ray Prepared ray.
+		@param block Triangle block.
+		@param hits Hits per lane (written only for the hit lanes).
+		@return bit mask of the lanes, the ray hits.
+		*/
+		uint32_t cast(const RayTriangle::Ray& ray, const Block& block, LaneHits& hits)const;
+
+		/**
+		Casts eight rays on a single triangle.
+		@param rays Ray packet.
+		@param a First vertex.
+		@param b Second vertex.
+		@param c Third vertex.
+		@param hits Hits per lane (written only for the hit lanes).
+		@return bit mask of the rays, that hit the triangle.
+		*/
+		uint32_t cast(const RayPacket& rays, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, LaneHits& hits)const;
+
+		/**
+		Finds the closest hit of a single ray by testing all the blocks.
+		@param origin Ray origin.
+		@param direction Ray direction.
+		@param hit Closest hit (written only on hit).
+		@return true, if the ray hits anything.
+		*/
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, Hit& hit)const;
+
+		/**
+		Finds the closest hits of eight rays by testing every triangle against the whole packet.
+		@param rays Ray packet.
+		@param hits Closest hit per lane (written only for the hit lanes).
+		@return bit mask of the rays, that hit anything.
+		*/
+		uint32_t raycast(const RayPacket& rays, Hit hits[WIDTH])const;
+
+		/**
+		Times the eight-wide kernels against the scalar loop and compares the closest hits.
+		@param origins Ray origins.
+		@param directions Ray directions (same count as origins).
+		@return benchmark results.
+		*/
+		BenchmarkReport benchmark(const std::vector<glm::vec3>& origins, const std::vector<glm::vec3>& directions)const;
+
+
+	private:
+		InstructionSet m_instructionSet;
+		std::vector<Block> m_blocks;
+		size_t m_numTriangles;
+	};
+}
@@ -0,0 +1,23 @@
+#include "TriangleRecords.h"
+#include <algorithm>
+
+namespace Test {
+	std::vector<TriangleRecords::Record> TriangleRecords::build(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer) {
+		std::vector<Record> result(indexBuffer.size() / 3);
+		for (size_t i = 0; i < result.size(); i++) {
+			Record& record = result[i];
+			record.a = verts[indexBuffer[(i * 3)]].position;
+			record.b = verts[indexBuffer[(i * 3) + 1]].position;
+			record.c = verts[indexBuffer[(i * 3) + 2]].position;
+		}
+		return result;
+	}
+
+	TriangleRecords::TriangleRecords(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, 
+		void(*logFn)(const char*))
+		: records(device, std::max(static_cast<uint32_t>(indexBuffer.size() / 3), 1u), (indexBuffer.size() < 3) ? nullptr : build(verts, indexBuffer).data(), logFn) { }
+
+	bool TriangleRecords::initialized()const {
+		return (records.buffer() != VK_NULL_HANDLE);
+	}
+}
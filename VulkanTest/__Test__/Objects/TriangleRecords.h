@@ -0,0 +1,56 @@
+#pragma once
+#include "Buffers.h"
+#include "Inputs.h"
+
+namespace Test {
+	/**
+	 * Precomputed per-triangle intersection data (vertex positions, stored next to each other) for ray tracing.
+	 * With these, traversal loads a single 48 byte record per candidate triangle, instead of going through the index buffer and loading three full vertices;
+	 * shading attributes only get fetched once, for the closest hit.
+	 * Records are stored in triangle order, so the triangle references from VoxelGrid and BVH (index buffer offsets) map to records by dividing them by 3.
+	 */
+	struct TriangleRecords {
+		/**
+		 * Intersection data of a single triangle (same layout as TriangleRecord from the shaders).
+		 */
+		struct Record {
+			// Position of the first vertex.
+			alignas(16) glm::vec3 a;
+
+			// Position of the second vertex.
+			alignas(16) glm::vec3 b;
+
+			// Position of the third vertex (vertices are kept as they are, since the watertight test needs the shared ones to be identical).
+			alignas(16) glm::vec3 c;
+		};
+
+		/**
+		Calculates intersection records.
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@return one record per triangle.
+		*/
+		static std::vector<Record> build(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer);
+
+		/**
+		Calculates intersection records and uploads them to GPU.
+		@param device Logical device to upload to.
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param logFn One function that will help us if anything goes wrong.
+		*/
+		TriangleRecords(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, 
+			void(*logFn)(const char*) = nullptr);
+
+		/**
+		Tells if anything went wrong during initialisation.
+		@return true, if the buffer is allocated.
+		*/
+		bool initialized()const;
+
+
+
+		// Intersection records per triangle (meshes with no triangles get a single placeholder record).
+		const Buffer<Record, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> records;
+	};
+}
@@ -0,0 +1,1032 @@
+#include "VoxelData.h"
+#include "../CpuHelpers.h"
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define VOXEL_GRID_SSE
+#endif
+
+namespace {
+	struct Triangle {
+		glm::vec3 a, b, c;
+
+		inline Triangle(const glm::vec3& pa = {}, const glm::vec3& pb = {}, const glm::vec3& pc = {}) : a(pa), b(pb), c(pc) {}
+
+		inline void sortByMases(float am, float bm, float cm) {
+			if (am > bm) {
+				if (cm > am) std::swap(a, b); // b a c
+				else {
+					if (bm > cm) std::swap(a, c); // c b a
+					else { glm::vec3 tmp = a; a = b; b = c; c = tmp; } // b c a
+				}
+			}
+			else {
+				if (am > cm) { glm::vec3 tmp = a; a = c; c = b; b = tmp; } // c a b
+				else if (bm > cm) std::swap(b, c); // a c b
+			}
+		}
+	};
+
+	class AABB {
+	public:
+		glm::vec3 start, end;
+
+		inline bool intersects(const Triangle& t)const;
+
+
+	private:
+		inline bool intersectsTri(unsigned int dimm, Triangle t)const;
+		inline bool intersectsTri(unsigned int dimm, const Triangle& t, float av, float bv, float cv, float s, float e)const;
+	};
+
+
+	inline bool AABB::intersects(const Triangle& t)const {
+		return intersectsTri(0, t);
+	}
+
+	inline bool AABB::intersectsTri(unsigned int dimm, Triangle t)const {
+		if (dimm == 0) {
+			t.sortByMases(t.a.z, t.b.z, t.c.z);
+			return intersectsTri(dimm + 1, t, t.a.z, t.b.z, t.c.z, start.z, end.z);
+		}
+		else if (dimm == 1) {
+			t.sortByMases(t.a.x, t.b.x, t.c.x);
+			return intersectsTri(dimm + 1, t, t.a.x, t.b.x, t.c.x, start.x, end.x);
+		}
+		else if (dimm == 2) {
+			t.sortByMases(t.a.y, t.b.y, t.c.y);
+			return intersectsTri(dimm + 1, t, t.a.y, t.b.y, t.c.y, start.y, end.y);
+		}
+		else return true;
+	}
+#define CROSS_POINT(name, from, to, fromV, toV, barrier) glm::vec3 name = from + (to - from) * ((barrier - fromV) / (toV - fromV))
+	inline bool AABB::intersectsTri(unsigned int dimm, const Triangle& t, float av, float bv, float cv, float s, float e)const {
+		if (cv < s) return(false); // a b c | | (1)
+		if (av > e) return(false); // | | a b c (10)
+		if (av <= s) {
+			CROSS_POINT(asc, t.a, t.c, av, cv, s);
+			if (bv <= s) {
+				CROSS_POINT(bsc, t.b, t.c, bv, cv, s);
+				if (cv <= e) return(intersectsTri(dimm,  Triangle(asc, bsc, t.c))); // a b | c | (2)
+				else { // a b | | c (3)
+					CROSS_POINT(bec, t.b, t.c, bv, cv, e);
+					if (intersectsTri(dimm,  Triangle(bsc, bec, asc))) return(true);
+					CROSS_POINT(aec, t.a, t.c, av, cv, e);
+					return(intersectsTri(dimm,  Triangle(asc, bec, aec)));
+				}
+			}
+			else if (bv <= e) {
+				if (cv <= e) { // a | b c | (4)
+					if (intersectsTri(dimm,  Triangle(asc, t.b, t.c))) return(true);
+					CROSS_POINT(asb, t.a, t.b, av, bv, s);
+					return(intersectsTri(dimm,  Triangle(asc, asb, t.b)));
+				}
+				else { // a | b | c (5)
+					CROSS_POINT(asb, t.a, t.b, av, bv, s);
+					CROSS_POINT(bec, t.b, t.c, bv, cv, e);
+					if (intersectsTri(dimm,  Triangle(asb, t.b, bec))) return(true);
+					if (intersectsTri(dimm,  Triangle(asc, asb, bec))) return(true);
+					CROSS_POINT(aec, t.a, t.c, av, cv, e);
+					return(intersectsTri(dimm,  Triangle(asc, bec, aec)));
+				}
+			}
+			else { // a | | b c (6)
+				CROSS_POINT(asb, t.a, t.b, av, bv, s);
+				CROSS_POINT(aeb, t.a, t.b, av, bv, e);
+				if (intersectsTri(dimm,  Triangle(asc, asb, aeb))) return(true);
+				CROSS_POINT(aec, t.a, t.c, av, cv, e);
+				return(intersectsTri(dimm,  Triangle(asc, aeb, aec)));
+			}
+		}
+		else {
+			if (cv <= e) return(intersectsTri(dimm,  t)); // | a b c | (7)
+			else {
+				CROSS_POINT(aec, t.a, t.c, av, cv, e);
+				if (bv <= e) { // | a b | c (8)
+					CROSS_POINT(bec, t.b, t.c, bv, cv, e);
+					if (intersectsTri(dimm,  Triangle(t.a, t.b, bec))) return(true);
+					return(intersectsTri(dimm,  Triangle(t.a, aec, bec)));
+				}
+				else { // | a | b c (9)
+					CROSS_POINT(aeb, t.a, t.b, av, bv, e);
+					return(intersectsTri(dimm,  Triangle(t.a, aeb, aec)));
+				}
+			}
+		}
+	}
+#undef CROSS_POINT
+
+	/**
+	 * Triangle, prepared for separating axis overlap tests against grid cells of the same size.
+	 * For a fixed cell size, every potential separating axis boils down to a range of projections of the cell center, that do not separate the cell from the triangle,
+	 * so the per-cell part of the test is just 13 dot products and range checks (SSE version checks 4 cells at once).
+	 * Projections within rounding distance of a range bound are reported as undecided, so that the caller can settle them with the clipping test;
+	 * that way, both tests agree on every cell, instead of only on the ones the triangle does not barely touch.
+	 */
+	class SATTriangle {
+	public:
+		// Classification results.
+		enum { SEPARATED = 0, OVERLAPS = 1, UNDECIDED = 2 };
+
+		inline SATTriangle(const Triangle& t, const glm::vec3& halfSize, float coordinateScale);
+
+		inline int classify(const glm::vec3& center)const;
+
+#ifdef VOXEL_GRID_SSE
+		inline void classify(const __m128& centerX, const __m128& centerY, const __m128& centerZ, int& overlapMask, int& undecidedMask)const;
+#endif
+
+
+	private:
+		// Box normals, triangle normal and 9 cross products of box normals and triangle edges.
+		enum { NUM_AXIS = 13 };
+
+		glm::vec3 axis[NUM_AXIS];
+		float minProjection[NUM_AXIS];
+		float maxProjection[NUM_AXIS];
+		float tolerance[NUM_AXIS];
+	};
+
+	inline SATTriangle::SATTriangle(const Triangle& t, const glm::vec3& halfSize, float coordinateScale) {
+		// Rounding error bound of the projections, relative to the largest coordinate involved (generous, since undecided cells only cost a clipping test):
+		static const float RELATIVE_TOLERANCE = (64.0f * FLT_EPSILON);
+		const glm::vec3 edges[3] = { (t.b - t.a), (t.c - t.b), (t.a - t.c) };
+		const glm::vec3 normals[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+		for (size_t i = 0; i < 3; i++) axis[i] = normals[i];
+		axis[3] = glm::cross(edges[0], edges[1]);
+		for (size_t i = 0; i < 3; i++)
+			for (size_t j = 0; j < 3; j++)
+				axis[4 + (i * 3) + j] = glm::cross(normals[i], edges[j]);
+		for (size_t i = 0; i < NUM_AXIS; i++) {
+			const float a = glm::dot(axis[i], t.a);
+			const float b = glm::dot(axis[i], t.b);
+			const float c = glm::dot(axis[i], t.c);
+			const glm::vec3 absAxis = glm::abs(axis[i]);
+			const float radius = glm::dot(halfSize, absAxis);
+			minProjection[i] = std::min(std::min(a, b), c) - radius;
+			maxProjection[i] = std::max(std::max(a, b), c) + radius;
+			tolerance[i] = (RELATIVE_TOLERANCE * coordinateScale * (absAxis.x + absAxis.y + absAxis.z));
+		}
+	}
+
+	inline int SATTriangle::classify(const glm::vec3& center)const {
+		int result = OVERLAPS;
+		for (size_t i = 0; i < NUM_AXIS; i++) {
+			const float projection = glm::dot(axis[i], center);
+			if (projection < (minProjection[i] - tolerance[i]) || projection > (maxProjection[i] + tolerance[i])) return SEPARATED;
+			else if (projection < (minProjection[i] + tolerance[i]) || projection > (maxProjection[i] - tolerance[i])) result = UNDECIDED;
+		}
+		return result;
+	}
+
+#ifdef VOXEL_GRID_SSE
+	inline void SATTriangle::classify(const __m128& centerX, const __m128& centerY, const __m128& centerZ, int& overlapMask, int& undecidedMask)const {
+		__m128 notSeparated = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		__m128 inside = notSeparated;
+		for (size_t i = 0; i < NUM_AXIS; i++) {
+			const __m128 projection = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(axis[i].x), centerX), _mm_mul_ps(_mm_set1_ps(axis[i].y), centerY)), _mm_mul_ps(_mm_set1_ps(axis[i].z), centerZ));
+			const __m128 minBound = _mm_set1_ps(minProjection[i]);
+			const __m128 maxBound = _mm_set1_ps(maxProjection[i]);
+			const __m128 margin = _mm_set1_ps(tolerance[i]);
+			notSeparated = _mm_and_ps(notSeparated, _mm_and_ps(
+				_mm_cmpge_ps(projection, _mm_sub_ps(minBound, margin)), _mm_cmple_ps(projection, _mm_add_ps(maxBound, margin))));
+			if (_mm_movemask_ps(notSeparated) == 0) {
+				overlapMask = undecidedMask = 0;
+				return;
+			}
+			inside = _mm_and_ps(inside, _mm_and_ps(
+				_mm_cmpge_ps(projection, _mm_add_ps(minBound, margin)), _mm_cmple_ps(projection, _mm_sub_ps(maxBound, margin))));
+		}
+		overlapMask = _mm_movemask_ps(_mm_and_ps(notSeparated, inside));
+		undecidedMask = (_mm_movemask_ps(notSeparated) & (~overlapMask));
+	}
+#endif
+
+#define NO_VOXEL_ENTRY (~((Test::VoxelData::VoxelEntryId)0))
+
+	typedef Test::VoxelData VoxelData;
+
+	/**
+	 * Voxel lists, built by a single worker thread for a contiguous range of triangles.
+	 */
+	struct VoxelBins {
+		// Index of the last entry, added to each voxel (local to entries).
+		std::vector<VoxelData::VoxelEntryId> heads;
+
+		// Index of the first entry, added to each voxel (the one with no "next"; local to entries).
+		std::vector<VoxelData::VoxelEntryId> tails;
+
+		// Entries, linked within the bins.
+		std::vector<VoxelData::VoxelEntry> entries;
+	};
+
+	/**
+	Clipping test of a triangle against a single grid cell (the cell gets widened by FLT_EPSILON on each side).
+	@param triangle Triangle.
+	@param gridStart Lower left nearest corner of the grid.
+	@param cellSize Size of a single grid cell.
+	@param x Cell index on X axis.
+	@param y Cell index on Y axis.
+	@param z Cell index on Z axis.
+	@return true, if the triangle overlaps with the cell.
+	*/
+	inline static bool clippedTriangleOverlapsCell(const Triangle& triangle, const glm::vec3& gridStart, const glm::vec3& cellSize, uint32_t x, uint32_t y, uint32_t z) {
+		AABB cell;
+		{
+			cell.start = gridStart + cellSize * glm::vec3(x, y, z);
+			cell.end = cell.start + cellSize + FLT_EPSILON;
+			cell.start -= FLT_EPSILON;
+		}
+		return cell.intersects(triangle);
+	}
+
+	/**
+	Invokes callback for each grid cell within the given index range, that overlaps with the triangle.
+	@param triangle Triangle.
+	@param gridStart Lower left nearest corner of the grid.
+	@param cellSize Size of a single grid cell.
+	@param minIndex First cell to check.
+	@param maxIndex Last cell to check (inclusive).
+	@param overlapTest Triangle/cell overlap test implementation (both report the same cells).
+	@param callback Function, that will receive cell indices (x, y, z) of the overlapping cells.
+	*/
+	template<typename Callback>
+	inline static void forEachOverlappingCell(
+		const Triangle& triangle, const glm::vec3& gridStart, const glm::vec3& cellSize, const glm::uvec3& minIndex, const glm::uvec3& maxIndex,
+		VoxelData::OverlapTest overlapTest, const Callback& callback) {
+		if (overlapTest == VoxelData::OVERLAP_SAT) {
+			const glm::vec3 halfCell = (cellSize * 0.5f);
+			const glm::vec3 rangeEnd = glm::abs(gridStart + (cellSize * glm::vec3(maxIndex + 1u)));
+			const glm::vec3 maxCoordinate = glm::max(glm::max(glm::max(glm::abs(triangle.a), glm::abs(triangle.b)), glm::max(glm::abs(triangle.c), glm::abs(gridStart))), rangeEnd);
+			const SATTriangle satTriangle(triangle, halfCell + FLT_EPSILON, std::max(std::max(maxCoordinate.x, maxCoordinate.y), maxCoordinate.z));
+			for (uint32_t x = minIndex.x; x <= maxIndex.x; x++)
+				for (uint32_t y = minIndex.y; y <= maxIndex.y; y++) {
+#ifdef VOXEL_GRID_SSE
+					const __m128 centerX = _mm_set1_ps(gridStart.x + (cellSize.x * static_cast<float>(x)) + halfCell.x);
+					const __m128 centerY = _mm_set1_ps(gridStart.y + (cellSize.y * static_cast<float>(y)) + halfCell.y);
+					for (uint32_t z = minIndex.z; z <= maxIndex.z; z += 4) {
+						const __m128 cellZ = _mm_add_ps(_mm_set1_ps(static_cast<float>(z)), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+						const __m128 centerZ = _mm_add_ps(_mm_add_ps(_mm_set1_ps(gridStart.z), _mm_mul_ps(_mm_set1_ps(cellSize.z), cellZ)), _mm_set1_ps(halfCell.z));
+						int overlapMask, undecidedMask;
+						satTriangle.classify(centerX, centerY, centerZ, overlapMask, undecidedMask);
+						const uint32_t numCells = std::min(maxIndex.z - z + 1, 4u);
+						for (uint32_t i = 0; i < numCells; i++)
+							if ((overlapMask & (1 << i)) != 0
+								|| ((undecidedMask & (1 << i)) != 0 && clippedTriangleOverlapsCell(triangle, gridStart, cellSize, x, y, z + i))) callback(x, y, z + i);
+					}
+#else
+					for (uint32_t z = minIndex.z; z <= maxIndex.z; z++) {
+						const int overlap = satTriangle.classify(gridStart + (cellSize * glm::vec3(x, y, z)) + halfCell);
+						if (overlap == SATTriangle::OVERLAPS
+							|| (overlap == SATTriangle::UNDECIDED && clippedTriangleOverlapsCell(triangle, gridStart, cellSize, x, y, z))) callback(x, y, z);
+					}
+#endif
+				}
+		}
+		else {
+			for (uint32_t x = minIndex.x; x <= maxIndex.x; x++)
+				for (uint32_t y = minIndex.y; y <= maxIndex.y; y++)
+					for (uint32_t z = minIndex.z; z <= maxIndex.z; z++)
+						if (clippedTriangleOverlapsCell(triangle, gridStart, cellSize, x, y, z))
+							callback(x, y, z);
+		}
+	}
+
+	/**
+	Finds the range of cells, the bounding box of the triangle overlaps with.
+	@param settings Grid settings.
+	@param cellSize Size of a single grid cell.
+	@param triangle Triangle.
+	@param span Cell range to fill in (first gets greater than last, if the triangle is entirely outside the grid).
+	@return false, if the triangle is entirely outside the grid.
+	*/
+	inline static bool findCellSpan(const VoxelData::GridSettings& settings, const glm::vec3& cellSize, const Triangle& triangle, VoxelData::CellSpan& span) {
+		const glm::vec3 start = (glm::min(glm::min(triangle.a, triangle.b), triangle.c) - settings.gridStart) / cellSize;
+		const glm::vec3 end = (glm::max(glm::max(triangle.a, triangle.b), triangle.c) - settings.gridStart) / cellSize;
+		const glm::vec3 numDivisions = glm::vec3(settings.numDivisions);
+		if (end.x < 0.0f || end.y < 0.0f || end.z < 0.0f || start.x >= numDivisions.x || start.y >= numDivisions.y || start.z >= numDivisions.z) {
+			span.first = glm::uvec3(1, 1, 1);
+			span.last = glm::uvec3(0, 0, 0);
+			return false;
+		}
+		const glm::vec3 maxIndex = (numDivisions - 1.0f);
+		span.first = glm::uvec3(glm::clamp(start, glm::vec3(0.0f), maxIndex));
+		span.last = glm::uvec3(glm::clamp(end, glm::vec3(0.0f), maxIndex));
+		return true;
+	}
+
+	/**
+	Adds triangles from the given range to the voxel lists.
+	@param settings Grid settings.
+	@param verts Mesh vertices.
+	@param indexBuffer Mesh indices.
+	@param firstTriangle First triangle to add (triangle index, not the index within the index buffer).
+	@param endTriangle Triangle index after the last one to add.
+	@param heads Voxel list heads.
+	@param entries Voxel entries.
+	@param tails If not null, this one will record the first entry added to each voxel.
+	@param overlapTest Triangle/cell overlap test implementation.
+	@param triangleCells If not null, cell span of each triangle will be stored here (indexed by the triangle index).
+	*/
+	inline static void binTriangles(
+		const VoxelData::GridSettings& settings, const std::vector<Test::PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		size_t firstTriangle, size_t endTriangle,
+		std::vector<VoxelData::VoxelEntryId>& heads, std::vector<VoxelData::VoxelEntry>& entries, std::vector<VoxelData::VoxelEntryId>* tails,
+		VoxelData::OverlapTest overlapTest, VoxelData::CellSpan* triangleCells = nullptr) {
+		const glm::vec3 cellSize = (settings.gridEnd - settings.gridStart) / (glm::vec3)settings.numDivisions;
+		for (size_t i = (firstTriangle * 3) + 2; i < (endTriangle * 3); i += 3) {
+			const Triangle triangle(verts[indexBuffer[i - 2]].position, verts[indexBuffer[i - 1]].position, verts[indexBuffer[i]].position);
+			VoxelData::CellSpan span;
+			const bool insideGrid = findCellSpan(settings, cellSize, triangle, span);
+			if (triangleCells != nullptr) triangleCells[i / 3] = span;
+			if (!insideGrid) continue;
+			forEachOverlappingCell(triangle, settings.gridStart, cellSize, span.first, span.last, overlapTest, [&](uint32_t x, uint32_t y, uint32_t z) {
+				size_t voxelId = ((settings.numDivisions.x * ((static_cast<size_t>(z) * settings.numDivisions.y) + y)) + x);
+				VoxelData::VoxelEntry entry;
+				entry.triangle = static_cast<uint32_t>(i - 2);
+				entry.next = heads[voxelId];
+				if (tails != nullptr && entry.next == NO_VOXEL_ENTRY)
+					(*tails)[voxelId] = static_cast<VoxelData::VoxelEntryId>(entries.size());
+				heads[voxelId] = static_cast<VoxelData::VoxelEntryId>(entries.size());
+				entries.push_back(entry);
+				});
+		}
+	}
+
+	/**
+	Merges worker bins into a single set of linked lists.
+	@param bins Worker bins (in triangle order).
+	@param voxels Voxel list heads to fill in.
+	@param voxelEntries Voxel entries to fill in.
+	*/
+	inline static void mergeLinkedLists(
+		const std::vector<VoxelBins>& bins, std::vector<VoxelData::VoxelEntryId>& voxels, std::vector<VoxelData::VoxelEntry>& voxelEntries) {
+		const size_t numWorkers = bins.size();
+		const size_t numVoxels = voxels.size();
+
+		// Entries are concatenated in worker order, so that they end up in the same order as the single-threaded build would have placed them:
+		std::vector<VoxelData::VoxelEntryId> firstEntry(numWorkers);
+		{
+			size_t numEntries = 0;
+			for (size_t workerId = 0; workerId < numWorkers; workerId++) {
+				firstEntry[workerId] = static_cast<VoxelData::VoxelEntryId>(numEntries);
+				numEntries += bins[workerId].entries.size();
+			}
+			voxelEntries.resize(numEntries);
+		}
+		Test::runOnThreads(numWorkers, [&](size_t workerId) {
+			const std::vector<VoxelData::VoxelEntry>& entries = bins[workerId].entries;
+			const VoxelData::VoxelEntryId offset = firstEntry[workerId];
+			for (size_t i = 0; i < entries.size(); i++) {
+				VoxelData::VoxelEntry entry = entries[i];
+				if (entry.next != NO_VOXEL_ENTRY) entry.next += offset;
+				voxelEntries[offset + i] = entry;
+			}
+			});
+
+		// Last step is to link each worker's lists to the ones from the workers before it:
+		Test::runOnThreads(numWorkers, [&](size_t workerId) {
+			const size_t endVoxel = ((numVoxels * (workerId + 1)) / numWorkers);
+			for (size_t voxelId = ((numVoxels * workerId) / numWorkers); voxelId < endVoxel; voxelId++) {
+				VoxelData::VoxelEntryId head = NO_VOXEL_ENTRY;
+				for (size_t binId = 0; binId < numWorkers; binId++) {
+					const VoxelBins& workerBins = bins[binId];
+					if (workerBins.heads[voxelId] == NO_VOXEL_ENTRY) continue;
+					voxelEntries[firstEntry[binId] + workerBins.tails[voxelId]].next = head;
+					head = firstEntry[binId] + workerBins.heads[voxelId];
+				}
+				voxels[voxelId] = head;
+			}
+			});
+	}
+
+	/**
+	Packs worker bins into the compact layout (one pass to count voxel content, another one to fill the references in).
+	@param bins Worker bins (in triangle order).
+	@param voxelRanges Voxel content ranges to fill in (should already have the correct size).
+	@param triangleRefs Triangle reference buffer to fill in.
+	*/
+	inline static void packCompactLayout(
+		const std::vector<VoxelBins>& bins, std::vector<VoxelData::VoxelRange>& voxelRanges, std::vector<uint32_t>& triangleRefs) {
+		const size_t numWorkers = bins.size();
+		const size_t numVoxels = voxelRanges.size();
+
+		// Count:
+		Test::runOnThreads(numWorkers, [&](size_t workerId) {
+			const size_t endVoxel = ((numVoxels * (workerId + 1)) / numWorkers);
+			for (size_t voxelId = ((numVoxels * workerId) / numWorkers); voxelId < endVoxel; voxelId++) {
+				uint32_t count = 0;
+				for (size_t binId = 0; binId < numWorkers; binId++) {
+					const VoxelBins& workerBins = bins[binId];
+					for (VoxelData::VoxelEntryId entryId = workerBins.heads[voxelId]; entryId != NO_VOXEL_ENTRY; entryId = workerBins.entries[entryId].next)
+						count++;
+				}
+				voxelRanges[voxelId].count = count;
+			}
+			});
+
+		// Offsets:
+		{
+			uint32_t offset = 0;
+			for (size_t voxelId = 0; voxelId < numVoxels; voxelId++) {
+				voxelRanges[voxelId].offset = offset;
+				offset += voxelRanges[voxelId].count;
+			}
+			triangleRefs.resize(offset);
+		}
+
+		// Fill (lists are walked from the latest triangle to the earliest, so we fill the ranges from their ends):
+		Test::runOnThreads(numWorkers, [&](size_t workerId) {
+			const size_t endVoxel = ((numVoxels * (workerId + 1)) / numWorkers);
+			for (size_t voxelId = ((numVoxels * workerId) / numWorkers); voxelId < endVoxel; voxelId++) {
+				uint32_t refId = voxelRanges[voxelId].offset + voxelRanges[voxelId].count;
+				for (size_t binId = numWorkers; binId > 0; binId--) {
+					const VoxelBins& workerBins = bins[binId - 1];
+					for (VoxelData::VoxelEntryId entryId = workerBins.heads[voxelId]; entryId != NO_VOXEL_ENTRY; entryId = workerBins.entries[entryId].next) {
+						refId--;
+						triangleRefs[refId] = workerBins.entries[entryId].triangle;
+					}
+				}
+			}
+			});
+	}
+
+	/**
+	Splits dense cells of the compact layout into sub-grids.
+	@param settings Grid settings (subDivisions included).
+	@param verts Mesh vertices.
+	@param indexBuffer Mesh indices.
+	@param threshold Cells with more triangles than this get split.
+	@param numThreads Number of worker threads to use.
+	@param overlapTest Triangle/cell overlap test implementation.
+	@param voxelRanges Top-level voxel content ranges (sub-cell ranges get appended).
+	@param triangleRefs Triangle reference buffer (gets rebuilt).
+	*/
+	inline static void buildSubGrids(
+		const VoxelData::GridSettings& settings, const std::vector<Test::PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		uint32_t threshold, size_t numThreads, VoxelData::OverlapTest overlapTest, std::vector<VoxelData::VoxelRange>& voxelRanges, std::vector<uint32_t>& triangleRefs) {
+		const size_t numVoxels = voxelRanges.size();
+		std::vector<uint32_t> denseCells;
+		for (size_t voxelId = 0; voxelId < numVoxels; voxelId++)
+			if (voxelRanges[voxelId].count > threshold) denseCells.push_back(static_cast<uint32_t>(voxelId));
+		if (denseCells.empty()) return;
+
+		const glm::uvec3 subDivisions = settings.subDivisions;
+		const size_t numSubCells = static_cast<size_t>(subDivisions.x) * subDivisions.y * subDivisions.z;
+		const glm::vec3 cellSize = (settings.gridEnd - settings.gridStart) / (glm::vec3)settings.numDivisions;
+		const glm::vec3 subCellSize = cellSize / (glm::vec3)subDivisions;
+
+		// Each dense cell gets voxelized separately (sub-cell content keeps the ascending triangle order of the parent):
+		std::vector<std::vector<std::vector<uint32_t>>> subCellRefs(denseCells.size());
+		const size_t numWorkers = std::max(std::min(numThreads, denseCells.size()), static_cast<size_t>(1));
+		Test::runOnThreads(numWorkers, [&](size_t workerId) {
+			const size_t endCell = ((denseCells.size() * (workerId + 1)) / numWorkers);
+			for (size_t denseId = ((denseCells.size() * workerId) / numWorkers); denseId < endCell; denseId++) {
+				const uint32_t voxelId = denseCells[denseId];
+				const glm::uvec3 cellId = {
+					(voxelId % settings.numDivisions.x),
+					((voxelId / settings.numDivisions.x) % settings.numDivisions.y),
+					(voxelId / (settings.numDivisions.x * settings.numDivisions.y)) };
+				const glm::vec3 cellStart = settings.gridStart + cellSize * glm::vec3(cellId);
+				std::vector<std::vector<uint32_t>>& refs = subCellRefs[denseId];
+				refs.resize(numSubCells);
+
+				const VoxelData::VoxelRange range = voxelRanges[voxelId];
+				for (uint32_t refId = range.offset; refId < (range.offset + range.count); refId++) {
+					const uint32_t i = triangleRefs[refId];
+					const Triangle triangle(verts[indexBuffer[i]].position, verts[indexBuffer[i + 1]].position, verts[indexBuffer[i + 2]].position);
+					const glm::vec3 maxSubIndex = glm::vec3(subDivisions) - 1.0f;
+					const glm::uvec3 minIndex = glm::uvec3(glm::clamp(
+						(glm::min(glm::min(triangle.a, triangle.b), triangle.c) - cellStart) / subCellSize, glm::vec3(0.0f), maxSubIndex));
+					const glm::uvec3 maxIndex = glm::uvec3(glm::clamp(
+						(glm::max(glm::max(triangle.a, triangle.b), triangle.c) - cellStart) / subCellSize, glm::vec3(0.0f), maxSubIndex));
+					forEachOverlappingCell(triangle, cellStart, subCellSize, minIndex, maxIndex, overlapTest, [&](uint32_t x, uint32_t y, uint32_t z) {
+						refs[(subDivisions.x * ((static_cast<size_t>(z) * subDivisions.y) + y)) + x].push_back(i);
+						});
+				}
+			}
+			});
+
+		// Rebuilding the reference buffer (top-level cells first, sub-cells after them):
+		std::vector<uint32_t> refs;
+		for (size_t voxelId = 0; voxelId < numVoxels; voxelId++) {
+			VoxelData::VoxelRange& range = voxelRanges[voxelId];
+			if (range.count > threshold) continue;
+			const uint32_t offset = static_cast<uint32_t>(refs.size());
+			refs.insert(refs.end(), triangleRefs.begin() + range.offset, triangleRefs.begin() + range.offset + range.count);
+			range.offset = offset;
+		}
+		voxelRanges.reserve(numVoxels + (denseCells.size() * numSubCells));
+		for (size_t denseId = 0; denseId < denseCells.size(); denseId++) {
+			VoxelData::VoxelRange& range = voxelRanges[denseCells[denseId]];
+			range.offset = static_cast<uint32_t>(voxelRanges.size());
+			range.count = VoxelData::VoxelRange::SUB_GRID_FLAG;
+			const std::vector<std::vector<uint32_t>>& cellRefs = subCellRefs[denseId];
+			for (size_t subCellId = 0; subCellId < numSubCells; subCellId++) {
+				VoxelData::VoxelRange subRange;
+				subRange.offset = static_cast<uint32_t>(refs.size());
+				subRange.count = static_cast<uint32_t>(cellRefs[subCellId].size());
+				refs.insert(refs.end(), cellRefs[subCellId].begin(), cellRefs[subCellId].end());
+				voxelRanges.push_back(subRange);
+			}
+		}
+		triangleRefs.swap(refs);
+	}
+
+	/**
+	Turns a list of modified element indices into sorted ranges of adjacent elements.
+	@param indices Modified element indices (gets sorted; duplicates are fine).
+	@param ranges Ranges to fill in.
+	*/
+	inline static void mergeDirtyIndices(std::vector<uint32_t>& indices, std::vector<Test::BufferRange>& ranges) {
+		ranges.clear();
+		std::sort(indices.begin(), indices.end());
+		for (size_t i = 0; i < indices.size(); i++) {
+			if (!ranges.empty()) {
+				Test::BufferRange& last = ranges.back();
+				if (indices[i] < (last.first + last.count)) continue;
+				else if (indices[i] == (last.first + last.count)) {
+					last.count++;
+					continue;
+				}
+			}
+			ranges.push_back(Test::BufferRange{ indices[i], 1 });
+		}
+	}
+
+	/**
+	Tells, if a top-level voxel has no content (cells, split into sub-grids, are not empty).
+	@param data Voxel data.
+	@param voxelId Voxel index.
+	@return true, if the voxel is empty.
+	*/
+	inline static bool voxelEmpty(const VoxelData& data, size_t voxelId) {
+		return (data.layout == VoxelData::LAYOUT_COMPACT) ? (data.voxelRanges[voxelId].count == 0) : (data.voxels[voxelId] == NO_VOXEL_ENTRY);
+	}
+
+	/**
+	Recalculates Chebyshev distance to the nearest non-empty voxel for the top-level voxels within a box
+	(forward and backward raster passes with 3x3x3 half-masks, which is exact for this metric; voxels outside the box keep their distances and act as sources).
+	@param data Voxel data (voxels or voxelRanges have to be filled in).
+	@param distances Distances to update (has to hold a value per top-level voxel already).
+	@param first First voxel of the box per axis.
+	@param last Last voxel of the box per axis (inclusive).
+	*/
+	inline static void computeEmptyDistances(const VoxelData& data, std::vector<uint32_t>& distances, const glm::ivec3& first, const glm::ivec3& last) {
+		const glm::ivec3 numDivisions = glm::ivec3(data.settings.numDivisions);
+
+		// If there's nothing in the grid, any voxel can skip the whole thing:
+		const uint32_t maxDistance = static_cast<uint32_t>(std::max(std::max(numDivisions.x, numDivisions.y), numDivisions.z));
+		for (int z = first.z; z <= last.z; z++)
+			for (int y = first.y; y <= last.y; y++)
+				for (int x = first.x; x <= last.x; x++) {
+					const size_t voxelId = (numDivisions.x * ((static_cast<size_t>(z) * numDivisions.y) + y)) + x;
+					distances[voxelId] = voxelEmpty(data, voxelId) ? maxDistance : 0u;
+				}
+
+		// Each pass looks at the 13 neighbours, already visited in it's raster order:
+		for (int direction = 1; direction >= -1; direction -= 2) {
+			const glm::ivec3 start = (direction > 0) ? first : last;
+			const glm::ivec3 end = (direction > 0) ? last : first;
+			for (int z = start.z; (z - end.z) * direction <= 0; z += direction)
+				for (int y = start.y; (y - end.y) * direction <= 0; y += direction)
+					for (int x = start.x; (x - end.x) * direction <= 0; x += direction) {
+						uint32_t& distance = distances[(numDivisions.x * ((static_cast<size_t>(z) * numDivisions.y) + y)) + x];
+						if (distance == 0) continue;
+						for (int dz = -1; dz <= 0; dz++)
+							for (int dy = -1; dy <= 1; dy++)
+								for (int dx = -1; dx <= 1; dx++) {
+									if (dz == 0 && (dy > 0 || (dy == 0 && dx >= 0))) continue;
+									const glm::ivec3 neighbour = (glm::ivec3(x, y, z) + (glm::ivec3(dx, dy, dz) * direction));
+									if (neighbour.x < 0 || neighbour.y < 0 || neighbour.z < 0
+										|| neighbour.x >= numDivisions.x || neighbour.y >= numDivisions.y || neighbour.z >= numDivisions.z) continue;
+									distance = std::min(distance, distances[(numDivisions.x * ((static_cast<size_t>(neighbour.z) * numDivisions.y) + neighbour.y)) + neighbour.x] + 1);
+								}
+					}
+		}
+	}
+
+	/**
+	Calculates Chebyshev distance to the nearest non-empty voxel for each top-level voxel.
+	@param data Voxel data (voxels or voxelRanges have to be filled in).
+	@param distances Distances to fill in.
+	*/
+	inline static void computeEmptyDistances(const VoxelData& data, std::vector<uint32_t>& distances) {
+		const glm::ivec3 numDivisions = glm::ivec3(data.settings.numDivisions);
+		distances.resize(static_cast<size_t>(numDivisions.x) * numDivisions.y * numDivisions.z);
+		computeEmptyDistances(data, distances, glm::ivec3(0, 0, 0), (numDivisions - 1));
+	}
+
+	/**
+	Walks grid cells along a ray, the same way the voxel traversal shader does (triangle tests are left out, so the ray always walks all the way through).
+	Regular steps leave a single cell, while skips leave the entire box of empty cells around it; skipped cells are not reported.
+	@param gridStart Lower left nearest corner of the grid.
+	@param gridEnd Upper right furthest corner of the grid.
+	@param divisions Number of cells per axis.
+	@param origin Ray origin.
+	@param direction Ray direction.
+	@param emptyDistances Empty space distance per cell (nullptr disables skipping).
+	@param visitCell Invoked with the flattened index of each visited cell.
+	*/
+	template<typename VisitCell>
+	inline static void walkCells(const glm::vec3& gridStart, const glm::vec3& gridEnd, const glm::uvec3& divisions,
+		const glm::vec3& origin, const glm::vec3& direction, const uint32_t* emptyDistances, const VisitCell& visitCell) {
+		const glm::vec3 cellSize = (gridEnd - gridStart) / (glm::vec3)divisions;
+		const glm::ivec3 numDivisions = glm::ivec3(divisions);
+		const glm::vec3 invDirection = (1.0f / direction);
+
+		// Entering the grid:
+		float time;
+		{
+			const glm::vec3 startTime = ((gridStart - origin) * invDirection);
+			const glm::vec3 endTime = ((gridEnd - origin) * invDirection);
+			const glm::vec3 minTime = glm::min(startTime, endTime);
+			const glm::vec3 maxTime = glm::max(startTime, endTime);
+			const float enterTime = std::max(std::max(minTime.x, minTime.y), minTime.z);
+			const float exitTime = std::min(std::min(maxTime.x, maxTime.y), maxTime.z);
+			if (enterTime > exitTime || exitTime < 0.0f) return;
+			time = std::max(enterTime, 0.0f);
+		}
+		glm::ivec3 cellId = glm::clamp(glm::ivec3(((origin + (direction * time)) - gridStart) / cellSize), glm::ivec3(0), numDivisions - 1);
+
+		while (true) {
+			const size_t cellIndex = (numDivisions.x * ((static_cast<size_t>(cellId.z) * numDivisions.y) + cellId.y)) + cellId.x;
+			const uint32_t emptyDistance = (emptyDistances != nullptr) ? emptyDistances[cellIndex] : 0u;
+			glm::ivec3 boxFirst = cellId;
+			glm::ivec3 boxLast = cellId;
+			if (emptyDistance > 1) {
+				boxFirst = glm::max(cellId - static_cast<int>(emptyDistance - 1), glm::ivec3(0));
+				boxLast = glm::min(cellId + static_cast<int>(emptyDistance - 1), numDivisions - 1);
+			}
+			else visitCell(cellIndex);
+
+			float exitTime = std::numeric_limits<float>::infinity();
+			int exitAxis = -1;
+			for (int axis = 0; axis < 3; axis++) {
+				if (direction[axis] == 0.0f) continue;
+				const int boundary = (direction[axis] > 0.0f) ? (boxLast[axis] + 1) : boxFirst[axis];
+				const float boundaryTime = ((gridStart[axis] + (cellSize[axis] * static_cast<float>(boundary)) - origin[axis]) * invDirection[axis]);
+				if (boundaryTime < exitTime) {
+					exitTime = boundaryTime;
+					exitAxis = axis;
+				}
+			}
+			if (exitAxis < 0) return;
+			time = std::max(time, exitTime);
+			cellId = glm::clamp(glm::ivec3(((origin + (direction * time)) - gridStart) / cellSize), boxFirst, boxLast);
+			cellId[exitAxis] = (direction[exitAxis] > 0.0f) ? (boxLast[exitAxis] + 1) : (boxFirst[exitAxis] - 1);
+			if (cellId[exitAxis] < 0 || cellId[exitAxis] >= numDivisions[exitAxis]) return;
+		}
+	}
+
+	// Automatic resolution selection never goes above this many cells per axis:
+	static const uint32_t MAX_AUTO_DIVISIONS = 256;
+
+	/**
+	Calculates grid bounds for given vertices (slightly expanded, so that nothing lies exactly on the boundary).
+	@param verts Mesh vertices.
+	@param start Lower left nearest corner of the bounds.
+	@param end Upper right furthest corner of the bounds.
+	*/
+	inline static void computeBounds(const std::vector<Test::PNCVertex>& verts, glm::vec3& start, glm::vec3& end) {
+		{
+			glm::vec3 first = (verts.size() <= 0 ? glm::vec3{ 0.0f, 0.0f, 0.0f } : verts[0].position);
+			start = first;
+			end = first;
+		}
+		for (size_t i = 0; i < verts.size(); i++) {
+			const glm::vec3 pos = verts[i].position;
+			if (start.x > pos.x) start.x = pos.x;
+			if (start.y > pos.y) start.y = pos.y;
+			if (start.z > pos.z) start.z = pos.z;
+			if (end.x < pos.x) end.x = pos.x;
+			if (end.y < pos.y) end.y = pos.y;
+			if (end.z < pos.z) end.z = pos.z;
+		}
+		{
+			start -= FLT_EPSILON * 32;
+			end += FLT_EPSILON * 32;
+		}
+	}
+
+	/**
+	Picks per-axis grid resolution, so that the cells are roughly cubic and there are about cellsPerTriangle cells per triangle.
+	@param start Lower left nearest corner of the grid.
+	@param end Upper right furthest corner of the grid.
+	@param numTriangles Number of triangles within the grid.
+	@param cellsPerTriangle Desired cell count per triangle.
+	@return number of cells per axis.
+	*/
+	inline static glm::uvec3 pickDivisions(const glm::vec3& start, const glm::vec3& end, size_t numTriangles, float cellsPerTriangle) {
+		glm::vec3 size = (end - start);
+		// Flat geometry would make the volume zero, so the axes get at least some thickness:
+		size = glm::max(size, glm::vec3(std::max(std::max(size.x, size.y), size.z) * 0.01f));
+		const float volume = (size.x * size.y * size.z);
+		if (volume <= 0.0f || numTriangles <= 0 || cellsPerTriangle <= 0.0f) return glm::uvec3(1, 1, 1);
+		const float cellsPerUnit = std::cbrt((cellsPerTriangle * static_cast<float>(numTriangles)) / volume);
+		const glm::vec3 divisions = glm::clamp(glm::round(size * cellsPerUnit), glm::vec3(1.0f), glm::vec3(static_cast<float>(MAX_AUTO_DIVISIONS)));
+		return glm::uvec3(divisions);
+	}
+}
+
+namespace Test {
+	VoxelData::VoxelData(const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, const glm::uvec3& numDivisions, uint32_t numThreads, Layout dataLayout, 
+		uint32_t subGridThreshold, const glm::uvec3& subDivisions, OverlapTest overlapTest)
+		: layout(dataLayout) {
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		const size_t numTriangles = (indexBuffer.size() / 3);
+		settings = computeSettings(verts, indexBuffer, numDivisions, subDivisions);
+		const size_t numVoxels = static_cast<size_t>(settings.numDivisions.x) * settings.numDivisions.y * settings.numDivisions.z;
+		const size_t numWorkers = std::max(std::min(static_cast<size_t>(numThreads), numTriangles), static_cast<size_t>(1));
+		if (layout == LAYOUT_LINKED_LIST) triangleCells.resize(numTriangles);
+		if (layout == LAYOUT_LINKED_LIST && numWorkers <= 1) {
+			voxels.resize(numVoxels, NO_VOXEL_ENTRY);
+			binTriangles(settings, verts, indexBuffer, 0, numTriangles, voxels, voxelEntries, nullptr, overlapTest, triangleCells.data());
+		}
+		else {
+			// Each worker bins a contiguous range of triangles into it's own lists:
+			std::vector<VoxelBins> bins(numWorkers);
+			runOnThreads(numWorkers, [&](size_t workerId) {
+				VoxelBins& workerBins = bins[workerId];
+				workerBins.heads.resize(numVoxels, NO_VOXEL_ENTRY);
+				workerBins.tails.resize(numVoxels, NO_VOXEL_ENTRY);
+				binTriangles(settings, verts, indexBuffer,
+					((numTriangles * workerId) / numWorkers), ((numTriangles * (workerId + 1)) / numWorkers),
+					workerBins.heads, workerBins.entries, &workerBins.tails, overlapTest, (layout == LAYOUT_LINKED_LIST) ? triangleCells.data() : nullptr);
+				});
+
+			if (layout == LAYOUT_COMPACT) {
+				voxelRanges.resize(numVoxels);
+				packCompactLayout(bins, voxelRanges, triangleRefs);
+				if (subGridThreshold > 0)
+					buildSubGrids(settings, verts, indexBuffer, subGridThreshold, numWorkers, overlapTest, voxelRanges, triangleRefs);
+			}
+			else {
+				voxels.resize(numVoxels, NO_VOXEL_ENTRY);
+				mergeLinkedLists(bins, voxels, voxelEntries);
+			}
+		}
+		computeEmptyDistances(*this, emptyDistances);
+
+		// Build report:
+		{
+			std::vector<uint32_t> cellSizes;
+			if (layout == LAYOUT_COMPACT) {
+				report.numSubGrids = 0;
+				for (size_t voxelId = 0; voxelId < numVoxels; voxelId++)
+					if ((voxelRanges[voxelId].count & VoxelRange::SUB_GRID_FLAG) != 0) report.numSubGrids++;
+					else cellSizes.push_back(voxelRanges[voxelId].count);
+				for (size_t rangeId = numVoxels; rangeId < voxelRanges.size(); rangeId++)
+					cellSizes.push_back(voxelRanges[rangeId].count);
+				report.totalRefs = triangleRefs.size();
+			}
+			else {
+				report.numSubGrids = 0;
+				cellSizes.resize(numVoxels, 0);
+				for (size_t voxelId = 0; voxelId < numVoxels; voxelId++)
+					for (VoxelEntryId entryId = voxels[voxelId]; entryId != NO_VOXEL_ENTRY; entryId = voxelEntries[entryId].next)
+						cellSizes[voxelId]++;
+				report.totalRefs = voxelEntries.size();
+			}
+			report.numDivisions = settings.numDivisions;
+			report.numCells = cellSizes.size();
+			size_t numEmptyCells = 0;
+			report.maxRefsPerCell = 0;
+			for (size_t i = 0; i < cellSizes.size(); i++) {
+				if (cellSizes[i] <= 0) numEmptyCells++;
+				if (report.maxRefsPerCell < cellSizes[i]) report.maxRefsPerCell = cellSizes[i];
+			}
+			report.emptyCellRatio = (cellSizes.empty() ? 0.0f : (static_cast<float>(numEmptyCells) / static_cast<float>(cellSizes.size())));
+			report.meanRefsPerCell = (cellSizes.empty() ? 0.0f : (static_cast<float>(report.totalRefs) / static_cast<float>(cellSizes.size())));
+			report.buildTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+		}
+	}
+
+	bool VoxelData::update(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const std::vector<uint32_t>& changedTriangles,
+		DirtyRanges* dirtyRanges, OverlapTest overlapTest, size_t entryCapacity) {
+		if (layout != LAYOUT_LINKED_LIST || (indexBuffer.size() / 3) != triangleCells.size()) return false;
+		std::vector<uint32_t> triangles = changedTriangles;
+		{
+			std::sort(triangles.begin(), triangles.end());
+			triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+			if (!triangles.empty() && triangles.back() >= triangleCells.size()) return false;
+		}
+
+		// Cells, the triangles overlap with at their new positions (collected before anything gets modified, so that running out of entryCapacity leaves the grid intact):
+		const glm::vec3 cellSize = (settings.gridEnd - settings.gridStart) / (glm::vec3)settings.numDivisions;
+		std::vector<CellSpan> spans(triangles.size());
+		std::vector<std::pair<uint32_t, uint32_t>> overlaps;
+		for (size_t i = 0; i < triangles.size(); i++) {
+			const uint32_t triangle = (triangles[i] * 3);
+			const Triangle vertices(verts[indexBuffer[triangle]].position, verts[indexBuffer[triangle + 1]].position, verts[indexBuffer[triangle + 2]].position);
+			if (!findCellSpan(settings, cellSize, vertices, spans[i])) continue;
+			forEachOverlappingCell(vertices, settings.gridStart, cellSize, spans[i].first, spans[i].last, overlapTest, [&](uint32_t x, uint32_t y, uint32_t z) {
+				overlaps.push_back(std::make_pair(((settings.numDivisions.x * ((z * settings.numDivisions.y) + y)) + x), triangle));
+				});
+		}
+		{
+			// Every entry of a changed triangle gets freed before the new ones are added:
+			size_t numRemoved = 0;
+			for (size_t i = 0; i < triangles.size(); i++) {
+				const uint32_t triangle = (triangles[i] * 3);
+				const CellSpan& span = triangleCells[triangles[i]];
+				for (uint32_t z = span.first.z; z <= span.last.z; z++)
+					for (uint32_t y = span.first.y; y <= span.last.y; y++)
+						for (uint32_t x = span.first.x; x <= span.last.x; x++)
+							for (VoxelEntryId entryId = voxels[(settings.numDivisions.x * ((z * settings.numDivisions.y) + y)) + x]; entryId != NO_VOXEL_ENTRY; entryId = voxelEntries[entryId].next)
+								if (voxelEntries[entryId].triangle == triangle) numRemoved++;
+			}
+			const size_t numReusable = (freeEntries.size() + numRemoved);
+			if (overlaps.size() > numReusable && (voxelEntries.size() + (overlaps.size() - numReusable)) > entryCapacity) return false;
+		}
+		std::vector<uint32_t> dirtyVoxels, dirtyEntries;
+
+		// Unlinking old entries (only the cells from the old spans can contain them):
+		for (size_t i = 0; i < triangles.size(); i++) {
+			const uint32_t triangle = (triangles[i] * 3);
+			const CellSpan span = triangleCells[triangles[i]];
+			for (uint32_t z = span.first.z; z <= span.last.z; z++)
+				for (uint32_t y = span.first.y; y <= span.last.y; y++)
+					for (uint32_t x = span.first.x; x <= span.last.x; x++) {
+						const uint32_t voxelId = ((settings.numDivisions.x * ((z * settings.numDivisions.y) + y)) + x);
+						VoxelEntryId previous = NO_VOXEL_ENTRY;
+						VoxelEntryId entryId = voxels[voxelId];
+						while (entryId != NO_VOXEL_ENTRY) {
+							const VoxelEntryId next = voxelEntries[entryId].next;
+							if (voxelEntries[entryId].triangle == triangle) {
+								if (previous == NO_VOXEL_ENTRY) {
+									voxels[voxelId] = next;
+									dirtyVoxels.push_back(voxelId);
+								}
+								else {
+									voxelEntries[previous].next = next;
+									dirtyEntries.push_back(previous);
+								}
+								freeEntries.push_back(entryId);
+							}
+							else previous = entryId;
+							entryId = next;
+						}
+					}
+			triangleCells[triangles[i]] = spans[i];
+		}
+
+		// Linking the triangles at their new positions (freed entries get reused first):
+		for (size_t i = 0; i < overlaps.size(); i++) {
+			const uint32_t voxelId = overlaps[i].first;
+			VoxelEntryId entryId;
+			if (freeEntries.empty()) {
+				entryId = static_cast<VoxelEntryId>(voxelEntries.size());
+				voxelEntries.push_back(VoxelEntry());
+			}
+			else {
+				entryId = freeEntries.back();
+				freeEntries.pop_back();
+			}
+			voxelEntries[entryId].triangle = overlaps[i].second;
+			voxelEntries[entryId].next = voxels[voxelId];
+			voxels[voxelId] = entryId;
+			dirtyEntries.push_back(entryId);
+			dirtyVoxels.push_back(voxelId);
+		}
+
+		// Empty space distances only have to be recalculated, if some voxels became empty or stopped being empty;
+		// no distance can change further than the largest old distance from such a voxel, so only that neighbourhood gets recalculated:
+		std::vector<uint32_t> dirtyDistances;
+		{
+			const glm::ivec3 numDivisions = glm::ivec3(settings.numDivisions);
+			glm::ivec3 first = numDivisions, last(-1, -1, -1);
+			for (size_t i = 0; i < dirtyVoxels.size(); i++) {
+				const uint32_t voxelId = dirtyVoxels[i];
+				if ((voxels[voxelId] == NO_VOXEL_ENTRY) == (emptyDistances[voxelId] > 0)) continue;
+				const glm::ivec3 cell(voxelId % numDivisions.x, (voxelId / numDivisions.x) % numDivisions.y, voxelId / (numDivisions.x * numDivisions.y));
+				first = glm::min(first, cell);
+				last = glm::max(last, cell);
+			}
+			if (last.x >= 0) {
+				const int radius = static_cast<int>(*std::max_element(emptyDistances.begin(), emptyDistances.end()));
+				first = glm::max(first - radius, glm::ivec3(0, 0, 0));
+				last = glm::min(last + radius, numDivisions - 1);
+				std::vector<uint32_t> oldDistances;
+				for (int z = first.z; z <= last.z; z++)
+					for (int y = first.y; y <= last.y; y++)
+						for (int x = first.x; x <= last.x; x++)
+							oldDistances.push_back(emptyDistances[(numDivisions.x * ((static_cast<size_t>(z) * numDivisions.y) + y)) + x]);
+				computeEmptyDistances(*this, emptyDistances, first, last);
+				size_t boxId = 0;
+				for (int z = first.z; z <= last.z; z++)
+					for (int y = first.y; y <= last.y; y++)
+						for (int x = first.x; x <= last.x; x++) {
+							const uint32_t voxelId = static_cast<uint32_t>((numDivisions.x * ((static_cast<size_t>(z) * numDivisions.y) + y)) + x);
+							if (emptyDistances[voxelId] != oldDistances[boxId++]) dirtyDistances.push_back(voxelId);
+						}
+			}
+		}
+
+		report.totalRefs = (voxelEntries.size() - freeEntries.size());
+		if (dirtyRanges != nullptr) {
+			mergeDirtyIndices(dirtyVoxels, dirtyRanges->voxels);
+			mergeDirtyIndices(dirtyEntries, dirtyRanges->voxelEntries);
+			mergeDirtyIndices(dirtyDistances, dirtyRanges->emptyDistances);
+		}
+		return true;
+	}
+
+	uint32_t VoxelData::countVisitedCells(const glm::vec3& origin, const glm::vec3& direction, bool skipEmptySpace)const {
+		uint32_t numVisited = 0;
+		walkCells(settings.gridStart, settings.gridEnd, settings.numDivisions, origin, direction,
+			skipEmptySpace ? emptyDistances.data() : nullptr, [&](size_t) { numVisited++; });
+		return numVisited;
+	}
+
+	uint32_t VoxelData::countTriangleTests(const glm::vec3& origin, const glm::vec3& direction, uint32_t mailboxSize, uint32_t* savedTests)const {
+		// Same ring as the one in RayTracedDiffuseVox.frag (oldest entry gets overwritten first):
+		std::vector<uint32_t> mailbox;
+		mailbox.reserve(mailboxSize);
+		size_t mailboxNext = 0;
+		uint32_t numTests = 0;
+		uint32_t numSaved = 0;
+		auto testTriangle = [&](uint32_t triangle) {
+			if (std::find(mailbox.begin(), mailbox.end(), triangle) != mailbox.end()) {
+				numSaved++;
+				return;
+			}
+			numTests++;
+			if (mailboxSize <= 0) return;
+			if (mailbox.size() < mailboxSize) mailbox.push_back(triangle);
+			else mailbox[mailboxNext] = triangle;
+			mailboxNext = ((mailboxNext + 1) % mailboxSize);
+		};
+		auto testRange = [&](const VoxelRange& range) {
+			for (uint32_t refId = range.offset; refId < (range.offset + range.count); refId++)
+				testTriangle(triangleRefs[refId]);
+		};
+
+		const glm::vec3 cellSize = (settings.gridEnd - settings.gridStart) / (glm::vec3)settings.numDivisions;
+		walkCells(settings.gridStart, settings.gridEnd, settings.numDivisions, origin, direction, emptyDistances.data(), [&](size_t voxelId) {
+			if (layout == LAYOUT_LINKED_LIST) {
+				for (VoxelEntryId entryId = voxels[voxelId]; entryId != NO_VOXEL_ENTRY; entryId = voxelEntries[entryId].next)
+					testTriangle(voxelEntries[entryId].triangle);
+			}
+			else if ((voxelRanges[voxelId].count & VoxelRange::SUB_GRID_FLAG) == 0) testRange(voxelRanges[voxelId]);
+			else {
+				const uint32_t firstSubCell = voxelRanges[voxelId].offset;
+				const glm::uvec3 cellId(
+					voxelId % settings.numDivisions.x,
+					(voxelId / settings.numDivisions.x) % settings.numDivisions.y,
+					voxelId / (static_cast<size_t>(settings.numDivisions.x) * settings.numDivisions.y));
+				const glm::vec3 cellStart = (settings.gridStart + (cellSize * glm::vec3(cellId)));
+				walkCells(cellStart, cellStart + cellSize, settings.subDivisions, origin, direction, nullptr, [&](size_t subCellId) {
+					testRange(voxelRanges[firstSubCell + subCellId]);
+				});
+			}
+		});
+		if (savedTests != nullptr) (*savedTests) = numSaved;
+		return numTests;
+	}
+
+	VoxelData::GridSettings VoxelData::computeSettings(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, 
+		const glm::uvec3& numDivisions, const glm::uvec3& subDivisions) {
+		GridSettings settings = {};
+		computeBounds(verts, settings.gridStart, settings.gridEnd);
+		const glm::uvec3 pickedDivisions = pickDivisions(settings.gridStart, settings.gridEnd, (indexBuffer.size() / 3), DEFAULT_CELLS_PER_TRIANGLE);
+		settings.numDivisions = {
+			(numDivisions.x > 0 ? numDivisions.x : pickedDivisions.x),
+			(numDivisions.y > 0 ? numDivisions.y : pickedDivisions.y),
+			(numDivisions.z > 0 ? numDivisions.z : pickedDivisions.z) };
+		settings.subDivisions = glm::max(subDivisions, glm::uvec3(1, 1, 1));
+		return settings;
+	}
+
+	glm::uvec3 VoxelData::autoDivisions(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, float cellsPerTriangle) {
+		glm::vec3 start, end;
+		computeBounds(verts, start, end);
+		return pickDivisions(start, end, (indexBuffer.size() / 3), cellsPerTriangle);
+	}
+
+	VoxelData::OverlapBenchmark VoxelData::benchmarkOverlapTests(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		const glm::uvec3& numDivisions, OverlapTest overlapTest) {
+		OverlapBenchmark report = {};
+		const GridSettings settings = computeSettings(verts, indexBuffer, numDivisions);
+		const glm::vec3 cellSize = (settings.gridEnd - settings.gridStart) / (glm::vec3)settings.numDivisions;
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 2; i < indexBuffer.size(); i += 3) {
+			const Triangle triangle(verts[indexBuffer[i - 2]].position, verts[indexBuffer[i - 1]].position, verts[indexBuffer[i]].position);
+			CellSpan span;
+			if (!findCellSpan(settings, cellSize, triangle, span)) continue;
+			const glm::uvec3 spanSize = (span.last - span.first + 1u);
+			report.numTests += (static_cast<size_t>(spanSize.x) * spanSize.y * spanSize.z);
+			forEachOverlappingCell(triangle, settings.gridStart, cellSize, span.first, span.last, overlapTest, [&](uint32_t, uint32_t, uint32_t) { report.numOverlaps++; });
+		}
+		const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+		report.testTime = (report.numTests > 0) ? (seconds * 1000000000.0f / static_cast<float>(report.numTests)) : 0.0f;
+		return report;
+	}
+}
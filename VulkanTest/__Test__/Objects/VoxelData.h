@@ -0,0 +1,278 @@
+#pragma once
+#include "BufferRange.h"
+#include "Inputs.h"
+#include <cstdint>
+
+namespace Test {
+	/**
+	 * CPU "Clone" of the voxel grid, containing settings, voxels and entries.
+	 * Does not depend on the graphics API, so the CPU side tools (VoxelTraversal, SoftwareRenderer, Benchmark.cpp) can build and query grids without Vulkan; VoxelGrid uploads it to GPU.
+	 */
+	struct VoxelData {
+		/**
+		 * Basic description of a voxel grid.
+		 */
+		struct GridSettings {
+			// Lower left nearest corner of the entire voxelized volume.
+			alignas(16) glm::vec3 gridStart;
+
+			// Upper right furthest corner of the entire voxelized volume.
+			alignas(16) glm::vec3 gridEnd;
+
+			// Number of voxel cells per axis.
+			alignas(16) glm::uvec3 numDivisions;
+
+			// Number of sub-grid cells per axis, for the cells that got split into sub-grids (compact layout only).
+			alignas(16) glm::uvec3 subDivisions;
+		};
+
+		/**
+		 * We buld our voxel grid as follows:
+		 * We have a flattened grid buffer in memory that holds the index of the first "Entry" for each voxel.
+		 * Entry is basically a linked list of triangle indices and nothing else. 
+		 * We will be using uints for indexing and here's a type definition for safety.
+		 */
+		typedef uint32_t VoxelEntryId;
+
+		/**
+		 * Represents voxel content.
+		 */
+		struct VoxelEntry {
+			// Triangle inside the voxel.
+			uint32_t triangle;
+
+			// Index of the next voxel entry in the linked list of entries.
+			VoxelEntryId next;
+		};
+
+		/**
+		 * Range of voxel content within the triangle reference buffer (used by the compact layout).
+		 * If count has SUB_GRID_FLAG set, the voxel got split into a sub-grid and offset is the index of the first sub-cell range within voxelRanges
+		 * (sub-cell ranges are flattened just like the top-level ones and always point to the triangle references directly).
+		 */
+		struct VoxelRange {
+			// Flag, telling that the range points to sub-cell ranges instead of triangle references.
+			static constexpr uint32_t SUB_GRID_FLAG = (1u << 31);
+
+			// Index of the first triangle reference of the voxel.
+			uint32_t offset;
+
+			// Number of triangle references, stored for the voxel.
+			uint32_t count;
+		};
+
+		/**
+		 * Triangle/cell overlap test, used during voxelization.
+		 */
+		enum OverlapTest : uint32_t {
+			// Recursive clipping of the triangle against the cell slabs.
+			OVERLAP_CLIPPING = 0,
+
+			// Separating axis test (several cells per triangle at once with SSE, scalar fallback otherwise; cells, the triangle barely touches, get clipped).
+			OVERLAP_SAT = 1
+		};
+
+		/**
+		 * Statistics, gathered during the build (lets us tune resolution for memory versus traversal cost).
+		 */
+		struct BuildReport {
+			// Number of top-level voxel cells per axis, the grid ended up with.
+			glm::uvec3 numDivisions;
+
+			// Number of top-level cells that got split into sub-grids.
+			uint32_t numSubGrids;
+
+			// Number of cells holding triangle references directly (top-level cells that did not get split, as well as all the sub-grid cells).
+			size_t numCells;
+
+			// Fraction of numCells with no triangles inside.
+			float emptyCellRatio;
+
+			// Average number of triangle references per cell.
+			float meanRefsPerCell;
+
+			// Largest number of triangle references within a single cell.
+			uint32_t maxRefsPerCell;
+
+			// Total number of triangle references.
+			size_t totalRefs;
+
+			// Build time in seconds.
+			float buildTime;
+		};
+
+		/**
+		 * Range of cells, a triangle got checked against during binning (linked list layout keeps one per triangle, so that the triangle can be found and removed later).
+		 * Triangles that fall outside the grid have first greater than last.
+		 */
+		struct CellSpan {
+			// First cell index per axis.
+			glm::uvec3 first;
+
+			// Last cell index per axis (inclusive).
+			glm::uvec3 last;
+		};
+
+		/**
+		 * Buffer ranges, modified by update().
+		 */
+		struct DirtyRanges {
+			// Modified ranges of voxels.
+			std::vector<BufferRange> voxels;
+
+			// Modified ranges of voxelEntries.
+			std::vector<BufferRange> voxelEntries;
+
+			// Modified ranges of emptyDistances.
+			std::vector<BufferRange> emptyDistances;
+		};
+
+		/**
+		 * Memory layout of voxel content.
+		 */
+		enum Layout : uint32_t {
+			// Each voxel holds an index of the first entry from voxelEntries, where each entry references the next one (voxels and voxelEntries get filled).
+			LAYOUT_LINKED_LIST = 0,
+
+			// Each voxel holds a range within a single contiguous buffer of triangle references (voxelRanges and triangleRefs get filled).
+			LAYOUT_COMPACT = 1
+		};
+
+
+
+		// Settings.
+		GridSettings settings;
+
+		// Layout of the voxel content.
+		Layout layout;
+
+		// Voxel buffer (linked list layout).
+		std::vector<VoxelEntryId> voxels;
+
+		// Voxel entry buffer (linked list layout).
+		std::vector<VoxelEntry> voxelEntries;
+
+		// Voxel content ranges within triangleRefs (compact layout; top-level cells come first, followed by sub-grid cells).
+		std::vector<VoxelRange> voxelRanges;
+
+		// Triangle references, grouped per voxel (compact layout; within each voxel, triangles are sorted in ascending order; VoxelGridBuilder does not keep that order on GPU).
+		std::vector<uint32_t> triangleRefs;
+
+		// Chebyshev distance (in cells) from each top-level voxel to the nearest non-empty one (0 for non-empty voxels; both layouts);
+		// All the cells within (distance - 1) cells of the voxel along each axis are empty, so the traversal can leave that box in a single step.
+		std::vector<uint32_t> emptyDistances;
+
+		// Cells, each triangle got checked against (linked list layout; used by update()).
+		std::vector<CellSpan> triangleCells;
+
+		// Entries, no longer referenced by any voxel after update() (linked list layout; these get reused before voxelEntries grows).
+		std::vector<VoxelEntryId> freeEntries;
+
+		// Build statistics.
+		BuildReport report;
+
+		/**
+		Bulds voxel grid.
+		Note: When numThreads is greater than 1, triangles are split between worker threads, each binning into it's own set of lists;
+			lists are merged in triangle order afterwards, so the content of voxels and voxelEntries is identical to the single-threaded build.
+			Compact layout is generated from the same lists in two passes: first one counts voxel content and the second one fills in the references.
+			After that, compact layout cells with more than subGridThreshold triangles get split into sub-grids (linked list layout ignores this).
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param numDivisions Number of top-level voxel cells per axis (zero components get picked automatically; see autoDivisions()).
+		@param numThreads Number of worker threads to use for the build (0 and 1 both mean "build on the calling thread").
+		@param dataLayout Memory layout of the voxel content.
+		@param subGridThreshold Cells with more triangles than this get their own sub-grid (0 means "no sub-grids").
+		@param subDivisions Number of sub-grid cells per axis.
+		@param overlapTest Triangle/cell overlap test implementation (both give the same cells; SAT only pays off for triangles, spanning many cells).
+		*/
+		VoxelData(const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, const glm::uvec3& numDivisions = {32, 32, 32}, uint32_t numThreads = 1, Layout dataLayout = LAYOUT_LINKED_LIST,
+			uint32_t subGridThreshold = 0, const glm::uvec3& subDivisions = {4, 4, 4}, OverlapTest overlapTest = OVERLAP_CLIPPING);
+
+		/**
+		Re-bins triangles that have moved since the build (or the last update).
+		Note: Only the lists of the cells, the triangles used to overlap, get walked to remove them, so the cost depends on the number of changed triangles and not on the scene size;
+			grid bounds and resolution stay the same, so parts of the triangles that leave the original bounds are simply not voxelized (rebuild, if the scene changes a lot).
+			Only the linked list layout can be updated.
+		@param verts Mesh vertices (new positions).
+		@param indexBuffer Mesh indices (has to be the same as the one the grid was built with).
+		@param changedTriangles Indices of the triangles that moved (triangle index, not the index within the index buffer).
+		@param dirtyRanges If not null, this one will receive the ranges of voxels, voxelEntries and emptyDistances that got modified (sorted and merged; previous content gets discarded).
+		@param overlapTest Triangle/cell overlap test implementation (should match the one, the grid was built with).
+		@param entryCapacity Maximal size of voxelEntries after the update (VoxelGrid::entries.size() for the grids, mirrored on GPU).
+		@return false, if the layout does not support updates, indexBuffer or any of the changedTriangles do not match the grid or the entries would not fit in entryCapacity
+			(nothing gets modified in that case).
+		*/
+		bool update(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const std::vector<uint32_t>& changedTriangles,
+			DirtyRanges* dirtyRanges = nullptr, OverlapTest overlapTest = OVERLAP_CLIPPING, size_t entryCapacity = SIZE_MAX);
+
+		/**
+		Counts top-level cells, the shader traversal visits along a ray (CPU mirror of raycast() from RayTracedDiffuseVox.frag, with triangle tests left out,
+		so the ray always walks all the way through the grid; cells, jumped over by empty space skipping, are not counted).
+		@param origin Ray origin.
+		@param direction Ray direction.
+		@param skipEmptySpace If true, boxes of empty cells are skipped using emptyDistances.
+		@return number of visited cells (0, if the ray misses the grid).
+		*/
+		uint32_t countVisitedCells(const glm::vec3& origin, const glm::vec3& direction, bool skipEmptySpace)const;
+
+		/**
+		Counts triangle intersection tests along a ray (same traversal as countVisitedCells, with empty space skipping, sub-grids included),
+		with a per-ray mailbox of recently tested triangles, like the one in RayTracedDiffuseVox.frag.
+		@param origin Ray origin.
+		@param direction Ray direction.
+		@param mailboxSize Number of recently tested triangles to remember (0 means no mailboxing).
+		@param savedTests If not nullptr, receives the number of tests, the mailbox let us skip.
+		@return number of performed tests.
+		*/
+		uint32_t countTriangleTests(const glm::vec3& origin, const glm::vec3& direction, uint32_t mailboxSize, uint32_t* savedTests = nullptr)const;
+
+		/**
+		Calculates grid settings the same way the constructor does (useful for the grids that get built on GPU).
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param numDivisions Number of top-level voxel cells per axis (zero components get picked automatically).
+		@param subDivisions Number of sub-grid cells per axis.
+		@return grid settings.
+		*/
+		static GridSettings computeSettings(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, 
+			const glm::uvec3& numDivisions = { 32, 32, 32 }, const glm::uvec3& subDivisions = { 4, 4, 4 });
+
+		// Number of cells per triangle, automatic resolution selection aims for by default.
+		static constexpr float DEFAULT_CELLS_PER_TRIANGLE = 2.0f;
+
+		/**
+		Picks voxel grid resolution from the triangle count and the aspect ratio of the mesh bounds (cells are kept roughly cubic).
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param cellsPerTriangle Desired number of cells per triangle (higher values trade memory for shorter per-cell triangle lists).
+		@return number of voxel cells per axis.
+		*/
+		static glm::uvec3 autoDivisions(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, float cellsPerTriangle = DEFAULT_CELLS_PER_TRIANGLE);
+
+		/**
+		 * Triangle/cell overlap test micro-benchmark results (see benchmarkOverlapTests()).
+		 */
+		struct OverlapBenchmark {
+			// Number of triangle/cell tests (every cell within the bounding box of each triangle).
+			size_t numTests;
+
+			// Number of the tests, that reported an overlap.
+			size_t numOverlaps;
+
+			// Average time per test (nanoseconds).
+			float testTime;
+		};
+
+		/**
+		Times the triangle/cell overlap test on its own (same cells get tested as during the build, but nothing gets binned).
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param numDivisions Number of top-level voxel cells per axis (zero components get picked automatically).
+		@param overlapTest Triangle/cell overlap test implementation.
+		@return benchmark results.
+		*/
+		static OverlapBenchmark benchmarkOverlapTests(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+			const glm::uvec3& numDivisions, OverlapTest overlapTest);
+	};
+}
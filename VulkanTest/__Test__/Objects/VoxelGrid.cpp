@@ -1,184 +1,115 @@
 #include "VoxelGrid.h"
-#include <algorithm>
+#include "VoxelGridCache.h"
+#include <cstring>
 
 namespace {
-	struct Triangle {
-		glm::vec3 a, b, c;
-
-		inline Triangle(const glm::vec3& pa = {}, const glm::vec3& pb = {}, const glm::vec3& pc = {}) : a(pa), b(pb), c(pc) {}
-
-		inline void sortByMases(float am, float bm, float cm) {
-			if (am > bm) {
-				if (cm > am) std::swap(a, b); // b a c
-				else {
-					if (bm > cm) std::swap(a, c); // c b a
-					else { glm::vec3 tmp = a; a = b; b = c; c = tmp; } // b c a
-				}
-			}
-			else {
-				if (am > cm) { glm::vec3 tmp = a; a = c; c = b; b = tmp; } // c a b
-				else if (bm > cm) std::swap(b, c); // a c b
-			}
-		}
-	};
-
-	class AABB {
-	public:
-		glm::vec3 start, end;
-
-		inline bool intersects(const Triangle& t)const;
-
-
-	private:
-		inline bool intersectsTri(unsigned int dimm, Triangle t)const;
-		inline bool intersectsTri(unsigned int dimm, const Triangle& t, float av, float bv, float cv, float s, float e)const;
-	};
+	typedef Test::VoxelData VoxelData;
 
+	/**
+	Vulkan does not allow empty buffers, so the ones, not used by the voxel layout, get a single (uninitialized) element.
+	@param content Buffer content.
+	@return number of elements to allocate.
+	*/
+	template<typename Type>
+	inline static uint32_t bufferSize(const std::vector<Type>& content) {
+		return content.empty() ? 1u : static_cast<uint32_t>(content.size());
+	}
 
-	inline bool AABB::intersects(const Triangle& t)const {
-		return intersectsTri(0, t);
+	/**
+	Initial buffer content (nullptr for empty buffers).
+	@param content Buffer content.
+	@return pointer to the initial data.
+	*/
+	template<typename Type>
+	inline static const Type* bufferData(const std::vector<Type>& content) {
+		return content.empty() ? nullptr : content.data();
 	}
 
-	inline bool AABB::intersectsTri(unsigned int dimm, Triangle t)const {
-		if (dimm == 0) {
-			t.sortByMases(t.a.z, t.b.z, t.c.z);
-			return intersectsTri(dimm + 1, t, t.a.z, t.b.z, t.c.z, start.z, end.z);
-		}
-		else if (dimm == 1) {
-			t.sortByMases(t.a.x, t.b.x, t.c.x);
-			return intersectsTri(dimm + 1, t, t.a.x, t.b.x, t.c.x, start.x, end.x);
-		}
-		else if (dimm == 2) {
-			t.sortByMases(t.a.y, t.b.y, t.c.y);
-			return intersectsTri(dimm + 1, t, t.a.y, t.b.y, t.c.y, start.y, end.y);
-		}
-		else return true;
+	/**
+	Build report for the grids that do not get built on CPU.
+	@param numDivisions Number of voxel cells per axis.
+	@return report with everything but numDivisions set to zero.
+	*/
+	inline static VoxelData::BuildReport emptyReport(const glm::uvec3& numDivisions) {
+		VoxelData::BuildReport report = {};
+		report.numDivisions = numDivisions;
+		return report;
 	}
-#define CROSS_POINT(name, from, to, fromV, toV, barrier) glm::vec3 name = from + (to - from) * ((barrier - fromV) / (toV - fromV))
-	inline bool AABB::intersectsTri(unsigned int dimm, const Triangle& t, float av, float bv, float cv, float s, float e)const {
-		if (cv < s) return(false); // a b c | | (1)
-		if (av > e) return(false); // | | a b c (10)
-		if (av <= s) {
-			CROSS_POINT(asc, t.a, t.c, av, cv, s);
-			if (bv <= s) {
-				CROSS_POINT(bsc, t.b, t.c, bv, cv, s);
-				if (cv <= e) return(intersectsTri(dimm,  Triangle(asc, bsc, t.c))); // a b | c | (2)
-				else { // a b | | c (3)
-					CROSS_POINT(bec, t.b, t.c, bv, cv, e);
-					if (intersectsTri(dimm,  Triangle(bsc, bec, asc))) return(true);
-					CROSS_POINT(aec, t.a, t.c, av, cv, e);
-					return(intersectsTri(dimm,  Triangle(asc, bec, aec)));
-				}
-			}
-			else if (bv <= e) {
-				if (cv <= e) { // a | b c | (4)
-					if (intersectsTri(dimm,  Triangle(asc, t.b, t.c))) return(true);
-					CROSS_POINT(asb, t.a, t.b, av, bv, s);
-					return(intersectsTri(dimm,  Triangle(asc, asb, t.b)));
-				}
-				else { // a | b | c (5)
-					CROSS_POINT(asb, t.a, t.b, av, bv, s);
-					CROSS_POINT(bec, t.b, t.c, bv, cv, e);
-					if (intersectsTri(dimm,  Triangle(asb, t.b, bec))) return(true);
-					if (intersectsTri(dimm,  Triangle(asc, asb, bec))) return(true);
-					CROSS_POINT(aec, t.a, t.c, av, cv, e);
-					return(intersectsTri(dimm,  Triangle(asc, bec, aec)));
-				}
-			}
-			else { // a | | b c (6)
-				CROSS_POINT(asb, t.a, t.b, av, bv, s);
-				CROSS_POINT(aeb, t.a, t.b, av, bv, e);
-				if (intersectsTri(dimm,  Triangle(asc, asb, aeb))) return(true);
-				CROSS_POINT(aec, t.a, t.c, av, cv, e);
-				return(intersectsTri(dimm,  Triangle(asc, aeb, aec)));
-			}
-		}
-		else {
-			if (cv <= e) return(intersectsTri(dimm,  t)); // | a b c | (7)
-			else {
-				CROSS_POINT(aec, t.a, t.c, av, cv, e);
-				if (bv <= e) { // | a b | c (8)
-					CROSS_POINT(bec, t.b, t.c, bv, cv, e);
-					if (intersectsTri(dimm,  Triangle(t.a, t.b, bec))) return(true);
-					return(intersectsTri(dimm,  Triangle(t.a, aec, bec)));
-				}
-				else { // | a | b c (9)
-					CROSS_POINT(aeb, t.a, t.b, av, bv, e);
-					return(intersectsTri(dimm,  Triangle(t.a, aeb, aec)));
-				}
-			}
-		}
+
+	/**
+	Same as bufferSize(), but for the content that is not stored in a vector (memory mapped cache, for example).
+	@param count Number of elements.
+	@return number of elements to allocate.
+	*/
+	inline static uint32_t bufferSize(uint32_t count) {
+		return (count <= 0) ? 1u : count;
 	}
-#undef CROSS_POINT
 
-#define NO_VOXEL_ENTRY (~((Test::VoxelGrid::VoxelData::VoxelEntryId)0))
+	/**
+	Same as bufferData(), but for the content that is not stored in a vector.
+	@param content Content.
+	@param count Number of elements.
+	@return pointer to the initial data.
+	*/
+	template<typename Type>
+	inline static const Type* bufferData(const Type* content, uint32_t count) {
+		return (count <= 0) ? nullptr : content;
+	}
 }
 
 namespace Test {
-	VoxelGrid::VoxelData::VoxelData(const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, const glm::uvec3& numDivisions) {
-		{
-			glm::vec3 first = (verts.size() <= 0 ? glm::vec3{ 0.0f, 0.0f, 0.0f } : verts[0].position);
-			settings.gridStart = first;
-			settings.gridEnd = first;
-			settings.numDivisions = numDivisions;
-		}
-		for (size_t i = 0; i < verts.size(); i++) {
-			const glm::vec3 pos = verts[i].position;
-			if (settings.gridStart.x > pos.x) settings.gridStart.x = pos.x;
-			if (settings.gridStart.y > pos.y) settings.gridStart.y = pos.y;
-			if (settings.gridStart.z > pos.z) settings.gridStart.z = pos.z;
-			if (settings.gridEnd.x < pos.x) settings.gridEnd.x = pos.x;
-			if (settings.gridEnd.y < pos.y) settings.gridEnd.y = pos.y;
-			if (settings.gridEnd.z < pos.z) settings.gridEnd.z = pos.z;
-		}
-		{
-			settings.gridStart -= FLT_EPSILON * 32;
-			settings.gridEnd += FLT_EPSILON * 32;
-		}
-		voxels.resize(static_cast<size_t>(settings.numDivisions.x) * settings.numDivisions.y * settings.numDivisions.z, NO_VOXEL_ENTRY);
-		const glm::vec3 cellSize = (settings.gridEnd - settings.gridStart) / (glm::vec3)settings.numDivisions;
-		for (size_t i = 2; i < indexBuffer.size(); i += 3) {
-			const Triangle triangle(verts[indexBuffer[i - 2]].position, verts[indexBuffer[i - 1]].position, verts[indexBuffer[i]].position);
-			glm::uvec3 minIndex = {
-				static_cast<uint32_t>((std::min(std::min(triangle.a.x, triangle.b.x), triangle.c.x) - settings.gridStart.x) / cellSize.x),
-				static_cast<uint32_t>((std::min(std::min(triangle.a.y, triangle.b.y), triangle.c.y) - settings.gridStart.y) / cellSize.y),
-				static_cast<uint32_t>((std::min(std::min(triangle.a.z, triangle.b.z), triangle.c.z) - settings.gridStart.z) / cellSize.z)
-			};
-			glm::uvec3 maxIndex = {
-				static_cast<uint32_t>((std::max(std::max(triangle.a.x, triangle.b.x), triangle.c.x) - settings.gridStart.x) / cellSize.x),
-				static_cast<uint32_t>((std::max(std::max(triangle.a.y, triangle.b.y), triangle.c.y) - settings.gridStart.y) / cellSize.y),
-				static_cast<uint32_t>((std::max(std::max(triangle.a.z, triangle.b.z), triangle.c.z) - settings.gridStart.z) / cellSize.z)
-			};
-			for (uint32_t x = minIndex.x; x <= maxIndex.x; x++)
-				for (uint32_t y = minIndex.y; y <= maxIndex.y; y++)
-					for (uint32_t z = minIndex.z; z <= maxIndex.z; z++) {
-						AABB cell;
-						{
-							cell.start = settings.gridStart + cellSize * glm::vec3(x, y, z);
-							cell.end = cell.start + cellSize + FLT_EPSILON;
-							cell.start -= FLT_EPSILON;
-						}
-						if (cell.intersects(triangle)) {
-							size_t voxelId = ((settings.numDivisions.x * ((static_cast<size_t>(z) * settings.numDivisions.y) + y)) + x);
-							VoxelEntry entry;
-							entry.triangle = static_cast<uint32_t>(i - 2);
-							entry.next = voxels[voxelId];
-							voxels[voxelId] = static_cast<VoxelEntryId>(voxelEntries.size());
-							voxelEntries.push_back(entry);
-						}
-					}
+	VoxelGrid::VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const VoxelData& data, uint32_t spareEntries, void(*logFn)(const char*)) 
+		: layout(data.layout), report(data.report)
+		, settings(device, &data.settings, logFn)
+		, voxels(device, bufferSize(data.voxels), bufferData(data.voxels), logFn)
+		, entries(device, bufferSize(data.voxelEntries) + ((data.layout == VoxelData::LAYOUT_LINKED_LIST) ? spareEntries : 0u), 
+			(data.layout == VoxelData::LAYOUT_LINKED_LIST && spareEntries > 0) ? nullptr : bufferData(data.voxelEntries), logFn)
+		, voxelRanges(device, bufferSize(data.voxelRanges), bufferData(data.voxelRanges), logFn)
+		, triangleRefs(device, bufferSize(data.triangleRefs), bufferData(data.triangleRefs), logFn)
+		, emptyDistances(device, bufferSize(data.emptyDistances), bufferData(data.emptyDistances), logFn) {
+		// Spare entries are not part of the data, so the initial content has to be copied over manually:
+		if (data.layout == VoxelData::LAYOUT_LINKED_LIST && spareEntries > 0 && !data.voxelEntries.empty() && entries.buffer() != VK_NULL_HANDLE) {
+			VoxelData::VoxelEntry* content = entries.mapForWrite();
+			memcpy(content, data.voxelEntries.data(), sizeof(VoxelData::VoxelEntry) * data.voxelEntries.size());
+			entries.unmap();
 		}
 	}
 
-	VoxelGrid::VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const VoxelData& data, void(*logFn)(const char*)) 
-		: settings(device, &data.settings, logFn)
-		, voxels(device, static_cast<uint32_t>(data.voxels.size()), data.voxels.data(), logFn)
-		, entries(device, static_cast<uint32_t>(data.voxelEntries.size()), data.voxelEntries.data(), logFn) { }
+	VoxelGrid::VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const VoxelGridCache& cache, void(*logFn)(const char*))
+		: layout(cache.layout()), report(cache.report())
+		, settings(device, &cache.settings(), logFn)
+		, voxels(device, bufferSize(cache.numVoxels()), bufferData(cache.voxels(), cache.numVoxels()), logFn)
+		, entries(device, bufferSize(cache.numVoxelEntries()), bufferData(cache.voxelEntries(), cache.numVoxelEntries()), logFn)
+		, voxelRanges(device, bufferSize(cache.numVoxelRanges()), bufferData(cache.voxelRanges(), cache.numVoxelRanges()), logFn)
+		, triangleRefs(device, bufferSize(cache.numTriangleRefs()), bufferData(cache.triangleRefs(), cache.numTriangleRefs()), logFn)
+		, emptyDistances(device, bufferSize(cache.numEmptyDistances()), bufferData(cache.emptyDistances(), cache.numEmptyDistances()), logFn) { }
+
+	VoxelGrid::VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const VoxelData::GridSettings& gridSettings, uint32_t refCapacity, void(*logFn)(const char*))
+		: layout(VoxelData::LAYOUT_COMPACT), report(emptyReport(gridSettings.numDivisions))
+		, settings(device, &gridSettings, logFn)
+		, voxels(device, 1u, nullptr, logFn)
+		, entries(device, 1u, nullptr, logFn)
+		, voxelRanges(device, bufferSize(gridSettings.numDivisions.x * gridSettings.numDivisions.y * gridSettings.numDivisions.z), nullptr, logFn)
+		, triangleRefs(device, bufferSize(refCapacity), nullptr, logFn)
+		, emptyDistances(device, bufferSize(gridSettings.numDivisions.x * gridSettings.numDivisions.y * gridSettings.numDivisions.z),
+			std::vector<uint32_t>(bufferSize(gridSettings.numDivisions.x * gridSettings.numDivisions.y * gridSettings.numDivisions.z), 0u).data(), logFn) { }
 
-	VoxelGrid::VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, const glm::uvec3& numDivisions, void(*logFn)(const char*))
-		: VoxelGrid(device, VoxelData(verts, indexBuffer, numDivisions), logFn) { }
+	VoxelGrid::VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, 
+		const glm::uvec3& numDivisions, uint32_t numThreads, VoxelData::Layout dataLayout, uint32_t subGridThreshold, const glm::uvec3& subDivisions, 
+		VoxelData::OverlapTest overlapTest, void(*logFn)(const char*))
+		: VoxelGrid(device, VoxelData(verts, indexBuffer, numDivisions, numThreads, dataLayout, subGridThreshold, subDivisions, overlapTest), 0, logFn) { }
 
 	bool VoxelGrid::initialized()const {
-		return (settings.stagingBuffer() != VK_NULL_HANDLE && voxels.buffer() != VK_NULL_HANDLE && entries.buffer() != VK_NULL_HANDLE);
+		return (settings.stagingBuffer() != VK_NULL_HANDLE && voxels.buffer() != VK_NULL_HANDLE && entries.buffer() != VK_NULL_HANDLE
+			&& voxelRanges.buffer() != VK_NULL_HANDLE && triangleRefs.buffer() != VK_NULL_HANDLE && emptyDistances.buffer() != VK_NULL_HANDLE);
+	}
+
+	bool VoxelGrid::update(const VoxelData& data, const VoxelData::DirtyRanges& dirtyRanges) {
+		if (data.layout != VoxelData::LAYOUT_LINKED_LIST || layout != VoxelData::LAYOUT_LINKED_LIST) return false;
+		else if (data.voxels.size() != voxels.size() || data.voxelEntries.size() > entries.size()) return false;
+		voxels.setContent(data.voxels.data(), dirtyRanges.voxels);
+		entries.setContent(data.voxelEntries.data(), dirtyRanges.voxelEntries);
+		emptyDistances.setContent(data.emptyDistances.data(), dirtyRanges.emptyDistances);
+		return true;
 	}
 }
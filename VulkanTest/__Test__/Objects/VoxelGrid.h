@@ -1,91 +1,61 @@
 #pragma once
 #include "Buffers.h"
-#include "Inputs.h"
+#include "VoxelData.h"
 
 namespace Test {
+	class VoxelGridCache;
+
 	/**
 	 * Represents a voxel grid for arbitrary geometry.
 	 * This, alongside with corresponding mesh can be used for faster ray tracing.
+	 * GPU side of VoxelData (see VoxelData.h for the CPU build).
 	 */
 	struct VoxelGrid {
-		/**
-		 * CPU "Clone" of the voxel grid, containing settings, voxels and entries.
-		 */
-		struct VoxelData {
-			/**
-			 * Basic description of a voxel grid.
-			 */
-			struct GridSettings {
-				// Lower left nearest corner of the entire voxelized volume.
-				alignas(16) glm::vec3 gridStart;
-
-				// Upper right furthest corner of the entire voxelized volume.
-				alignas(16) glm::vec3 gridEnd;
-
-				// Number of voxel cells per axis.
-				alignas(16) glm::uvec3 numDivisions;
-			};
-
-			/**
-			 * We buld our voxel grid as follows:
-			 * We have a flattened grid buffer in memory that holds the index of the first "Entry" for each voxel.
-			 * Entry is basically a linked list of triangle indices and nothing else. 
-			 * We will be using uints for indexing and here's a type definition for safety.
-			 */
-			typedef uint32_t VoxelEntryId;
-
-			/**
-			 * Represents voxel content.
-			 */
-			struct VoxelEntry {
-				// Triangle inside the voxel.
-				uint32_t triangle;
-
-				// Index of the next voxel entry in the linked list of entries.
-				VoxelEntryId next;
-			};
-
-
-
-			// Settings.
-			GridSettings settings;
-
-			// Voxel buffer.
-			std::vector<VoxelEntryId> voxels;
-
-			// Voxel entry buffer.
-			std::vector<VoxelEntry> voxelEntries;
-
-			/**
-			Bulds voxel grid.
-			@param verts Mesh vertices.
-			@param indexBuffer Mesh indices.
-			@param numDivisions Number of voxel cells per axis.
-			*/
-			VoxelData(const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, const glm::uvec3& numDivisions = {32, 32, 32});
-		};
-
-		
-
-
-
 		/**
 		Uploads existing voxel data to GPU.
 		@param device Logical device to upload to.
 		@param data Baked voxel data.
+		@param spareEntries Number of extra elements to allocate within the entry buffer, so that updates can add entries without a rebuild (linked list layout only).
+		@param logFn One function that will help us if anything goes wrong.
+		*/
+		VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const VoxelData& data, uint32_t spareEntries = 0, void(*logFn)(const char*) = nullptr);
+
+		/**
+		Uploads voxel data from a memory mapped cache file to GPU (content gets copied straight from the mapping to the staging buffers).
+		@param device Logical device to upload to.
+		@param cache Cache file (has to be initialized).
 		@param logFn One function that will help us if anything goes wrong.
 		*/
-		VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const VoxelData& data, void(*logFn)(const char*) = nullptr);
+		VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const VoxelGridCache& cache, void(*logFn)(const char*) = nullptr);
+
+		/**
+		Allocates a compact layout voxel grid with no content, to be filled in on GPU (see VoxelGridBuilder).
+		Note: Build report only has numDivisions set and empty space distances are all zeros (no skipping);
+			References within each voxel end up in the order the build threads happened to append them, unlike the ascending order of the CPU build.
+		@param device Logical device to allocate on.
+		@param gridSettings Grid settings (subDivisions are ignored, since GPU build does not create sub-grids).
+		@param refCapacity Number of elements within triangleRefs.
+		@param logFn One function that will help us if anything goes wrong.
+		*/
+		VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const VoxelData::GridSettings& gridSettings, uint32_t refCapacity, void(*logFn)(const char*) = nullptr);
 
 		/**
 		Builds voxel data and uploads it to GPU.
 		@param device Logical device to upload to.
 		@param verts Mesh vertices.
 		@param indexBuffer Mesh indices.
-		@param numDivisions Number of voxel cells per axis.
+		@param numDivisions Number of voxel cells per axis (zero components get picked automatically).
+		@param numThreads Number of worker threads to build voxel data with.
+		@param dataLayout Memory layout of the voxel content.
+		@param subGridThreshold Cells with more triangles than this get their own sub-grid (compact layout only; 0 means "no sub-grids").
+		@param subDivisions Number of sub-grid cells per axis.
+		@param overlapTest Triangle/cell overlap test implementation.
 		@param logFn One function that will help us if anything goes wrong.
 		*/
-		VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, const glm::uvec3& numDivisions = {32, 32, 32}, void(*logFn)(const char*) = nullptr);
+		VoxelGrid(const std::shared_ptr<GraphicsDevice>& device, const std::vector<PNCVertex>& verts, const std::vector<uint32_t> indexBuffer, 
+			const glm::uvec3& numDivisions = {32, 32, 32}, uint32_t numThreads = 1, VoxelData::Layout dataLayout = VoxelData::LAYOUT_LINKED_LIST, 
+			uint32_t subGridThreshold = 0, const glm::uvec3& subDivisions = {4, 4, 4}, VoxelData::OverlapTest overlapTest = VoxelData::OVERLAP_CLIPPING, 
+			void(*logFn)(const char*) = nullptr);
 
 		/**
 		Tells if anything went wronf during initialisation.
@@ -93,15 +63,39 @@ namespace Test {
 		*/
 		bool initialized()const;
 
+		/**
+		Uploads modified ranges of the voxel buffers after VoxelData::update().
+		@param data Updated voxel data (has to be the same one, the grid was created from).
+		@param dirtyRanges Ranges, reported by VoxelData::update().
+		@return false, if the entry buffer ran out of space (nothing gets uploaded in that case; passing entries.size() to VoxelData::update() as entryCapacity
+			makes that one fail instead, before the data gets modified, so that the grid and the data stay in sync).
+		*/
+		bool update(const VoxelData& data, const VoxelData::DirtyRanges& dirtyRanges);
+
 		
 
+		// Layout of the voxel content (buffers, not used by the layout, hold a single placeholder element, since Vulkan does not like empty buffers).
+		const VoxelData::Layout layout;
+
+		// Build statistics (same as VoxelData).
+		const VoxelData::BuildReport report;
+
 		// Constant buffer, holding information about voxel grid settings (same as VoxelData).
 		const ConstantBuffer<VoxelData::GridSettings> settings;
 
-		// Flattened voxel entry indices per voxel (same as VoxelData).
-		const Buffer<VoxelData::VoxelEntryId, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> voxels;
+		// Flattened voxel entry indices per voxel (same as VoxelData; linked list layout; modified by update()).
+		Buffer<VoxelData::VoxelEntryId, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> voxels;
+
+		// All the voxel entries (same as VoxelData, followed by spare entries; linked list layout; modified by update()).
+		Buffer<VoxelData::VoxelEntry, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> entries;
+
+		// Flattened voxel content ranges per voxel (same as VoxelData; compact layout; filled in by VoxelGridBuilder for the grids built on GPU).
+		Buffer<VoxelData::VoxelRange, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> voxelRanges;
+
+		// Triangle references (same as VoxelData; compact layout; the grids built on GPU hold the same triangles per voxel, but in arbitrary order).
+		Buffer<uint32_t, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> triangleRefs;
 
-		// All the voxel entries (same as VoxelData).
-		const Buffer<VoxelData::VoxelEntry, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> entries;
+		// Empty space distances per top-level voxel (same as VoxelData; all zeros for the grids built on GPU, which disables skipping; modified by update()).
+		Buffer<uint32_t, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> emptyDistances;
 	};
 }
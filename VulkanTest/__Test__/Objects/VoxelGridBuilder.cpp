@@ -0,0 +1,349 @@
+#include "VoxelGridBuilder.h"
+#include "../Helpers.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+	// Has to match GROUP_SIZE from VoxelGridBuild.comp:
+	static const uint32_t GROUP_SIZE = 256;
+
+	// Vulkan only guarantees this many groups per dispatch dimension:
+	static const uint32_t MAX_GROUPS_PER_DIMENSION = 65535;
+
+	// Number of descriptor bindings (see VoxelGridBuild.comp):
+	static const uint32_t NUM_BINDINGS = 9;
+
+	static const char* const SHADERS[] = {
+		"__Test__/Shaders/VoxelGridBuildCount.spv",
+		"__Test__/Shaders/VoxelGridBuildScanBlocks.spv",
+		"__Test__/Shaders/VoxelGridBuildScanBlockSums.spv",
+		"__Test__/Shaders/VoxelGridBuildAddBlockOffsets.spv",
+		"__Test__/Shaders/VoxelGridBuildFill.spv"
+	};
+
+	inline static Test::VoxelGridBuilder::BuildParams buildParams(const Test::Mesh& mesh, const Test::VoxelGrid& voxelGrid) {
+		Test::VoxelGridBuilder::BuildParams params = {};
+		params.numTriangles = (mesh.numIndices() / 3);
+		params.numVoxels = (voxelGrid.report.numDivisions.x * voxelGrid.report.numDivisions.y * voxelGrid.report.numDivisions.z);
+		params.refCapacity = voxelGrid.triangleRefs.size();
+		return params;
+	}
+
+	inline static uint32_t numBlocks(uint32_t numVoxels) {
+		return std::max((numVoxels + GROUP_SIZE - 1) / GROUP_SIZE, 1u);
+	}
+
+	inline static void dispatch(VkCommandBuffer commandBuffer, uint32_t numThreads) {
+		const uint32_t numGroups = std::max((numThreads + GROUP_SIZE - 1) / GROUP_SIZE, 1u);
+		const uint32_t groupsX = std::min(numGroups, MAX_GROUPS_PER_DIMENSION);
+		vkCmdDispatch(commandBuffer, groupsX, ((numGroups + groupsX - 1) / groupsX), 1);
+	}
+
+	inline static void memoryBarrier(VkCommandBuffer commandBuffer,
+		VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) {
+		VkMemoryBarrier barrier = {};
+		{
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = dstAccess;
+		}
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	inline static VkDescriptorBufferInfo bufferInfo(VkBuffer buffer) {
+		VkDescriptorBufferInfo info = {};
+		info.buffer = buffer;
+		info.offset = 0;
+		info.range = VK_WHOLE_SIZE;
+		return info;
+	}
+}
+
+namespace Test {
+	VoxelGridBuilder::VoxelGridBuilder(const std::shared_ptr<Mesh>& mesh, const std::shared_ptr<VoxelGrid>& voxelGrid, void(*logFn)(const char*))
+		: m_mesh(mesh), m_voxelGrid(voxelGrid), m_params(buildParams(*mesh, *voxelGrid))
+		, m_paramBuffer(mesh->device(), &m_params, logFn)
+		, m_blockSums(mesh->device(), numBlocks(m_params.numVoxels), nullptr, logFn)
+		, m_cursors(mesh->device(), std::max(m_params.numVoxels, 1u), nullptr, logFn)
+		, m_counters(mesh->device(), 1u, nullptr, logFn)
+		, m_descriptorSetLayout(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE)
+		, m_descriptorPool(VK_NULL_HANDLE), m_descriptorSet(VK_NULL_HANDLE), m_commandBuffer(VK_NULL_HANDLE)
+		, m_initialized(false), m_logFn(logFn) {
+		for (uint32_t i = 0; i < NUM_PASSES; i++) {
+			m_shaderModules[i] = VK_NULL_HANDLE;
+			m_pipelines[i] = VK_NULL_HANDLE;
+		}
+
+		if (m_voxelGrid->layout != VoxelData::LAYOUT_COMPACT) {
+			log("[Error] VoxelGridBuilder - Only the compact layout can be built on GPU.");
+			return;
+		}
+		else if (!m_voxelGrid->initialized() || m_voxelGrid->voxelRanges.size() < m_params.numVoxels) {
+			log("[Error] VoxelGridBuilder - Voxel grid is not valid.");
+			return;
+		}
+		else if (m_paramBuffer.stagingBuffer() == VK_NULL_HANDLE || m_blockSums.buffer() == VK_NULL_HANDLE
+			|| m_cursors.buffer() == VK_NULL_HANDLE || m_counters.stagingBuffer() == VK_NULL_HANDLE) {
+			log("[Error] VoxelGridBuilder - Failed to allocate build buffers.");
+			return;
+		}
+
+		for (uint32_t i = 0; i < NUM_PASSES; i++)
+			if (!createShaderModule(m_mesh->device()->logicalDevice(), SHADERS[i], &m_shaderModules[i])) {
+				m_shaderModules[i] = VK_NULL_HANDLE;
+				std::stringstream stream;
+				stream << "[Error] VoxelGridBuilder - Could not create compute shader module '" << SHADERS[i] << "'.";
+				log(stream.str().c_str());
+				return;
+			}
+
+		m_initialized = (createDescriptorSetLayout() && createPipelines() && createDescriptorSet() && recordCommandBuffer());
+	}
+
+	VoxelGridBuilder::~VoxelGridBuilder() {
+		VkDevice device = m_mesh->device()->logicalDevice();
+		vkDeviceWaitIdle(device);
+
+		if (m_commandBuffer != VK_NULL_HANDLE)
+			vkFreeCommandBuffers(device, m_mesh->device()->commandPool(), 1, &m_commandBuffer);
+
+		if (m_descriptorPool != VK_NULL_HANDLE)
+			vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+
+		for (uint32_t i = 0; i < NUM_PASSES; i++) {
+			if (m_pipelines[i] != VK_NULL_HANDLE)
+				vkDestroyPipeline(device, m_pipelines[i], nullptr);
+			if (m_shaderModules[i] != VK_NULL_HANDLE)
+				vkDestroyShaderModule(device, m_shaderModules[i], nullptr);
+		}
+
+		if (m_pipelineLayout != VK_NULL_HANDLE)
+			vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+
+		if (m_descriptorSetLayout != VK_NULL_HANDLE)
+			vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+	}
+
+	bool VoxelGridBuilder::initialized()const {
+		return m_initialized;
+	}
+
+	bool VoxelGridBuilder::build() {
+		if (!m_initialized) return false;
+		VkSubmitInfo info = {};
+		{
+			info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			info.commandBufferCount = 1;
+			info.pCommandBuffers = &m_commandBuffer;
+		}
+		if (vkQueueSubmit(m_mesh->device()->graphicsQueue(), 1, &info, VK_NULL_HANDLE) != VK_SUCCESS) {
+			log("[Error] VoxelGridBuilder - Failed to submit build command buffer.");
+			return false;
+		}
+		vkQueueWaitIdle(m_mesh->device()->graphicsQueue());
+		return (numReferences() <= m_params.refCapacity);
+	}
+
+	uint32_t VoxelGridBuilder::numReferences() {
+		const uint32_t count = (*m_counters.map());
+		m_counters.unmap();
+		return count;
+	}
+
+
+
+	void VoxelGridBuilder::log(const char* message)const {
+		if (m_logFn != nullptr)
+			m_logFn(message);
+	}
+
+	bool VoxelGridBuilder::createDescriptorSetLayout() {
+		VkDescriptorSetLayoutBinding bindings[NUM_BINDINGS];
+		for (uint32_t i = 0; i < NUM_BINDINGS; i++) {
+			VkDescriptorSetLayoutBinding& binding = bindings[i];
+			binding = {};
+			binding.binding = i;
+			binding.descriptorType = (i <= 1) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.descriptorCount = 1;
+			binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			binding.pImmutableSamplers = nullptr;
+		}
+		VkDescriptorSetLayoutCreateInfo info = {};
+		{
+			info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			info.bindingCount = NUM_BINDINGS;
+			info.pBindings = bindings;
+		}
+		if (vkCreateDescriptorSetLayout(m_mesh->device()->logicalDevice(), &info, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+			m_descriptorSetLayout = VK_NULL_HANDLE;
+			log("[Error] VoxelGridBuilder - Failed to create descriptor set layout.");
+			return false;
+		}
+		return true;
+	}
+
+	bool VoxelGridBuilder::createPipelines() {
+		{
+			VkPipelineLayoutCreateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+				info.setLayoutCount = 1;
+				info.pSetLayouts = &m_descriptorSetLayout;
+				info.pushConstantRangeCount = 0;
+				info.pPushConstantRanges = nullptr;
+			}
+			if (vkCreatePipelineLayout(m_mesh->device()->logicalDevice(), &info, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+				m_pipelineLayout = VK_NULL_HANDLE;
+				log("[Error] VoxelGridBuilder - Failed to create pipeline layout.");
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < NUM_PASSES; i++) {
+			VkComputePipelineCreateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+				info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+				info.stage.module = m_shaderModules[i];
+				info.stage.pName = "main";
+				info.layout = m_pipelineLayout;
+				info.basePipelineHandle = VK_NULL_HANDLE;
+				info.basePipelineIndex = -1;
+			}
+			if (vkCreateComputePipelines(m_mesh->device()->logicalDevice(), VK_NULL_HANDLE, 1, &info, nullptr, &m_pipelines[i]) != VK_SUCCESS) {
+				m_pipelines[i] = VK_NULL_HANDLE;
+				log("[Error] VoxelGridBuilder - Failed to create compute pipeline.");
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool VoxelGridBuilder::createDescriptorSet() {
+		// Descriptor pool:
+		{
+			VkDescriptorPoolSize sizes[2];
+			{
+				VkDescriptorPoolSize& size = sizes[0];
+				size = {};
+				size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				size.descriptorCount = 2;
+			}
+			{
+				VkDescriptorPoolSize& size = sizes[1];
+				size = {};
+				size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				size.descriptorCount = (NUM_BINDINGS - 2);
+			}
+			VkDescriptorPoolCreateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+				info.poolSizeCount = sizeof(sizes) / sizeof(VkDescriptorPoolSize);
+				info.pPoolSizes = sizes;
+				info.maxSets = 1;
+			}
+			if (vkCreateDescriptorPool(m_mesh->device()->logicalDevice(), &info, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+				m_descriptorPool = VK_NULL_HANDLE;
+				log("[Error] VoxelGridBuilder - Failed to create descriptor pool.");
+				return false;
+			}
+		}
+		// Descriptor set:
+		{
+			VkDescriptorSetAllocateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+				info.descriptorPool = m_descriptorPool;
+				info.descriptorSetCount = 1;
+				info.pSetLayouts = &m_descriptorSetLayout;
+			}
+			if (vkAllocateDescriptorSets(m_mesh->device()->logicalDevice(), &info, &m_descriptorSet) != VK_SUCCESS) {
+				m_descriptorSet = VK_NULL_HANDLE;
+				log("[Error] VoxelGridBuilder - Failed to allocate descriptor set.");
+				return false;
+			}
+
+			const VkDescriptorBufferInfo infos[NUM_BINDINGS] = {
+				bufferInfo(m_voxelGrid->settings.stagingBuffer()),
+				bufferInfo(m_paramBuffer.stagingBuffer()),
+				bufferInfo(m_mesh->positionBuffer()),
+				bufferInfo(m_mesh->indexBuffer()),
+				bufferInfo(m_voxelGrid->voxelRanges.buffer()),
+				bufferInfo(m_voxelGrid->triangleRefs.buffer()),
+				bufferInfo(m_blockSums.buffer()),
+				bufferInfo(m_cursors.buffer()),
+				bufferInfo(m_counters.stagingBuffer())
+			};
+			VkWriteDescriptorSet writes[NUM_BINDINGS];
+			for (uint32_t i = 0; i < NUM_BINDINGS; i++) {
+				VkWriteDescriptorSet& write = writes[i];
+				write = {};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = m_descriptorSet;
+				write.dstBinding = i;
+				write.dstArrayElement = 0;
+				write.descriptorCount = 1;
+				write.descriptorType = (i <= 1) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				write.pBufferInfo = &infos[i];
+			}
+			vkUpdateDescriptorSets(m_mesh->device()->logicalDevice(), NUM_BINDINGS, writes, 0, nullptr);
+		}
+		return true;
+	}
+
+	bool VoxelGridBuilder::recordCommandBuffer() {
+		{
+			VkCommandBufferAllocateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				info.commandPool = m_mesh->device()->commandPool();
+				info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				info.commandBufferCount = 1;
+			}
+			if (vkAllocateCommandBuffers(m_mesh->device()->logicalDevice(), &info, &m_commandBuffer) != VK_SUCCESS) {
+				m_commandBuffer = VK_NULL_HANDLE;
+				log("[Error] VoxelGridBuilder - Failed to allocate command buffer.");
+				return false;
+			}
+		}
+		{
+			VkCommandBufferBeginInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			info.flags = 0;
+			info.pInheritanceInfo = nullptr;
+			if (vkBeginCommandBuffer(m_commandBuffer, &info) != VK_SUCCESS) {
+				log("[Error] VoxelGridBuilder - Failed to begin recording command buffer.");
+				return false;
+			}
+		}
+
+		// Previous frames may still be reading the grid:
+		memoryBarrier(m_commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+
+		// Counts and cursors start from zero:
+		vkCmdFillBuffer(m_commandBuffer, m_voxelGrid->voxelRanges.buffer(), 0, sizeof(VoxelData::VoxelRange) * static_cast<VkDeviceSize>(m_params.numVoxels), 0);
+		vkCmdFillBuffer(m_commandBuffer, m_cursors.buffer(), 0, VK_WHOLE_SIZE, 0);
+		memoryBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+		const uint32_t numThreads[NUM_PASSES] = { m_params.numTriangles, m_params.numVoxels, GROUP_SIZE, m_params.numVoxels, m_params.numTriangles };
+		for (uint32_t i = 0; i < NUM_PASSES; i++) {
+			if (i > 0) memoryBarrier(m_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+			vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[i]);
+			dispatch(m_commandBuffer, numThreads[i]);
+		}
+
+		// Grid gets read by the ray tracing shaders and the reference count by the host:
+		memoryBarrier(m_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT);
+
+		if (vkEndCommandBuffer(m_commandBuffer) != VK_SUCCESS) {
+			log("[Error] VoxelGridBuilder - Failed to end recording command buffer.");
+			return false;
+		}
+		return true;
+	}
+}
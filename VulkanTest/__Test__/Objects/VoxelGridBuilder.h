@@ -0,0 +1,103 @@
+#pragma once
+#include "Mesh.h"
+#include "VoxelGrid.h"
+
+namespace Test {
+	/**
+	 * Builds compact layout voxel grid content on GPU, straight from the mesh buffers (no CPU build and no voxel data transfer).
+	 * Build runs in five compute passes: reference count per cell (atomics), prefix sum of the counts (three passes) and reference fill.
+	 * Resulting grid binds in RayTracedMesh the same way as the CPU-built one; within a cell, the triangle order is arbitrary.
+	 */
+	class VoxelGridBuilder {
+	public:
+		/**
+		 * Build parameters (uniform buffer content).
+		 */
+		struct BuildParams {
+			// Number of triangles within the mesh.
+			uint32_t numTriangles;
+
+			// Number of top-level voxel cells.
+			uint32_t numVoxels;
+
+			// Number of elements within the triangle reference buffer of the grid.
+			uint32_t refCapacity;
+		};
+
+		/**
+		Creates compute pipelines and records build commands.
+		@param mesh Mesh to voxelize (reads Mesh::positionBuffer(); its content can change between builds, triangle count can not).
+		@param voxelGrid Grid to fill in (has to use the compact layout; see VoxelGrid constructor that takes GridSettings).
+		@param logFn One function that will help us if anything goes wrong.
+		*/
+		VoxelGridBuilder(const std::shared_ptr<Mesh>& mesh, const std::shared_ptr<VoxelGrid>& voxelGrid, void(*logFn)(const char*) = nullptr);
+
+		/** Destructor */
+		~VoxelGridBuilder();
+
+		/**
+		Tells if anything went wrong during initialisation.
+		@return true, if build() can be used.
+		*/
+		bool initialized()const;
+
+		/**
+		Rebuilds the grid content and waits for the build to finish (cheap enough to run every frame for dynamic geometry).
+		@return false, if the build failed or the triangle reference buffer was too small to hold all the references (extra references get dropped in that case).
+		*/
+		bool build();
+
+		/**
+		Number of triangle references, the last build produced.
+		@return reference count (may be greater than the capacity of the grid, in which case, the grid has to be reallocated).
+		*/
+		uint32_t numReferences();
+
+
+	private:
+		const std::shared_ptr<Mesh> m_mesh;
+		const std::shared_ptr<VoxelGrid> m_voxelGrid;
+		const BuildParams m_params;
+
+		ConstantBuffer<BuildParams> m_paramBuffer;
+		Buffer<uint32_t, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> m_blockSums;
+		Buffer<uint32_t, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> m_cursors;
+		StagingBuffer<uint32_t, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> m_counters;
+
+		enum Pass {
+			PASS_COUNT_REFS = 0,
+			PASS_SCAN_BLOCKS = 1,
+			PASS_SCAN_BLOCK_SUMS = 2,
+			PASS_ADD_BLOCK_OFFSETS = 3,
+			PASS_FILL_REFS = 4,
+			NUM_PASSES = 5
+		};
+
+		VkShaderModule m_shaderModules[NUM_PASSES];
+		VkPipeline m_pipelines[NUM_PASSES];
+
+		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkPipelineLayout m_pipelineLayout;
+		VkDescriptorPool m_descriptorPool;
+		VkDescriptorSet m_descriptorSet;
+		VkCommandBuffer m_commandBuffer;
+
+		bool m_initialized;
+
+		void(*m_logFn)(const char*);
+
+
+		void log(const char* message)const;
+
+		bool createDescriptorSetLayout();
+
+		bool createPipelines();
+
+		bool createDescriptorSet();
+
+		bool recordCommandBuffer();
+
+		VoxelGridBuilder(const VoxelGridBuilder&) = delete;
+		VoxelGridBuilder& operator=(const VoxelGridBuilder&) = delete;
+	};
+}
@@ -0,0 +1,284 @@
+#include "VoxelGridCache.h"
+#include "../CpuHelpers.h"
+#include <fstream>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	typedef Test::VoxelData VoxelData;
+
+	// File signature:
+	static const char CACHE_SIGNATURE[8] = { 'V', 'O', 'X', 'G', 'R', 'I', 'D', '\0' };
+
+	// Bumped whenever the file layout or the voxelization output changes:
+	static const uint32_t CACHE_VERSION = 3;
+
+	/**
+	 * Cache file header (voxels, voxelEntries, voxelRanges, triangleRefs and emptyDistances follow it in the same order, tightly packed).
+	 */
+	struct CacheHeader {
+		// CACHE_SIGNATURE.
+		char signature[8];
+
+		// CACHE_VERSION.
+		uint32_t version;
+
+		// sizeof(CacheHeader) at the time of writing (guards against files, written by a build with a different struct layout).
+		uint32_t headerSize;
+
+		// Hash of the build inputs.
+		uint64_t key;
+
+		// Grid settings.
+		VoxelData::GridSettings settings;
+
+		// Layout of the voxel content.
+		VoxelData::Layout layout;
+
+		// Build report.
+		VoxelData::BuildReport report;
+
+		// Number of elements within voxels.
+		uint64_t numVoxels;
+
+		// Number of elements within voxelEntries.
+		uint64_t numVoxelEntries;
+
+		// Number of elements within voxelRanges.
+		uint64_t numVoxelRanges;
+
+		// Number of elements within triangleRefs.
+		uint64_t numTriangleRefs;
+
+		// Number of elements within emptyDistances.
+		uint64_t numEmptyDistances;
+	};
+
+	inline static const CacheHeader& cacheHeader(const char* data) {
+		return *reinterpret_cast<const CacheHeader*>(data);
+	}
+
+	inline static size_t voxelsOffset(const CacheHeader&) {
+		return sizeof(CacheHeader);
+	}
+
+	inline static size_t voxelEntriesOffset(const CacheHeader& header) {
+		return voxelsOffset(header) + (static_cast<size_t>(header.numVoxels) * sizeof(VoxelData::VoxelEntryId));
+	}
+
+	inline static size_t voxelRangesOffset(const CacheHeader& header) {
+		return voxelEntriesOffset(header) + (static_cast<size_t>(header.numVoxelEntries) * sizeof(VoxelData::VoxelEntry));
+	}
+
+	inline static size_t triangleRefsOffset(const CacheHeader& header) {
+		return voxelRangesOffset(header) + (static_cast<size_t>(header.numVoxelRanges) * sizeof(VoxelData::VoxelRange));
+	}
+
+	inline static size_t emptyDistancesOffset(const CacheHeader& header) {
+		return triangleRefsOffset(header) + (static_cast<size_t>(header.numTriangleRefs) * sizeof(uint32_t));
+	}
+
+	inline static size_t fileSize(const CacheHeader& header) {
+		return emptyDistancesOffset(header) + (static_cast<size_t>(header.numEmptyDistances) * sizeof(uint32_t));
+	}
+
+	template<typename Type>
+	inline static void hashValue(uint64_t& hash, const Type& value) {
+		Test::hashBytes(hash, &value, sizeof(Type));
+	}
+
+	template<typename Type>
+	inline static bool writeSection(std::ofstream& stream, const std::vector<Type>& content) {
+		if (content.empty()) return true;
+		stream.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(sizeof(Type) * content.size()));
+		return stream.good();
+	}
+}
+
+namespace Test {
+	uint64_t VoxelGridCache::key(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const glm::uvec3& numDivisions,
+		VoxelData::Layout layout, uint32_t subGridThreshold, const glm::uvec3& subDivisions, VoxelData::OverlapTest overlapTest) {
+		uint64_t hash = FNV_OFFSET_BASIS;
+		hashValue(hash, CACHE_VERSION);
+		hashValue(hash, static_cast<uint64_t>(verts.size()));
+		for (size_t i = 0; i < verts.size(); i++)
+			hashValue(hash, verts[i].position);
+		hashValue(hash, static_cast<uint64_t>(indexBuffer.size()));
+		if (!indexBuffer.empty())
+			hashBytes(hash, indexBuffer.data(), sizeof(uint32_t) * indexBuffer.size());
+		hashValue(hash, numDivisions);
+		hashValue(hash, static_cast<uint32_t>(layout));
+		hashValue(hash, subGridThreshold);
+		hashValue(hash, subDivisions);
+		hashValue(hash, static_cast<uint32_t>(overlapTest));
+		return hash;
+	}
+
+	bool VoxelGridCache::write(const char* path, uint64_t key, const VoxelData& data, void(*logFn)(const char*)) {
+		CacheHeader header = {};
+		{
+			memcpy(header.signature, CACHE_SIGNATURE, sizeof(CACHE_SIGNATURE));
+			header.version = CACHE_VERSION;
+			header.headerSize = static_cast<uint32_t>(sizeof(CacheHeader));
+			header.key = key;
+			header.settings = data.settings;
+			header.layout = data.layout;
+			header.report = data.report;
+			header.numVoxels = data.voxels.size();
+			header.numVoxelEntries = data.voxelEntries.size();
+			header.numVoxelRanges = data.voxelRanges.size();
+			header.numTriangleRefs = data.triangleRefs.size();
+			header.numEmptyDistances = data.emptyDistances.size();
+		}
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		if (!stream.is_open()) {
+			if (logFn != nullptr) logFn("[Error] VoxelGridCache - Could not open cache file for writing.");
+			return false;
+		}
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+		if (!(stream.good() && writeSection(stream, data.voxels) && writeSection(stream, data.voxelEntries)
+			&& writeSection(stream, data.voxelRanges) && writeSection(stream, data.triangleRefs) && writeSection(stream, data.emptyDistances))) {
+			if (logFn != nullptr) logFn("[Error] VoxelGridCache - Failed to write cache file.");
+			return false;
+		}
+		return true;
+	}
+
+	std::shared_ptr<VoxelGrid> VoxelGridCache::loadOrBuild(const std::shared_ptr<GraphicsDevice>& device, const char* path,
+		const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		const glm::uvec3& numDivisions, uint32_t numThreads, VoxelData::Layout layout,
+		uint32_t subGridThreshold, const glm::uvec3& subDivisions, VoxelData::OverlapTest overlapTest,
+		void(*logFn)(const char*)) {
+		const uint64_t cacheKey = key(verts, indexBuffer, numDivisions, layout, subGridThreshold, subDivisions, overlapTest);
+		{
+			// Mapping gets released before we get a chance to rewrite the file:
+			VoxelGridCache cache(path, cacheKey);
+			if (cache.initialized())
+				return std::shared_ptr<VoxelGrid>(new VoxelGrid(device, cache, logFn));
+		}
+		const VoxelData data(verts, indexBuffer, numDivisions, numThreads, layout, subGridThreshold, subDivisions, overlapTest);
+		write(path, cacheKey, data, logFn);
+		return std::shared_ptr<VoxelGrid>(new VoxelGrid(device, data, 0, logFn));
+	}
+
+	VoxelGridCache::VoxelGridCache(const char* path, uint64_t key)
+		: m_data(nullptr), m_size(0), m_valid(false)
+#ifdef _WIN32
+		, m_file(INVALID_HANDLE_VALUE), m_mapping(NULL)
+#else
+		, m_file(-1)
+#endif
+	{
+#ifdef _WIN32
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (m_file == INVALID_HANDLE_VALUE) return;
+		{
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(CacheHeader))) return;
+			m_size = static_cast<size_t>(size.QuadPart);
+		}
+		m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_mapping == NULL) return;
+		m_data = reinterpret_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (m_data == nullptr) return;
+#else
+		m_file = open(path, O_RDONLY);
+		if (m_file < 0) return;
+		{
+			struct stat info;
+			if (fstat(m_file, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(CacheHeader))) return;
+			m_size = static_cast<size_t>(info.st_size);
+		}
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+		if (data == MAP_FAILED) return;
+		m_data = reinterpret_cast<const char*>(data);
+#endif
+		const CacheHeader& header = cacheHeader(m_data);
+		m_valid = (memcmp(header.signature, CACHE_SIGNATURE, sizeof(CACHE_SIGNATURE)) == 0
+			&& header.version == CACHE_VERSION && header.headerSize == sizeof(CacheHeader) && header.key == key
+			&& header.numVoxels <= UINT32_MAX && header.numVoxelEntries <= UINT32_MAX
+			&& header.numVoxelRanges <= UINT32_MAX && header.numTriangleRefs <= UINT32_MAX && header.numEmptyDistances <= UINT32_MAX
+			&& fileSize(header) == m_size);
+	}
+
+	VoxelGridCache::~VoxelGridCache() {
+#ifdef _WIN32
+		if (m_data != nullptr) UnmapViewOfFile(m_data);
+		if (m_mapping != NULL) CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+		if (m_data != nullptr) munmap(const_cast<char*>(m_data), m_size);
+		if (m_file >= 0) close(m_file);
+#endif
+	}
+
+	bool VoxelGridCache::initialized()const {
+		return m_valid;
+	}
+
+	const VoxelData::GridSettings& VoxelGridCache::settings()const {
+		return cacheHeader(m_data).settings;
+	}
+
+	VoxelData::Layout VoxelGridCache::layout()const {
+		return cacheHeader(m_data).layout;
+	}
+
+	const VoxelData::BuildReport& VoxelGridCache::report()const {
+		return cacheHeader(m_data).report;
+	}
+
+	uint32_t VoxelGridCache::numVoxels()const {
+		return static_cast<uint32_t>(cacheHeader(m_data).numVoxels);
+	}
+
+	const VoxelData::VoxelEntryId* VoxelGridCache::voxels()const {
+		return reinterpret_cast<const VoxelData::VoxelEntryId*>(m_data + voxelsOffset(cacheHeader(m_data)));
+	}
+
+	uint32_t VoxelGridCache::numVoxelEntries()const {
+		return static_cast<uint32_t>(cacheHeader(m_data).numVoxelEntries);
+	}
+
+	const VoxelData::VoxelEntry* VoxelGridCache::voxelEntries()const {
+		return reinterpret_cast<const VoxelData::VoxelEntry*>(m_data + voxelEntriesOffset(cacheHeader(m_data)));
+	}
+
+	uint32_t VoxelGridCache::numVoxelRanges()const {
+		return static_cast<uint32_t>(cacheHeader(m_data).numVoxelRanges);
+	}
+
+	const VoxelData::VoxelRange* VoxelGridCache::voxelRanges()const {
+		return reinterpret_cast<const VoxelData::VoxelRange*>(m_data + voxelRangesOffset(cacheHeader(m_data)));
+	}
+
+	uint32_t VoxelGridCache::numTriangleRefs()const {
+		return static_cast<uint32_t>(cacheHeader(m_data).numTriangleRefs);
+	}
+
+	const uint32_t* VoxelGridCache::triangleRefs()const {
+		return reinterpret_cast<const uint32_t*>(m_data + triangleRefsOffset(cacheHeader(m_data)));
+	}
+
+	uint32_t VoxelGridCache::numEmptyDistances()const {
+		return static_cast<uint32_t>(cacheHeader(m_data).numEmptyDistances);
+	}
+
+	const uint32_t* VoxelGridCache::emptyDistances()const {
+		return reinterpret_cast<const uint32_t*>(m_data + emptyDistancesOffset(cacheHeader(m_data)));
+	}
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include "VoxelGrid.h"
+
+namespace Test {
+	/**
+	 * Memory mapped binary cache file of a voxel grid (settings, build report and voxel buffers, keyed by the hash of the build inputs).
+	 * Loaded content is never copied to CPU side vectors; VoxelGrid uploads it straight from the mapped file.
+	 */
+	class VoxelGridCache {
+	public:
+		/**
+		Calculates cache key for given voxel grid build inputs (only vertex positions are hashed, since the rest of the vertex data does not affect voxelization).
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param numDivisions Requested number of voxel cells per axis (before automatic selection kicks in).
+		@param layout Memory layout of the voxel content.
+		@param subGridThreshold Sub-grid threshold.
+		@param subDivisions Number of sub-grid cells per axis.
+		@param overlapTest Triangle/cell overlap test implementation.
+		@return 64 bit FNV-1a hash of the inputs.
+		*/
+		static uint64_t key(const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer, const glm::uvec3& numDivisions,
+			VoxelData::Layout layout, uint32_t subGridThreshold, const glm::uvec3& subDivisions, VoxelData::OverlapTest overlapTest);
+
+		/**
+		Writes voxel data to a cache file.
+		@param path File path.
+		@param key Cache key (see key()).
+		@param data Voxel data to store (CPU-only update bookkeeping is not stored).
+		@param logFn Logging function for error reporting (optional).
+		@return true, if the file got written successfully.
+		*/
+		static bool write(const char* path, uint64_t key, const VoxelData& data, void(*logFn)(const char*) = nullptr);
+
+		/**
+		Loads voxel grid from the cache file if the key matches; otherwise builds it and rewrites the cache.
+		Note: Build report of a cached grid is the one recorded at the time of the original build.
+		@param device Logical device to upload to.
+		@param path Cache file path.
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param numDivisions Number of voxel cells per axis (zero components get picked automatically).
+		@param numThreads Number of worker threads to build voxel data with.
+		@param layout Memory layout of the voxel content.
+		@param subGridThreshold Cells with more triangles than this get their own sub-grid (compact layout only; 0 means "no sub-grids").
+		@param subDivisions Number of sub-grid cells per axis.
+		@param overlapTest Triangle/cell overlap test implementation.
+		@param logFn One function that will help us if anything goes wrong.
+		@return voxel grid.
+		*/
+		static std::shared_ptr<VoxelGrid> loadOrBuild(const std::shared_ptr<GraphicsDevice>& device, const char* path,
+			const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+			const glm::uvec3& numDivisions = { 32, 32, 32 }, uint32_t numThreads = 1, VoxelData::Layout layout = VoxelData::LAYOUT_LINKED_LIST,
+			uint32_t subGridThreshold = 0, const glm::uvec3& subDivisions = { 4, 4, 4 }, VoxelData::OverlapTest overlapTest = VoxelData::OVERLAP_CLIPPING,
+			void(*logFn)(const char*) = nullptr);
+
+		/**
+		Maps cache file to memory.
+		@param path File path.
+		@param key Expected cache key (file gets ignored, if the stored one is different).
+		*/
+		VoxelGridCache(const char* path, uint64_t key);
+
+		/** Destructor (unmaps the file) */
+		~VoxelGridCache();
+
+		/**
+		Tells, if the cache file exists, is well-formed and has the expected key.
+		@return true, if the content can be used.
+		*/
+		bool initialized()const;
+
+		/**
+		Grid settings.
+		@return stored settings.
+		*/
+		const VoxelData::GridSettings& settings()const;
+
+		/**
+		Memory layout of the voxel content.
+		@return stored layout.
+		*/
+		VoxelData::Layout layout()const;
+
+		/**
+		Build statistics.
+		@return report from the original build.
+		*/
+		const VoxelData::BuildReport& report()const;
+
+		/**
+		Number of elements within VoxelData::voxels.
+		@return voxel count (0 for the compact layout).
+		*/
+		uint32_t numVoxels()const;
+
+		/**
+		Content of VoxelData::voxels.
+		@return mapped memory.
+		*/
+		const VoxelData::VoxelEntryId* voxels()const;
+
+		/**
+		Number of elements within VoxelData::voxelEntries.
+		@return entry count (0 for the compact layout).
+		*/
+		uint32_t numVoxelEntries()const;
+
+		/**
+		Content of VoxelData::voxelEntries.
+		@return mapped memory.
+		*/
+		const VoxelData::VoxelEntry* voxelEntries()const;
+
+		/**
+		Number of elements within VoxelData::voxelRanges.
+		@return range count (0 for the linked list layout).
+		*/
+		uint32_t numVoxelRanges()const;
+
+		/**
+		Content of VoxelData::voxelRanges.
+		@return mapped memory.
+		*/
+		const VoxelData::VoxelRange* voxelRanges()const;
+
+		/**
+		Number of elements within VoxelData::triangleRefs.
+		@return reference count (0 for the linked list layout).
+		*/
+		uint32_t numTriangleRefs()const;
+
+		/**
+		Content of VoxelData::triangleRefs.
+		@return mapped memory.
+		*/
+		const uint32_t* triangleRefs()const;
+
+		/**
+		Number of elements within VoxelData::emptyDistances.
+		@return distance count.
+		*/
+		uint32_t numEmptyDistances()const;
+
+		/**
+		Content of VoxelData::emptyDistances.
+		@return mapped memory.
+		*/
+		const uint32_t* emptyDistances()const;
+
+
+	private:
+		const char* m_data;
+		size_t m_size;
+		bool m_valid;
+#ifdef _WIN32
+		void* m_file;
+		void* m_mapping;
+#else
+		int m_file;
+#endif
+
+		VoxelGridCache(const VoxelGridCache&) = delete;
+		VoxelGridCache& operator=(const VoxelGridCache&) = delete;
+	};
+}
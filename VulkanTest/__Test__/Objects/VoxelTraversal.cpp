@@ -0,0 +1,450 @@
+#include "VoxelTraversal.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace {
+	typedef Test::VoxelData VoxelData;
+	typedef Test::VoxelTraversal VoxelTraversal;
+
+	static const float INF = std::numeric_limits<float>::infinity();
+
+	// Padding of the cell bounds, cell stepping uses (same as in RayTracedDiffuseVox.frag):
+	static const float CELL_PADDING = 0.000025f;
+
+	// Padding of the grid bounds, the first cell gets searched within:
+	static const float GRID_PADDING = 0.000001f;
+
+	// Linked list terminator:
+	static const VoxelData::VoxelEntryId NO_ENTRY = (~((VoxelData::VoxelEntryId)0));
+
+	struct Box {
+		glm::vec3 start;
+		glm::vec3 end;
+	};
+
+	/**
+	Everything, a single ray query needs.
+	*/
+	struct Query {
+		const VoxelData& data;
+		const std::vector<Test::PNCVertex>& verts;
+		const std::vector<uint32_t>& indices;
+		glm::vec3 origin;
+		glm::vec3 direction;
+		bool integerDDA;
+		Test::RayTriangle::Ray triangleRay;
+
+		// Occlusion queries accept any hit within [minDistance, maxDistance) and end the walk right away:
+		bool anyHit;
+		float minDistance;
+		float maxDistance;
+	};
+
+	inline static bool pointInBox(const glm::vec3& point, const Box& box) {
+		return
+			(point.x >= box.start.x && point.x <= box.end.x) &&
+			(point.y >= box.start.y && point.y <= box.end.y) &&
+			(point.z >= box.start.z && point.z <= box.end.z);
+	}
+
+	inline static bool hitInCell(const Query& query, float dist, const glm::vec3& point, const Box& cell, float cellExit) {
+		if (query.integerDDA) return (dist <= cellExit);
+		else return pointInBox(point, cell);
+	}
+
+	inline static size_t flatIndex(const glm::ivec3& cellId, const glm::uvec3& numDivisions) {
+		return (numDivisions.x * ((static_cast<size_t>(cellId.z) * numDivisions.y) + cellId.y)) + cellId.x;
+	}
+
+	/**
+	Tests a triangle and keeps the hit, if it's the closest one so far and belongs to the cell.
+	@param query Ray query.
+	@param triangle Index buffer offset of the triangle.
+	@param cell Cell bounds.
+	@param cellExit Ray distance, the cell is left at.
+	@param hit Closest hit so far (distance is INF, if there is none).
+	*/
+	inline static void testTriangle(const Query& query, uint32_t triangle, const Box& cell, float cellExit, VoxelTraversal::Hit& hit) {
+		float dist;
+		glm::vec3 barycentrics;
+		if (Test::RayTriangle::cast(query.triangleRay,
+			query.verts[query.indices[triangle]].position, query.verts[query.indices[triangle + 1]].position, query.verts[query.indices[triangle + 2]].position, dist, barycentrics)) {
+			const glm::vec3 point = (query.origin + (query.direction * dist));
+			if (query.anyHit ? (dist >= query.minDistance && dist < query.maxDistance) : (dist < hit.distance && hitInCell(query, dist, point, cell, cellExit))) {
+				hit.distance = dist;
+				hit.point = point;
+				hit.triangle = triangle;
+				hit.barycentrics = barycentrics;
+			}
+		}
+	}
+
+	inline static void castInRange(const Query& query, const VoxelData::VoxelRange& range, const Box& cell, float cellExit, VoxelTraversal::Hit& hit) {
+		for (uint32_t refId = range.offset; refId < (range.offset + range.count); refId++) {
+			testTriangle(query, query.data.triangleRefs[refId], cell, cellExit, hit);
+			if (query.anyHit && !std::isinf(hit.distance)) return;
+		}
+	}
+
+
+
+	/** ########################################################################################################### */
+	/** CELL STEPPING: */
+
+	/**
+	Mirror of findFirstCell from RayTracedDiffuseVox.frag.
+	@param query Ray query.
+	@param grid Grid bounds.
+	@param numDivisions Number of cells per axis.
+	@param cellId Cell, the ray enters the grid with.
+	@param point Entry point.
+	@return false, if the ray misses the grid.
+	*/
+	inline static bool findFirstCell(const Query& query, const Box& grid, const glm::uvec3& numDivisions, glm::ivec3& cellId, glm::vec3& point) {
+		const glm::vec3 invDirection = (1.0f / query.direction);
+		float enterTime = -INF;
+		float exitTime = INF;
+		for (int axis = 0; axis < 3; axis++) {
+			const float startTime = ((grid.start[axis] - query.origin[axis]) * invDirection[axis]);
+			const float endTime = ((grid.end[axis] - query.origin[axis]) * invDirection[axis]);
+			enterTime = (axis == 0) ? std::min(startTime, endTime) : std::max(enterTime, std::min(startTime, endTime));
+			exitTime = (axis == 0) ? std::max(startTime, endTime) : std::min(exitTime, std::max(startTime, endTime));
+		}
+		if (enterTime > exitTime + 0.0001f) return false;
+		else if (enterTime < 0.0f) enterTime = 0.0f;
+		point = glm::clamp(query.origin + (enterTime * query.direction), grid.start + GRID_PADDING, grid.end - GRID_PADDING);
+		cellId = glm::clamp(glm::ivec3((point - grid.start) / ((grid.end - grid.start) / glm::vec3(numDivisions))), glm::ivec3(0), glm::ivec3(numDivisions) - 1);
+		return true;
+	}
+
+	inline static Box paddedCell(const glm::vec3& gridStart, const glm::vec3& cellSize, const glm::ivec3& cellId) {
+		Box cell;
+		cell.start = ((cellSize * glm::vec3(cellId)) + gridStart);
+		cell.end = (cell.start + cellSize + CELL_PADDING);
+		cell.start -= CELL_PADDING;
+		return cell;
+	}
+
+	/**
+	Mirror of findNextCell from RayTracedDiffuseVox.frag (moves the ray origin to the exit point and the cell to its neighbour).
+	@param rayOrigin Current position along the ray.
+	@param direction Ray direction.
+	@param cellSize Cell size.
+	@param numDivisions Number of cells per axis.
+	@param cell Current cell bounds.
+	@param cellId Current cell.
+	@return false, if the walk ended.
+	*/
+	inline static bool findNextCell(glm::vec3& rayOrigin, const glm::vec3& direction, const glm::vec3& cellSize, const glm::uvec3& numDivisions, Box& cell, glm::ivec3& cellId) {
+		const glm::vec3 invDirection = (1.0f / direction);
+		const glm::vec3 startTime = (cell.start - rayOrigin) * invDirection;
+		const glm::vec3 endTime = (cell.end - rayOrigin) * invDirection;
+		glm::ivec3 indexDelta(0);
+		float minDist = INF;
+		for (int axis = 0; axis < 3; axis++) {
+			glm::ivec3 delta(0);
+			if (invDirection[axis] > 0) {
+				if (minDist > endTime[axis] && cellId[axis] < static_cast<int>(numDivisions[axis] - 1)) {
+					delta[axis] = 1;
+					indexDelta = delta;
+					minDist = endTime[axis];
+				}
+			}
+			else if (invDirection[axis] < 0) {
+				if (minDist > startTime[axis] && cellId[axis] > 0) {
+					delta[axis] = -1;
+					indexDelta = delta;
+					minDist = startTime[axis];
+				}
+			}
+		}
+		if (std::isinf(minDist) || minDist < 0.0f) return false;
+		const glm::vec3 cellDelta = (glm::vec3(indexDelta) * cellSize);
+		cell.start += cellDelta;
+		cell.end += cellDelta;
+		cellId += indexDelta;
+		rayOrigin += direction * minDist;
+		return pointInBox(rayOrigin, cell);
+	}
+
+	/**
+	Mirror of skipEmptyCells from RayTracedDiffuseVox.frag.
+	@param query Ray query.
+	@param rayOrigin Current position along the ray.
+	@param cellSize Cell size.
+	@param radius Number of empty cells around the current one.
+	@param cell Current cell bounds.
+	@param cellId Current cell.
+	@return false, if the walk ended.
+	*/
+	inline static bool skipEmptyCells(const Query& query, glm::vec3& rayOrigin, const glm::vec3& cellSize, uint32_t radius, Box& cell, glm::ivec3& cellId) {
+		const VoxelData::GridSettings& settings = query.data.settings;
+		const glm::vec3 invDirection = (1.0f / query.direction);
+		const glm::ivec3 boxFirst = glm::max(cellId - static_cast<int>(radius), glm::ivec3(0));
+		const glm::ivec3 boxLast = glm::min(cellId + static_cast<int>(radius), glm::ivec3(settings.numDivisions) - 1);
+		const glm::vec3 boxStart = (settings.gridStart + (cellSize * glm::vec3(boxFirst)));
+		const glm::vec3 boxEnd = (settings.gridStart + (cellSize * glm::vec3(boxLast + 1)));
+
+		float minDist = INF;
+		int exitAxis = -1;
+		for (int axis = 0; axis < 3; axis++) {
+			if (std::isinf(invDirection[axis])) continue;
+			const float dist = ((((invDirection[axis] > 0) ? boxEnd[axis] : boxStart[axis]) - rayOrigin[axis]) * invDirection[axis]);
+			if (dist < minDist) {
+				minDist = dist;
+				exitAxis = axis;
+			}
+		}
+		if (exitAxis < 0) return false;
+
+		rayOrigin += query.direction * std::max(minDist, 0.0f);
+		glm::ivec3 nextCell = glm::clamp(glm::ivec3((rayOrigin - settings.gridStart) / cellSize), boxFirst, boxLast);
+		nextCell[exitAxis] = (invDirection[exitAxis] > 0) ? (boxLast[exitAxis] + 1) : (boxFirst[exitAxis] - 1);
+		if (nextCell[exitAxis] < 0 || nextCell[exitAxis] >= static_cast<int>(settings.numDivisions[exitAxis])) return false;
+		cellId = nextCell;
+		cell = paddedCell(settings.gridStart, cellSize, cellId);
+		return true;
+	}
+
+
+
+	/** ########################################################################################################### */
+	/** INTEGER DDA: */
+
+	/**
+	Integer 3D-DDA state: current cell, step direction, ray distance to the next boundary and distance between the boundaries per axis.
+	*/
+	struct DDA {
+		glm::ivec3 cellId;
+		glm::ivec3 step;
+		glm::vec3 tMax;
+		glm::vec3 tDelta;
+	};
+
+	inline static bool rayBoxRange(const Query& query, const glm::vec3& boxStart, const glm::vec3& boxEnd, float& enterDistance, float& exitDistance) {
+		enterDistance = 0.0f;
+		exitDistance = INF;
+		for (int axis = 0; axis < 3; axis++) {
+			if (query.direction[axis] == 0.0f) {
+				if (query.origin[axis] < boxStart[axis] || query.origin[axis] > boxEnd[axis]) return false;
+				continue;
+			}
+			const float startTime = ((boxStart[axis] - query.origin[axis]) / query.direction[axis]);
+			const float endTime = ((boxEnd[axis] - query.origin[axis]) / query.direction[axis]);
+			enterDistance = std::max(enterDistance, std::min(startTime, endTime));
+			exitDistance = std::min(exitDistance, std::max(startTime, endTime));
+		}
+		return (enterDistance <= exitDistance);
+	}
+
+	inline static glm::ivec3 cellAt(const Query& query, float dist, const glm::vec3& gridStart, const glm::vec3& cellSize, const glm::uvec3& numDivisions) {
+		return glm::clamp(glm::ivec3(glm::floor(((query.origin + (query.direction * dist)) - gridStart) / cellSize)), glm::ivec3(0), glm::ivec3(numDivisions) - 1);
+	}
+
+	inline static DDA startDDA(const Query& query, const glm::vec3& gridStart, const glm::vec3& cellSize, const glm::ivec3& cellId) {
+		DDA dda;
+		dda.cellId = cellId;
+		for (int axis = 0; axis < 3; axis++) {
+			if (query.direction[axis] > 0.0f) {
+				dda.step[axis] = 1;
+				dda.tMax[axis] = ((gridStart[axis] + (cellSize[axis] * static_cast<float>(cellId[axis] + 1)) - query.origin[axis]) / query.direction[axis]);
+				dda.tDelta[axis] = (cellSize[axis] / query.direction[axis]);
+			}
+			else if (query.direction[axis] < 0.0f) {
+				dda.step[axis] = -1;
+				dda.tMax[axis] = ((gridStart[axis] + (cellSize[axis] * static_cast<float>(cellId[axis])) - query.origin[axis]) / query.direction[axis]);
+				dda.tDelta[axis] = (-cellSize[axis] / query.direction[axis]);
+			}
+			else {
+				dda.step[axis] = 0;
+				dda.tMax[axis] = INF;
+				dda.tDelta[axis] = INF;
+			}
+		}
+		return dda;
+	}
+
+	inline static float cellExitDDA(const DDA& dda) {
+		return std::min(std::min(dda.tMax.x, dda.tMax.y), dda.tMax.z);
+	}
+
+	inline static bool stepDDA(DDA& dda, const glm::uvec3& numDivisions) {
+		const int axis = (dda.tMax.x < dda.tMax.y) ? ((dda.tMax.x < dda.tMax.z) ? 0 : 2) : ((dda.tMax.y < dda.tMax.z) ? 1 : 2);
+		dda.cellId[axis] += dda.step[axis];
+		if (dda.cellId[axis] < 0 || dda.cellId[axis] >= static_cast<int>(numDivisions[axis])) return false;
+		dda.tMax[axis] += dda.tDelta[axis];
+		return true;
+	}
+
+	inline static bool skipEmptyCellsDDA(const Query& query, const glm::vec3& cellSize, uint32_t radius, DDA& dda) {
+		const VoxelData::GridSettings& settings = query.data.settings;
+		const glm::ivec3 boxFirst = glm::max(dda.cellId - static_cast<int>(radius), glm::ivec3(0));
+		const glm::ivec3 boxLast = glm::min(dda.cellId + static_cast<int>(radius), glm::ivec3(settings.numDivisions) - 1);
+		float exitDistance = INF;
+		int exitAxis = -1;
+		for (int axis = 0; axis < 3; axis++) {
+			if (dda.step[axis] == 0) continue;
+			const int boundary = (dda.step[axis] > 0) ? (boxLast[axis] + 1) : boxFirst[axis];
+			const float dist = ((settings.gridStart[axis] + (cellSize[axis] * static_cast<float>(boundary)) - query.origin[axis]) / query.direction[axis]);
+			if (dist < exitDistance) {
+				exitDistance = dist;
+				exitAxis = axis;
+			}
+		}
+		if (exitAxis < 0) return false;
+		glm::ivec3 nextCell = glm::clamp(cellAt(query, exitDistance, settings.gridStart, cellSize, settings.numDivisions), boxFirst, boxLast);
+		nextCell[exitAxis] = (dda.step[exitAxis] > 0) ? (boxLast[exitAxis] + 1) : (boxFirst[exitAxis] - 1);
+		if (nextCell[exitAxis] < 0 || nextCell[exitAxis] >= static_cast<int>(settings.numDivisions[exitAxis])) return false;
+		dda = startDDA(query, settings.gridStart, cellSize, nextCell);
+		return true;
+	}
+
+
+
+	/** ########################################################################################################### */
+	/** CELL CONTENT: */
+
+	inline static void castInSubGrid(const Query& query, uint32_t firstSubCell, const Box& cell, float cellExit, VoxelTraversal::Hit& hit) {
+		const glm::uvec3& subDivisions = query.data.settings.subDivisions;
+		if (query.integerDDA) {
+			float enterDistance, exitDistance;
+			rayBoxRange(query, cell.start, cell.end, enterDistance, exitDistance);
+			const glm::vec3 subCellSize = ((cell.end - cell.start) / glm::vec3(subDivisions));
+			DDA dda = startDDA(query, cell.start, subCellSize, cellAt(query, enterDistance, cell.start, subCellSize, subDivisions));
+			while (true) {
+				castInRange(query, query.data.voxelRanges[firstSubCell + flatIndex(dda.cellId, subDivisions)], cell, std::min(cellExitDDA(dda), cellExit), hit);
+				if (!std::isinf(hit.distance)) return;
+				else if (!stepDDA(dda, subDivisions)) return;
+			}
+		}
+
+		// Top-level cell bounds are slightly expanded, so we shrink them back:
+		Box grid;
+		{
+			grid.start = cell.start + CELL_PADDING;
+			grid.end = cell.end - CELL_PADDING;
+		}
+		glm::ivec3 subCellId;
+		glm::vec3 rayOrigin;
+		if (!findFirstCell(query, grid, subDivisions, subCellId, rayOrigin)) return;
+		const glm::vec3 subCellSize = ((grid.end - grid.start) / glm::vec3(subDivisions));
+		Box subCell = paddedCell(grid.start, subCellSize, subCellId);
+		while (true) {
+			castInRange(query, query.data.voxelRanges[firstSubCell + flatIndex(subCellId, subDivisions)], subCell, cellExit, hit);
+			if (!std::isinf(hit.distance)) return;
+			else if (!findNextCell(rayOrigin, query.direction, subCellSize, subDivisions, subCell, subCellId)) return;
+		}
+	}
+
+	inline static bool castInCell(const Query& query, const glm::ivec3& cellId, const Box& cell, float cellExit, VoxelTraversal::Hit& hit) {
+		VoxelTraversal::Hit cellHit = {};
+		cellHit.distance = INF;
+		const size_t voxelId = flatIndex(cellId, query.data.settings.numDivisions);
+		if (query.data.layout == VoxelData::LAYOUT_COMPACT) {
+			const VoxelData::VoxelRange& range = query.data.voxelRanges[voxelId];
+			if ((range.count & VoxelData::VoxelRange::SUB_GRID_FLAG) != 0) castInSubGrid(query, range.offset, cell, cellExit, cellHit);
+			else castInRange(query, range, cell, cellExit, cellHit);
+		}
+		else for (VoxelData::VoxelEntryId entryId = query.data.voxels[voxelId]; entryId != NO_ENTRY; entryId = query.data.voxelEntries[entryId].next) {
+			testTriangle(query, query.data.voxelEntries[entryId].triangle, cell, cellExit, cellHit);
+			if (query.anyHit && !std::isinf(cellHit.distance)) break;
+		}
+		if (std::isinf(cellHit.distance)) return false;
+		hit = cellHit;
+		return true;
+	}
+
+	inline static uint32_t emptyDistance(const Query& query, const glm::ivec3& cellId) {
+		return query.data.emptyDistances.empty() ? 0u : query.data.emptyDistances[flatIndex(cellId, query.data.settings.numDivisions)];
+	}
+
+	inline static bool raycastCellStepping(const Query& query, VoxelTraversal::Hit& hit) {
+		const VoxelData::GridSettings& settings = query.data.settings;
+		glm::ivec3 cellId;
+		glm::vec3 rayOrigin;
+		if (!findFirstCell(query, Box{ settings.gridStart, settings.gridEnd }, settings.numDivisions, cellId, rayOrigin)) return false;
+		const glm::vec3 cellSize = ((settings.gridEnd - settings.gridStart) / glm::vec3(settings.numDivisions));
+		Box cell = paddedCell(settings.gridStart, cellSize, cellId);
+		while (true) {
+			if (glm::dot(rayOrigin - query.origin, query.direction) >= query.maxDistance) return false;
+			const uint32_t skipDistance = emptyDistance(query, cellId);
+			if (skipDistance > 1) {
+				if (!skipEmptyCells(query, rayOrigin, cellSize, skipDistance - 1, cell, cellId)) return false;
+			}
+			else if (castInCell(query, cellId, cell, INF, hit)) return true;
+			else if (!findNextCell(rayOrigin, query.direction, cellSize, settings.numDivisions, cell, cellId)) return false;
+		}
+	}
+
+	inline static bool raycastDDA(const Query& query, VoxelTraversal::Hit& hit) {
+		const VoxelData::GridSettings& settings = query.data.settings;
+		float enterDistance, exitDistance;
+		if (!rayBoxRange(query, settings.gridStart, settings.gridEnd, enterDistance, exitDistance)) return false;
+		const glm::vec3 cellSize = ((settings.gridEnd - settings.gridStart) / glm::vec3(settings.numDivisions));
+		DDA dda = startDDA(query, settings.gridStart, cellSize, cellAt(query, enterDistance, settings.gridStart, cellSize, settings.numDivisions));
+		while (true) {
+			const uint32_t skipDistance = emptyDistance(query, dda.cellId);
+			if (skipDistance > 1) {
+				if (!skipEmptyCellsDDA(query, cellSize, skipDistance - 1, dda)) return false;
+			}
+			else {
+				Box cell;
+				{
+					cell.start = ((cellSize * glm::vec3(dda.cellId)) + settings.gridStart);
+					cell.end = (cell.start + cellSize);
+				}
+				if (castInCell(query, dda.cellId, cell, cellExitDDA(dda), hit)) return true;
+				else if (cellExitDDA(dda) >= query.maxDistance) return false;
+				else if (!stepDDA(dda, settings.numDivisions)) return false;
+			}
+		}
+	}
+}
+
+namespace Test {
+	bool VoxelTraversal::castRayOnTriangle(const glm::vec3& origin, const glm::vec3& direction,
+		const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& distance, glm::vec3& hitPoint) {
+		glm::vec3 barycentrics;
+		if (!RayTriangle::cast(RayTriangle::prepare(origin, direction), a, b, c, distance, barycentrics)) return false;
+		hitPoint = (origin + (direction * distance));
+		return true;
+	}
+
+	VoxelTraversal::VoxelTraversal(const VoxelData& data, const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer)
+		: m_data(data), m_verts(verts), m_indices(indexBuffer) { }
+
+	bool VoxelTraversal::raycast(const glm::vec3& origin, const glm::vec3& direction, Mode mode, Hit& hit)const {
+		const Query query = { m_data, m_verts, m_indices, origin, direction, (mode == MODE_INTEGER_DDA), RayTriangle::prepare(origin, direction), false, 0.0f, INF };
+		if (query.integerDDA) return raycastDDA(query, hit);
+		else return raycastCellStepping(query, hit);
+	}
+
+	bool VoxelTraversal::occluded(const glm::vec3& origin, const glm::vec3& direction, Mode mode, float minDistance, float maxDistance)const {
+		const Query query = { m_data, m_verts, m_indices, origin, direction, (mode == MODE_INTEGER_DDA), RayTriangle::prepare(origin, direction), true, minDistance, maxDistance };
+		Hit hit = {};
+		if (query.integerDDA) return raycastDDA(query, hit);
+		else return raycastCellStepping(query, hit);
+	}
+
+	bool VoxelTraversal::raycastBruteForce(const glm::vec3& origin, const glm::vec3& direction, Hit& hit)const {
+		const RayTriangle::Ray ray = RayTriangle::prepare(origin, direction);
+		Hit closest = {};
+		closest.distance = INF;
+		for (uint32_t triangle = 0; (triangle + 2) < m_indices.size(); triangle += 3) {
+			float dist;
+			glm::vec3 barycentrics;
+			if (RayTriangle::cast(ray, m_verts[m_indices[triangle]].position, m_verts[m_indices[triangle + 1]].position, m_verts[m_indices[triangle + 2]].position, dist, barycentrics))
+				if (dist < closest.distance) {
+					closest.distance = dist;
+					closest.point = (origin + (direction * dist));
+					closest.triangle = triangle;
+					closest.barycentrics = barycentrics;
+				}
+		}
+		if (std::isinf(closest.distance)) return false;
+		hit = closest;
+		return true;
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "VoxelData.h"
+#include "RayTriangle.h"
+
+namespace Test {
+	/**
+	 * CPU reference of the ray traversal from RayTracedDiffuseVox.frag (same cell walks, empty space skipping, sub-grids and triangle tests),
+	 * so that traversal speed and hit correctness can be checked without a GPU.
+	 * Mailboxing is left out, since it does not change the results.
+	 */
+	class VoxelTraversal {
+	public:
+		/**
+		 * Cell walk implementation (RayTracedMesh selects the same one on GPU through a specialization constant).
+		 */
+		enum Mode : uint32_t {
+			// Stepping through padded floating point cell bounds (findNextCell).
+			MODE_CELL_STEPPING = 0,
+
+			// Amanatides-Woo 3D-DDA over integer cell coordinates (tMax/tDelta computed once per ray).
+			MODE_INTEGER_DDA = 1
+		};
+
+		/**
+		 * Closest hit along a ray.
+		 */
+		struct Hit {
+			// Distance from the ray origin (in ray direction lengths).
+			float distance;
+
+			// Index buffer offset of the triangle (triangle index * 3).
+			uint32_t triangle;
+
+			// Hit point.
+			glm::vec3 point;
+
+			// Weights of the triangle vertices at the hit point (for the attribute interpolation).
+			glm::vec3 barycentrics;
+		};
+
+		/**
+		Casts ray on a triangle with the watertight kernel from the ray tracing shaders (front faces only; see RayTriangle).
+		@param origin Ray origin.
+		@param direction Ray direction.
+		@param a First vertex.
+		@param b Second vertex.
+		@param c Third vertex.
+		@param distance Hit distance (written only on hit).
+		@param hitPoint Hit point (written only on hit).
+		@return true, if the ray hits the triangle.
+		*/
+		static bool castRayOnTriangle(const glm::vec3& origin, const glm::vec3& direction,
+			const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& distance, glm::vec3& hitPoint);
+
+		/**
+		Creates a traversal context (nothing gets copied, so the arguments have to outlive the object).
+		@param data Voxel data, built for the geometry.
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		*/
+		VoxelTraversal(const VoxelData& data, const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer);
+
+		/**
+		Finds the closest hit by walking the voxel grid.
+		@param origin Ray origin.
+		@param direction Ray direction (normalized).
+		@param mode Cell walk implementation.
+		@param hit Closest hit (written only on hit).
+		@return true, if the ray hit anything.
+		*/
+		bool raycast(const glm::vec3& origin, const glm::vec3& direction, Mode mode, Hit& hit)const;
+
+		/**
+		Tells, if anything gets hit within [minDistance, maxDistance) by walking the voxel grid (mirror of occluded() from the shaders; ends on the first such hit).
+		@param origin Ray origin.
+		@param direction Ray direction (normalized).
+		@param mode Cell walk implementation.
+		@param minDistance Minimal hit distance.
+		@param maxDistance Maximal hit distance (exclusive).
+		@return true, if the ray is blocked.
+		*/
+		bool occluded(const glm::vec3& origin, const glm::vec3& direction, Mode mode, float minDistance, float maxDistance)const;
+
+		/**
+		Finds the closest hit by testing every single triangle (ground truth for raycast()).
+		@param origin Ray origin.
+		@param direction Ray direction (normalized).
+		@param hit Closest hit (written only on hit).
+		@return true, if the ray hit anything.
+		*/
+		bool raycastBruteForce(const glm::vec3& origin, const glm::vec3& direction, Hit& hit)const;
+
+
+	private:
+		const VoxelData& m_data;
+		const std::vector<PNCVertex>& m_verts;
+		const std::vector<uint32_t>& m_indices;
+
+		VoxelTraversal(const VoxelTraversal&) = delete;
+		VoxelTraversal& operator=(const VoxelTraversal&) = delete;
+	};
+}
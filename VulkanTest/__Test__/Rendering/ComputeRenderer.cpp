@@ -0,0 +1,700 @@
+#include "ComputeRenderer.h"
+#include "../Helpers.h"
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// Work group dimensions (has to match TILE_SIZE from RayTracedDiffuse.comp):
+	static const uint32_t TILE_SIZE = 8;
+
+	// Storage image format (has to match the image format qualifier from RayTracedDiffuse.comp):
+	static const VkFormat OUTPUT_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+	// Sample/history image format (has to match the image format qualifiers from RayTracedDiffuse.comp; color and hit distance):
+	static const VkFormat HISTORY_FORMAT = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+	// Render scale gets rounded to multiples of this before picking the render extent (so that the command buffers do not have to be re-recorded on every tiny change):
+	static const float SCALE_STEP = (1.0f / 32.0f);
+
+	// Measured frame time gets clamped to this factor of the target (or its inverse), so that a stall or a renderer switch can not throw the scale too far in one go:
+	static const float MAX_FRAME_TIME_RATIO = 4.0f;
+
+	// Push constant block of RayTracedDiffuse.comp (extent of the output image region, rays get traced into):
+	struct RenderArea {
+		int32_t width;
+		int32_t height;
+	};
+
+	inline static VkImageMemoryBarrier imageBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess) {
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		return barrier;
+	}
+
+	inline static bool transitionToGeneralLayout(Test::GraphicsDevice& device, VkImage image) {
+		VkCommandBufferAllocateInfo allocInfo = {};
+		{
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandPool = device.commandPool();
+			allocInfo.commandBufferCount = 1;
+		}
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device.logicalDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) return false;
+		{
+			VkCommandBufferBeginInfo begin = {};
+			begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(commandBuffer, &begin);
+		}
+		{
+			VkImageMemoryBarrier barrier = imageBarrier(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+		vkEndCommandBuffer(commandBuffer);
+		VkSubmitInfo info = {};
+		{
+			info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			info.commandBufferCount = 1;
+			info.pCommandBuffers = &commandBuffer;
+		}
+		const bool submitted = (vkQueueSubmit(device.graphicsQueue(), 1, &info, VK_NULL_HANDLE) == VK_SUCCESS);
+		vkQueueWaitIdle(device.graphicsQueue());
+		vkFreeCommandBuffers(device.logicalDevice(), device.commandPool(), 1, &commandBuffer);
+		return submitted;
+	}
+}
+
+namespace Test {
+	ComputeRenderer::ComputeRenderer(
+		const std::shared_ptr<GraphicsDevice>& device, const std::shared_ptr<SwapChain>& swapChain,
+		const std::shared_ptr<RayTracedMesh>& object, void(*logFn)(const char*))
+		: m_graphicsDevice(device), m_swapChain(swapChain)
+		, m_object(object)
+		, m_shaderModule(VK_NULL_HANDLE)
+		, m_descriptorSetLayout(VK_NULL_HANDLE), m_outputSetLayout(VK_NULL_HANDLE)
+		, m_pipelineLayout(VK_NULL_HANDLE), m_computePipeline(VK_NULL_HANDLE)
+		, m_temporalParams(device, nullptr, logFn), m_traceCounter(device, 1u, nullptr, logFn)
+		, m_descriptorPool(VK_NULL_HANDLE), m_descriptorSets{ VK_NULL_HANDLE, VK_NULL_HANDLE }
+		, m_dynamicResolution({ 0.0f, 1.0f, 1.0f, 0.0f }), m_renderScale(1.0f), m_renderExtent({ 0, 0 }), m_blitFilter(VK_FILTER_NEAREST)
+		, m_lastFrameDate(std::chrono::system_clock::now())
+		, m_timestampQueryPool(VK_NULL_HANDLE), m_timestampPeriod(0.0f), m_timestampMask(0), m_timestampsWritten(false)
+		, m_temporalReuse({ 0, false }), m_previousTransform(*object->transform()), m_historyExtent({ 0, 0 }), m_frameIndex(0), m_tracedFraction(1.0f)
+		, m_initialized(false), m_logFn(logFn) {
+
+		// Stretching the scaled down image is bilinear, if the output format allows it:
+		{
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(m_graphicsDevice->physicalDevice(), OUTPUT_FORMAT, &properties);
+			if ((properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0)
+				m_blitFilter = VK_FILTER_LINEAR;
+		}
+
+		if (m_object->computeShader() == nullptr)
+			log("[Error] ComputeRenderer - Object has no compute shader variant.");
+		else if (m_temporalParams.stagingBuffer() == VK_NULL_HANDLE || m_traceCounter.stagingBuffer() == VK_NULL_HANDLE)
+			log("[Error] ComputeRenderer - Failed to create temporal reuse buffers.");
+		else if (!swapChainSupported())
+			log("[Error] ComputeRenderer - Swap chain images can not be used as blit destination.");
+		else if (!createShaderModule(m_graphicsDevice->logicalDevice(), m_object->computeShader(), &m_shaderModule)) {
+			std::stringstream stream;
+			stream << "[Error] ComputeRenderer - Could not create compute shader module '" << m_object->computeShader() << "'.";
+			log(stream.str().c_str());
+		}
+		else if (createDescriptorSetLayouts() && createPipeline())
+			createTimestampQueryPool();
+
+		m_swapChainRecreationListenerId = m_swapChain->addRecreationListener(std::bind(&ComputeRenderer::recreateSwapChainDependedObjects, this));
+	}
+
+	ComputeRenderer::~ComputeRenderer() {
+		m_swapChain->removeRecreationListener(m_swapChainRecreationListenerId);
+
+		clearSwapChainDependedObjects();
+
+		if (m_timestampQueryPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(m_graphicsDevice->logicalDevice(), m_timestampQueryPool, nullptr);
+
+		if (m_computePipeline != VK_NULL_HANDLE)
+			vkDestroyPipeline(m_graphicsDevice->logicalDevice(), m_computePipeline, nullptr);
+
+		if (m_pipelineLayout != VK_NULL_HANDLE)
+			vkDestroyPipelineLayout(m_graphicsDevice->logicalDevice(), m_pipelineLayout, nullptr);
+
+		if (m_outputSetLayout != VK_NULL_HANDLE)
+			vkDestroyDescriptorSetLayout(m_graphicsDevice->logicalDevice(), m_outputSetLayout, nullptr);
+
+		if (m_descriptorSetLayout != VK_NULL_HANDLE)
+			vkDestroyDescriptorSetLayout(m_graphicsDevice->logicalDevice(), m_descriptorSetLayout, nullptr);
+
+		if (m_shaderModule != VK_NULL_HANDLE)
+			vkDestroyShaderModule(m_graphicsDevice->logicalDevice(), m_shaderModule, nullptr);
+	}
+
+	bool ComputeRenderer::initialized() {
+		return m_initialized;
+	}
+
+	void ComputeRenderer::render() {
+		if (!m_initialized) return;
+		if (!updateRenderScale()) return;
+
+		size_t imageId;
+		VkSemaphore* waitSemaphores;
+		VkSemaphore* renderSemaphores;
+		if (!m_swapChain->aquireNextImage(imageId, waitSemaphores, renderSemaphores)) return;
+
+		vkQueueWaitIdle(m_graphicsDevice->graphicsQueue());
+
+		m_object->updateResources();
+		updateTemporalParams();
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+		// Tracing does not touch the swap chain image, so only the blit has to wait for it:
+		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_TRANSFER_BIT };
+		{
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = waitSemaphores;
+			submitInfo.pWaitDstStageMask = waitStages;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &m_commandBuffers[imageId];
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = renderSemaphores;
+		}
+		if (vkQueueSubmit(m_graphicsDevice->graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			log("[Error] ComputeRenderer - Failed to submit dispatch command buffer.");
+		}
+		else m_timestampsWritten = (m_timestampQueryPool != VK_NULL_HANDLE);
+		m_swapChain->present(imageId);
+
+		// Whatever got rendered now, is the history for the next frame:
+		m_previousTransform = (*m_object->transform());
+		m_historyExtent = m_renderExtent;
+		m_frameIndex++;
+	}
+
+	float ComputeRenderer::renderScale()const {
+		const VkExtent2D size = m_swapChain->size();
+		return (size.width > 0) ? (static_cast<float>(m_renderExtent.width) / static_cast<float>(size.width)) : 1.0f;
+	}
+
+	const ComputeRenderer::DynamicResolution& ComputeRenderer::dynamicResolution()const {
+		return m_dynamicResolution;
+	}
+
+	void ComputeRenderer::setDynamicResolution(const DynamicResolution& settings) {
+		m_dynamicResolution = settings;
+	}
+
+	float ComputeRenderer::tracedFraction()const {
+		return m_tracedFraction;
+	}
+
+	const ComputeRenderer::TemporalReuse& ComputeRenderer::temporalReuse()const {
+		return m_temporalReuse;
+	}
+
+	void ComputeRenderer::setTemporalReuse(const TemporalReuse& settings) {
+		m_temporalReuse = settings;
+	}
+
+
+
+	void ComputeRenderer::log(const char* message)const {
+		if (m_logFn != nullptr)
+			m_logFn(message);
+	}
+
+	bool ComputeRenderer::swapChainSupported()const {
+		if ((m_swapChain->imageUsage() & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0) return false;
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(m_graphicsDevice->physicalDevice(), m_swapChain->format().format, &properties);
+		return ((properties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0);
+	}
+
+	bool ComputeRenderer::createDescriptorSetLayouts() {
+		// Set 0 (object bindings, the same ones the fragment shader variant gets):
+		{
+			std::vector<VkDescriptorSetLayoutBinding> bindings(m_object->numLayoutBindings());
+			for (size_t i = 0; i < bindings.size(); i++) {
+				bindings[i] = m_object->layoutBinding((uint32_t)i);
+				bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			}
+			VkDescriptorSetLayoutCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			info.bindingCount = static_cast<uint32_t>(bindings.size());
+			info.pBindings = bindings.data();
+			if (vkCreateDescriptorSetLayout(m_graphicsDevice->logicalDevice(), &info, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+				m_descriptorSetLayout = VK_NULL_HANDLE;
+				log("[Error] ComputeRenderer - Failed to create descriptor set layout.");
+				return false;
+			}
+		}
+		// Set 1 (output image, temporal parameters, sample image, history image and trace counter):
+		{
+			const VkDescriptorType TYPES[] = {
+				VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+			};
+			VkDescriptorSetLayoutBinding bindings[sizeof(TYPES) / sizeof(VkDescriptorType)];
+			for (uint32_t i = 0; i < (sizeof(TYPES) / sizeof(VkDescriptorType)); i++) {
+				VkDescriptorSetLayoutBinding& binding = bindings[i];
+				binding = {};
+				binding.binding = i;
+				binding.descriptorType = TYPES[i];
+				binding.descriptorCount = 1;
+				binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+				binding.pImmutableSamplers = nullptr;
+			}
+			VkDescriptorSetLayoutCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			info.bindingCount = (sizeof(bindings) / sizeof(VkDescriptorSetLayoutBinding));
+			info.pBindings = bindings;
+			if (vkCreateDescriptorSetLayout(m_graphicsDevice->logicalDevice(), &info, nullptr, &m_outputSetLayout) != VK_SUCCESS) {
+				m_outputSetLayout = VK_NULL_HANDLE;
+				log("[Error] ComputeRenderer - Failed to create output image descriptor set layout.");
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ComputeRenderer::createPipeline() {
+		{
+			VkDescriptorSetLayout setLayouts[] = { m_descriptorSetLayout, m_outputSetLayout };
+			VkPushConstantRange pushConstantRange = {};
+			{
+				pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+				pushConstantRange.offset = 0;
+				pushConstantRange.size = sizeof(RenderArea);
+			}
+			VkPipelineLayoutCreateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+				info.setLayoutCount = (sizeof(setLayouts) / sizeof(VkDescriptorSetLayout));
+				info.pSetLayouts = setLayouts;
+				info.pushConstantRangeCount = 1;
+				info.pPushConstantRanges = &pushConstantRange;
+			}
+			if (vkCreatePipelineLayout(m_graphicsDevice->logicalDevice(), &info, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+				m_pipelineLayout = VK_NULL_HANDLE;
+				log("[Error] ComputeRenderer - Failed to create pipeline layout.");
+				return false;
+			}
+		}
+		{
+			VkComputePipelineCreateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+				info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+				info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+				info.stage.module = m_shaderModule;
+				info.stage.pName = "main";
+				info.stage.pSpecializationInfo = m_object->fragmentSpecialization();
+				info.layout = m_pipelineLayout;
+				info.basePipelineHandle = VK_NULL_HANDLE;
+				info.basePipelineIndex = -1;
+			}
+			if (vkCreateComputePipelines(m_graphicsDevice->logicalDevice(), VK_NULL_HANDLE, 1, &info, nullptr, &m_computePipeline) != VK_SUCCESS) {
+				m_computePipeline = VK_NULL_HANDLE;
+				log("[Error] ComputeRenderer - Failed to create compute pipeline.");
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ComputeRenderer::createTimestampQueryPool() {
+		// Graphics queue may not support timestamps at all (render scale falls back to the CPU clock in that case):
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_graphicsDevice->physicalDevice(), &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_graphicsDevice->physicalDevice(), &familyCount, families.data());
+		const uint32_t validBits = families[m_graphicsDevice->queueFamilies().graphics.value()].timestampValidBits;
+		if (validBits == 0) return false;
+		m_timestampMask = (validBits >= 64) ? (~uint64_t(0)) : ((uint64_t(1) << validBits) - 1);
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(m_graphicsDevice->physicalDevice(), &properties);
+			m_timestampPeriod = properties.limits.timestampPeriod;
+		}
+
+		VkQueryPoolCreateInfo info = {};
+		{
+			info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			info.queryCount = 2;
+		}
+		if (vkCreateQueryPool(m_graphicsDevice->logicalDevice(), &info, nullptr, &m_timestampQueryPool) != VK_SUCCESS) {
+			m_timestampQueryPool = VK_NULL_HANDLE;
+			log("[Error] ComputeRenderer - Failed to create timestamp query pool.");
+			return false;
+		}
+		return true;
+	}
+
+	bool ComputeRenderer::createOutputImage() {
+		m_outputImage.reset(new Image(m_graphicsDevice, m_swapChain->size(), OUTPUT_FORMAT, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, m_logFn));
+		if (!m_outputImage->initialized()) {
+			m_outputImage.reset();
+		m_sampleImage.reset();
+		m_historyImage.reset();
+			log("[Error] ComputeRenderer - Failed to create output image.");
+			return false;
+		}
+		return true;
+	}
+
+	bool ComputeRenderer::createHistoryImages() {
+		m_sampleImage.reset(new Image(m_graphicsDevice, m_swapChain->size(), HISTORY_FORMAT, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, m_logFn));
+		m_historyImage.reset(new Image(m_graphicsDevice, m_swapChain->size(), HISTORY_FORMAT, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT, m_logFn));
+		if (!(m_sampleImage->initialized() && m_historyImage->initialized())) {
+			m_sampleImage.reset();
+			m_historyImage.reset();
+			log("[Error] ComputeRenderer - Failed to create history images.");
+			return false;
+		}
+		// History stays in general layout from here on (command buffers only add memory barriers around it):
+		else if (!transitionToGeneralLayout(*m_graphicsDevice, m_historyImage->image())) {
+			log("[Error] ComputeRenderer - Failed to transition history image layout.");
+			return false;
+		}
+		m_historyExtent = { 0, 0 };
+		return true;
+	}
+
+	bool ComputeRenderer::createDescriptorPool() {
+		// Descriptor pool:
+		{
+			VkDescriptorPoolSize sizes[3];
+			{
+				VkDescriptorPoolSize& size = sizes[0];
+				size = {};
+				size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				size.descriptorCount = m_object->numLayoutBindings() + 1;
+			}
+			{
+				VkDescriptorPoolSize& size = sizes[1];
+				size = {};
+				size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				size.descriptorCount = m_object->numLayoutBindings() + 1;
+			}
+			{
+				VkDescriptorPoolSize& size = sizes[2];
+				size = {};
+				size.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				size.descriptorCount = 3;
+			}
+			VkDescriptorPoolCreateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+				info.poolSizeCount = sizeof(sizes) / sizeof(VkDescriptorPoolSize);
+				info.pPoolSizes = sizes;
+				info.maxSets = (sizeof(m_descriptorSets) / sizeof(VkDescriptorSet));
+			}
+			if (vkCreateDescriptorPool(m_graphicsDevice->logicalDevice(), &info, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+				m_descriptorPool = VK_NULL_HANDLE;
+				log("[Error] ComputeRenderer - Failed to create descriptor pool.");
+				return false;
+			}
+		}
+		// Descriptor sets:
+		{
+			VkDescriptorSetLayout setLayouts[] = { m_descriptorSetLayout, m_outputSetLayout };
+			VkDescriptorSetAllocateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+				info.descriptorPool = m_descriptorPool;
+				info.descriptorSetCount = (sizeof(setLayouts) / sizeof(VkDescriptorSetLayout));
+				info.pSetLayouts = setLayouts;
+			}
+			if (vkAllocateDescriptorSets(m_graphicsDevice->logicalDevice(), &info, m_descriptorSets) != VK_SUCCESS) {
+				m_descriptorSets[0] = m_descriptorSets[1] = VK_NULL_HANDLE;
+				log("[Error] ComputeRenderer - Failed to allocate descriptor sets.");
+				return false;
+			}
+
+			std::vector<VkWriteDescriptorSet> writes(m_object->numLayoutBindings());
+			for (uint32_t descId = 0; descId < m_object->numLayoutBindings(); descId++) {
+				VkWriteDescriptorSet write = m_object->descriptorBinding(descId);
+				write.dstSet = m_descriptorSets[0];
+				writes[descId] = write;
+			}
+			const VkImageView IMAGE_VIEWS[] = { m_outputImage->view(), m_sampleImage->view(), m_historyImage->view() };
+			const uint32_t IMAGE_BINDINGS[] = { 0, 2, 3 };
+			VkDescriptorImageInfo imageInfos[sizeof(IMAGE_VIEWS) / sizeof(VkImageView)];
+			for (size_t i = 0; i < (sizeof(IMAGE_VIEWS) / sizeof(VkImageView)); i++) {
+				VkDescriptorImageInfo& imageInfo = imageInfos[i];
+				imageInfo = {};
+				imageInfo.sampler = VK_NULL_HANDLE;
+				imageInfo.imageView = IMAGE_VIEWS[i];
+				imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+				VkWriteDescriptorSet write = {};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = m_descriptorSets[1];
+				write.dstBinding = IMAGE_BINDINGS[i];
+				write.dstArrayElement = 0;
+				write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+				write.descriptorCount = 1;
+				write.pImageInfo = &imageInfo;
+				writes.push_back(write);
+			}
+			VkDescriptorBufferInfo paramsInfo = {};
+			{
+				paramsInfo.buffer = m_temporalParams.stagingBuffer();
+				paramsInfo.offset = 0;
+				paramsInfo.range = sizeof(TemporalParams);
+			}
+			VkDescriptorBufferInfo counterInfo = {};
+			{
+				counterInfo.buffer = m_traceCounter.stagingBuffer();
+				counterInfo.offset = 0;
+				counterInfo.range = VK_WHOLE_SIZE;
+			}
+			{
+				VkWriteDescriptorSet write = {};
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = m_descriptorSets[1];
+				write.dstArrayElement = 0;
+				write.descriptorCount = 1;
+				write.dstBinding = 1;
+				write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				write.pBufferInfo = &paramsInfo;
+				writes.push_back(write);
+				write.dstBinding = 4;
+				write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				write.pBufferInfo = &counterInfo;
+				writes.push_back(write);
+			}
+			vkUpdateDescriptorSets(m_graphicsDevice->logicalDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+		return true;
+	}
+
+	bool ComputeRenderer::createCommandBuffers() {
+		m_commandBuffers.resize(m_swapChain->frameBufferCount());
+		{
+			VkCommandBufferAllocateInfo info = {};
+			{
+				info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				info.commandPool = m_graphicsDevice->commandPool();
+				info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				info.commandBufferCount = (uint32_t)m_commandBuffers.size();
+			}
+			if (vkAllocateCommandBuffers(m_graphicsDevice->logicalDevice(), &info, m_commandBuffers.data()) != VK_SUCCESS) {
+				m_commandBuffers.clear();
+				log("[Error] ComputeRenderer - Failed to allocate command buffers.");
+				return false;
+			}
+		}
+		const VkExtent2D size = m_swapChain->size();
+		m_renderExtent = scaledExtent(m_renderScale);
+		const RenderArea renderArea = { static_cast<int32_t>(m_renderExtent.width), static_cast<int32_t>(m_renderExtent.height) };
+		for (size_t i = 0; i < m_commandBuffers.size(); i++) {
+			VkCommandBuffer commandBuffer = m_commandBuffers[i];
+			{
+				VkCommandBufferBeginInfo info = {};
+				info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				info.flags = 0;
+				info.pInheritanceInfo = nullptr;
+				if (vkBeginCommandBuffer(commandBuffer, &info) != VK_SUCCESS) {
+					log("[Error] ComputeRenderer - Failed to begin recording command buffer.");
+					return false;
+				}
+			}
+
+			// Trace (previous content of the output and sample images is irrelevant, but the last blit and copy have to be done reading them; history has to be fully copied in):
+			{
+				VkImageMemoryBarrier barriers[3] = {
+					imageBarrier(m_outputImage->image(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT),
+					imageBarrier(m_sampleImage->image(), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT),
+					imageBarrier(m_historyImage->image(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT)
+				};
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+					0, 0, nullptr, 0, nullptr, (sizeof(barriers) / sizeof(VkImageMemoryBarrier)), barriers);
+			}
+			if (m_timestampQueryPool != VK_NULL_HANDLE) {
+				vkCmdResetQueryPool(commandBuffer, m_timestampQueryPool, 0, 2);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampQueryPool, 0);
+			}
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0,
+				(sizeof(m_descriptorSets) / sizeof(VkDescriptorSet)), m_descriptorSets, 0, nullptr);
+			vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(RenderArea), &renderArea);
+			vkCmdDispatch(commandBuffer, (m_renderExtent.width + TILE_SIZE - 1) / TILE_SIZE, (m_renderExtent.height + TILE_SIZE - 1) / TILE_SIZE, 1);
+			if (m_timestampQueryPool != VK_NULL_HANDLE)
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, m_timestampQueryPool, 1);
+
+			// Copy (stretch, if the render extent is scaled down) to the swap chain image and keep the samples as the history for the next frame:
+			{
+				VkImageMemoryBarrier barriers[4] = {
+					imageBarrier(m_outputImage->image(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+					imageBarrier(m_swapChain->image(i), VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT),
+					imageBarrier(m_sampleImage->image(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+					imageBarrier(m_historyImage->image(), VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT)
+				};
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+					0, 0, nullptr, 0, nullptr, (sizeof(barriers) / sizeof(VkImageMemoryBarrier)), barriers);
+			}
+			{
+				VkImageCopy region = {};
+				region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.srcSubresource.mipLevel = 0;
+				region.srcSubresource.baseArrayLayer = 0;
+				region.srcSubresource.layerCount = 1;
+				region.dstSubresource = region.srcSubresource;
+				region.extent = { m_renderExtent.width, m_renderExtent.height, 1 };
+				vkCmdCopyImage(commandBuffer,
+					m_sampleImage->image(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					m_historyImage->image(), VK_IMAGE_LAYOUT_GENERAL,
+					1, &region);
+			}
+			{
+				VkImageBlit region = {};
+				region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.srcSubresource.mipLevel = 0;
+				region.srcSubresource.baseArrayLayer = 0;
+				region.srcSubresource.layerCount = 1;
+				region.srcOffsets[1] = { renderArea.width, renderArea.height, 1 };
+				region.dstSubresource = region.srcSubresource;
+				region.dstOffsets[1] = { static_cast<int32_t>(size.width), static_cast<int32_t>(size.height), 1 };
+				vkCmdBlitImage(commandBuffer,
+					m_outputImage->image(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					m_swapChain->image(i), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					1, &region, (m_renderExtent.width == size.width && m_renderExtent.height == size.height) ? VK_FILTER_NEAREST : m_blitFilter);
+			}
+			{
+				VkImageMemoryBarrier barrier = imageBarrier(m_swapChain->image(i),
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ACCESS_TRANSFER_WRITE_BIT, 0);
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+			}
+			// Trace counter gets read back on CPU:
+			{
+				VkMemoryBarrier barrier = {};
+				barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+				barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+				barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+				vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			}
+
+			if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+				log("[Error] ComputeRenderer - Failed to end recording command buffer.");
+				return false;
+			}
+		}
+		return true;
+	}
+
+	VkExtent2D ComputeRenderer::scaledExtent(float scale)const {
+		const VkExtent2D size = m_swapChain->size();
+		const float steppedScale = std::min(std::max(std::round(scale / SCALE_STEP) * SCALE_STEP, SCALE_STEP), 1.0f);
+		VkExtent2D extent;
+		extent.width = std::max(static_cast<uint32_t>(size.width * steppedScale), 1u);
+		extent.height = std::max(static_cast<uint32_t>(size.height * steppedScale), 1u);
+		return extent;
+	}
+
+	bool ComputeRenderer::updateRenderScale() {
+		const std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
+		float frameTime = std::chrono::duration<float, std::milli>(now - m_lastFrameDate).count();
+		m_lastFrameDate = now;
+		// GPU time of the previous dispatch (waits for the previous frame, which render() would do anyway; no measurement yet means no adjustment):
+		if (m_timestampQueryPool != VK_NULL_HANDLE) {
+			uint64_t timestamps[2];
+			if (m_timestampsWritten && vkGetQueryPoolResults(m_graphicsDevice->logicalDevice(), m_timestampQueryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) == VK_SUCCESS)
+				frameTime = (static_cast<float>((timestamps[1] - timestamps[0]) & m_timestampMask) * m_timestampPeriod / 1000000.0f);
+			else frameTime = m_dynamicResolution.targetFrameTime;
+			m_timestampsWritten = false;
+		}
+
+		const float maxScale = std::min(std::max(m_dynamicResolution.maxScale, SCALE_STEP), 1.0f);
+		const float minScale = std::min(std::max(m_dynamicResolution.minScale, SCALE_STEP), maxScale);
+		if (m_dynamicResolution.targetFrameTime <= 0.0f) m_renderScale = maxScale;
+		else {
+			// Traced pixel count goes with the square of the scale:
+			const float ratio = std::min(std::max(m_dynamicResolution.targetFrameTime / std::max(frameTime, 0.001f), 1.0f / MAX_FRAME_TIME_RATIO), MAX_FRAME_TIME_RATIO);
+			const float idealScale = (m_renderScale * std::sqrt(ratio));
+			m_renderScale += ((idealScale - m_renderScale) * std::min(std::max(m_dynamicResolution.adjustmentRate, 0.0f), 1.0f));
+		}
+		m_renderScale = std::min(std::max(m_renderScale, minScale), maxScale);
+
+		// Command buffers only get re-recorded, once the render extent changes (previous frame has to finish first):
+		const VkExtent2D extent = scaledExtent(m_renderScale);
+		if (extent.width == m_renderExtent.width && extent.height == m_renderExtent.height) return true;
+		vkQueueWaitIdle(m_graphicsDevice->graphicsQueue());
+		vkFreeCommandBuffers(m_graphicsDevice->logicalDevice(), m_graphicsDevice->commandPool(), static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
+		m_commandBuffers.clear();
+		if (!createCommandBuffers()) {
+			m_initialized = false;
+			return false;
+		}
+		return true;
+	}
+
+	void ComputeRenderer::updateTemporalParams() {
+		// Traced fraction of the previous frame (counter gets reset for the upcoming one):
+		{
+			uint32_t* counter = m_traceCounter.map();
+			const uint32_t numPixels = (m_historyExtent.width * m_historyExtent.height);
+			if (numPixels > 0) m_tracedFraction = (static_cast<float>(*counter) / static_cast<float>(numPixels));
+			(*counter) = 0;
+			m_traceCounter.unmap();
+		}
+		TemporalParams params;
+		params.previousViewProjection = (m_previousTransform.projection * m_previousTransform.view);
+		params.previousInverseView = glm::inverse(m_previousTransform.view);
+		params.previousInverseProjection = glm::inverse(m_previousTransform.projection);
+		params.historyWidth = static_cast<int32_t>(m_historyExtent.width);
+		params.historyHeight = static_cast<int32_t>(m_historyExtent.height);
+		params.frameIndex = m_frameIndex;
+		params.refreshPeriod = m_temporalReuse.refreshPeriod;
+		params.debugView = m_temporalReuse.debugView ? 1u : 0u;
+		m_temporalParams.setContent(&params);
+	}
+
+	void ComputeRenderer::clearSwapChainDependedObjects() {
+		vkDeviceWaitIdle(m_graphicsDevice->logicalDevice());
+
+		if (!m_commandBuffers.empty()) {
+			vkFreeCommandBuffers(m_graphicsDevice->logicalDevice(), m_graphicsDevice->commandPool(), static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
+			m_commandBuffers.clear();
+		}
+
+		if (m_descriptorPool != VK_NULL_HANDLE) {
+			vkDestroyDescriptorPool(m_graphicsDevice->logicalDevice(), m_descriptorPool, nullptr);
+			m_descriptorPool = VK_NULL_HANDLE;
+			m_descriptorSets[0] = m_descriptorSets[1] = VK_NULL_HANDLE;
+		}
+
+		m_outputImage.reset();
+
+		m_initialized = false;
+	}
+
+	void ComputeRenderer::recreateSwapChainDependedObjects() {
+		if (m_computePipeline == VK_NULL_HANDLE) return;
+		clearSwapChainDependedObjects();
+		if (createOutputImage() && createHistoryImages())
+			if (createDescriptorPool())
+				if (createCommandBuffers())
+					m_initialized = true;
+	}
+}
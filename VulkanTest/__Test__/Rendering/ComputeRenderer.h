@@ -0,0 +1,188 @@
+#pragma once
+#include "../Objects/Buffers.h"
+#include "FrameRenderer.h"
+#include "RayTracedMesh.h"
+#include <chrono>
+
+namespace Test {
+	/**
+	 * Compute shader alternative to Renderer for the ray tracers:
+	 * Instead of rasterizing a full screen quad and tracing from the fragment shader, it dispatches one thread per pixel in 8x8 tiles,
+	 * writes the result to a storage image and blits that to the swap chain image (no vertex stage and no render pass involved).
+	 * Optionally, resolution can scale dynamically (see DynamicResolution): rays only get traced into the top-left part of the output image and the blit stretches it over the swap chain image.
+	 * Optionally, shading can be reused from the previous frame (see TemporalReuse): color and hit distance of each pixel are kept in a history image,
+	 * pixels whose surface point (reprojected with the previous View-Projection transformation) still lies on the current ray take the color from there and only the rest get traced.
+	 * The ray tracing code itself is shared with the fragment shader variants, so the two are directly comparable.
+	 * Note: Requires swap chain images to be usable as transfer destination and the surface format to support blits.
+	 */
+	class ComputeRenderer : public IFrameRenderer {
+	public:
+		/**
+		 * Dynamic resolution controls:
+		 * Each frame, render scale moves towards the one, that would hit the target frame time (traced pixel count is assumed to be proportional to the frame time).
+		 * Frame time is the GPU time of the previous dispatch, measured with timestamp queries (swap chain waits and presentation do not count);
+		 * CPU time between the frames gets used instead, if the graphics queue does not support timestamps.
+		 */
+		struct DynamicResolution {
+			// Dispatch time to aim for (milliseconds; 0 disables the scaling and keeps the render scale at maxScale).
+			float targetFrameTime;
+
+			// Lowest render scale (fraction of the swap chain extent per axis).
+			float minScale;
+
+			// Highest render scale (output image has the same extent as the swap chain, so anything above 1 gets treated as 1).
+			float maxScale;
+
+			// Fraction of the way towards the estimated ideal scale, covered per frame (0 - 1; lower values react slower, but jitter less).
+			float adjustmentRate;
+		};
+
+		/**
+		 * Temporal reuse controls:
+		 * Disoccluded pixels always get traced; on top of that, every pixel gets retraced on a rotating pattern, so that nothing stays stale for more than refreshPeriod frames.
+		 */
+		struct TemporalReuse {
+			// Every pixel gets traced at least once per this many frames (0 disables the reuse and traces everything every frame).
+			uint32_t refreshPeriod;
+
+			// If true, traced pixels get highlighted (magenta) instead of shaded.
+			bool debugView;
+		};
+
+		/**
+		Instantiates a compute renderer.
+		@param device Graphics device reference.
+		@param swapChain Swap chain reference.
+		@param object Ray tracer to render (provides compute shader, bindings and specialization constants; BVH variants are not supported).
+		@param logFn Logging function for error reporting (optional).
+		*/
+		ComputeRenderer(
+			const std::shared_ptr<GraphicsDevice>& device, const std::shared_ptr<SwapChain>& swapChain,
+			const std::shared_ptr<RayTracedMesh>& object, void(*logFn)(const char*) = nullptr);
+
+		/** Destructor */
+		virtual ~ComputeRenderer();
+
+		virtual bool initialized() override;
+
+		virtual void render() override;
+
+		virtual float renderScale()const override;
+
+		/**
+		Current dynamic resolution controls (by default, render scale is fixed at 1).
+		@return dynamic resolution settings.
+		*/
+		const DynamicResolution& dynamicResolution()const;
+
+		/**
+		Sets dynamic resolution controls (takes effect from the next frame).
+		@param settings Dynamic resolution settings.
+		*/
+		void setDynamicResolution(const DynamicResolution& settings);
+
+		virtual float tracedFraction()const override;
+
+		/**
+		Current temporal reuse controls (by default, reuse is disabled).
+		@return temporal reuse settings.
+		*/
+		const TemporalReuse& temporalReuse()const;
+
+		/**
+		Sets temporal reuse controls (takes effect from the next frame).
+		@param settings Temporal reuse settings.
+		*/
+		void setTemporalReuse(const TemporalReuse& settings);
+
+
+	private:
+		const std::shared_ptr<GraphicsDevice> m_graphicsDevice;
+		const std::shared_ptr<SwapChain> m_swapChain;
+
+		const std::shared_ptr<RayTracedMesh> m_object;
+
+		VkShaderModule m_shaderModule;
+
+		VkDescriptorSetLayout m_descriptorSetLayout;
+		VkDescriptorSetLayout m_outputSetLayout;
+		VkPipelineLayout m_pipelineLayout;
+		VkPipeline m_computePipeline;
+
+		std::unique_ptr<Image> m_outputImage;
+		std::unique_ptr<Image> m_sampleImage;
+		std::unique_ptr<Image> m_historyImage;
+
+		// Same as TemporalParams from RayTracedDiffuse.comp:
+		struct TemporalParams {
+			glm::mat4 previousViewProjection;
+			glm::mat4 previousInverseView;
+			glm::mat4 previousInverseProjection;
+			int32_t historyWidth;
+			int32_t historyHeight;
+			uint32_t frameIndex;
+			uint32_t refreshPeriod;
+			uint32_t debugView;
+		};
+		ConstantBuffer<TemporalParams> m_temporalParams;
+		StagingBuffer<uint32_t, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT> m_traceCounter;
+
+		VkDescriptorPool m_descriptorPool;
+		VkDescriptorSet m_descriptorSets[2];
+
+		std::vector<VkCommandBuffer> m_commandBuffers;
+
+		DynamicResolution m_dynamicResolution;
+		float m_renderScale;
+		VkExtent2D m_renderExtent;
+		VkFilter m_blitFilter;
+		std::chrono::system_clock::time_point m_lastFrameDate;
+
+		// Timestamps before and after the dispatch (VK_NULL_HANDLE, if timestamps are not supported):
+		VkQueryPool m_timestampQueryPool;
+		float m_timestampPeriod;
+		uint64_t m_timestampMask;
+		bool m_timestampsWritten;
+
+		TemporalReuse m_temporalReuse;
+		VPTransform m_previousTransform;
+		VkExtent2D m_historyExtent;
+		uint32_t m_frameIndex;
+		float m_tracedFraction;
+
+		bool m_initialized;
+
+		SwapChain::RecreationListenerId m_swapChainRecreationListenerId;
+
+		void(*m_logFn)(const char*);
+
+
+		void log(const char* message)const;
+
+		bool swapChainSupported()const;
+
+		bool createDescriptorSetLayouts();
+
+		bool createPipeline();
+
+		bool createTimestampQueryPool();
+
+		bool createOutputImage();
+
+		bool createHistoryImages();
+
+		bool createDescriptorPool();
+
+		bool createCommandBuffers();
+
+		VkExtent2D scaledExtent(float scale)const;
+
+		bool updateRenderScale();
+
+		void updateTemporalParams();
+
+		void clearSwapChainDependedObjects();
+
+		void recreateSwapChainDependedObjects();
+	};
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "../Core/SwapChain.h"
+
+namespace Test {
+	/**
+	 * Interface for anything that can render and present frames to the swap chain (graphics pipeline Renderer, ComputeRenderer...),
+	 * so that the render loop can switch between them without caring how the image gets produced.
+	 */
+	class IFrameRenderer {
+	public:
+		/** Default constructor (copy-constructors are disabled) */
+		inline IFrameRenderer() {}
+
+		/** Virtual destructor... Because interfaces... */
+		virtual inline ~IFrameRenderer() {}
+
+		/**
+		Tells, if everything went OK during instantiation.
+		@return false, if something went wrong.
+		*/
+		virtual bool initialized() = 0;
+
+		/**
+		Renders and presents a frame.
+		*/
+		virtual void render() = 0;
+
+		/**
+		Resolution, the last frame got rendered at, relative to the swap chain (benchmark output records it alongside the frame times).
+		@return fraction of the swap chain extent per axis (1, unless the renderer scales its resolution dynamically).
+		*/
+		virtual inline float renderScale()const { return 1.0f; }
+
+		/**
+		Fraction of the rendered pixels, that got traced from scratch during the last frame (benchmark output records it alongside the frame times).
+		@return 0 - 1 (1, unless the renderer reuses shading from the previous frames).
+		*/
+		virtual inline float tracedFraction()const { return 1.0f; }
+
+
+	private:
+		IFrameRenderer(const IFrameRenderer&) = delete;
+		IFrameRenderer& operator=(const IFrameRenderer&) = delete;
+	};
+}
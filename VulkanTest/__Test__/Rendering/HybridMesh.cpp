@@ -0,0 +1,109 @@
+#include "HybridMesh.h"
+
+
+namespace Test {
+	HybridMesh::HybridMesh(const std::shared_ptr<Mesh>& mesh,
+		const std::shared_ptr<VPTransform>& transform, const std::shared_ptr<PointLight>& light,
+		const std::shared_ptr<VoxelGrid>& voxelGrid, const std::shared_ptr<TriangleRecords>& triangleRecords,
+		const std::shared_ptr<LightVisibility>& lightVisibility, uint32_t mailboxSize, VoxelTraversal::Mode traversal, void(*logFn)(const char*))
+		: m_mesh(mesh)
+		, m_vpTransform(transform), m_vpTransformBuffer(m_mesh->device(), m_vpTransform.operator->(), logFn)
+		, m_voxelGrid(voxelGrid), m_triangleRecords(triangleRecords), m_lightVisibility(lightVisibility)
+		, m_shadowTracer(mesh, transform, light, voxelGrid, triangleRecords, lightVisibility, mailboxSize, traversal, logFn) {
+		{
+			m_vpTransformBufferInfo = {};
+			m_vpTransformBufferInfo.buffer = m_vpTransformBuffer.stagingBuffer();
+			m_vpTransformBufferInfo.offset = 0;
+			m_vpTransformBufferInfo.range = sizeof(VPTransform);
+		}
+		if (m_voxelGrid == nullptr && logFn != nullptr) logFn("[Error] HybridMesh - Voxel grid is required for the shadow rays.");
+	}
+
+	HybridMesh::~HybridMesh() { }
+
+	bool HybridMesh::initialized() {
+		return m_voxelGrid != nullptr && m_vpTransformBuffer.stagingBuffer() != VK_NULL_HANDLE && m_shadowTracer.initialized();
+	}
+
+	const char* HybridMesh::vertexShader() {
+		static const char SHADER[] = "__Test__/Shaders/RasterizedDiffuseVert.spv";
+		return SHADER;
+	}
+
+	const char* HybridMesh::fragmentShader() {
+		static const char SHADER[] = "__Test__/Shaders/HybridDiffuseFrag.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID[] = "__Test__/Shaders/HybridDiffuseFragCompact.spv";
+		static const char SHADER_WITH_RECORDS[] = "__Test__/Shaders/HybridDiffuseFragRec.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_AND_RECORDS[] = "__Test__/Shaders/HybridDiffuseFragCompactRec.spv";
+		static const char SHADER_WITH_VISIBILITY[] = "__Test__/Shaders/HybridDiffuseFragVis.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_AND_VISIBILITY[] = "__Test__/Shaders/HybridDiffuseFragCompactVis.spv";
+		static const char SHADER_WITH_RECORDS_AND_VISIBILITY[] = "__Test__/Shaders/HybridDiffuseFragRecVis.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_RECORDS_AND_VISIBILITY[] = "__Test__/Shaders/HybridDiffuseFragCompactRecVis.spv";
+		const bool records = (m_triangleRecords != nullptr);
+		const bool visibility = (m_lightVisibility != nullptr);
+		if (m_voxelGrid != nullptr && m_voxelGrid->layout == VoxelData::LAYOUT_COMPACT) return visibility
+			? (records ? SHADER_WITH_COMPACT_VOXEL_GRID_RECORDS_AND_VISIBILITY : SHADER_WITH_COMPACT_VOXEL_GRID_AND_VISIBILITY)
+			: (records ? SHADER_WITH_COMPACT_VOXEL_GRID_AND_RECORDS : SHADER_WITH_COMPACT_VOXEL_GRID);
+		else return visibility
+			? (records ? SHADER_WITH_RECORDS_AND_VISIBILITY : SHADER_WITH_VISIBILITY)
+			: (records ? SHADER_WITH_RECORDS : SHADER);
+	}
+
+	const VkSpecializationInfo* HybridMesh::fragmentSpecialization() {
+		return m_shadowTracer.fragmentSpecialization();
+	}
+
+	VkPipelineVertexInputStateCreateInfo HybridMesh::vertexInputInfo() {
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputInfo.vertexBindingDescriptionCount = 1;
+		vertexInputInfo.pVertexBindingDescriptions = &PNCVertex::bindingDescription();
+		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(PNCVertex::attributeDescription().size());
+		vertexInputInfo.pVertexAttributeDescriptions = PNCVertex::attributeDescription().data();
+		return vertexInputInfo;
+	}
+
+	uint32_t HybridMesh::numVertices() {
+		return m_mesh->numVertices();
+	}
+
+	VkBuffer HybridMesh::vertexBuffer() {
+		return m_mesh->vertexBuffer();
+	}
+
+	uint32_t HybridMesh::numIndices() {
+		return m_mesh->numIndices();
+	}
+
+	VkBuffer HybridMesh::indexBuffer() {
+		return m_mesh->indexBuffer();
+	}
+
+	uint32_t HybridMesh::numLayoutBindings() {
+		return m_shadowTracer.numLayoutBindings();
+	}
+
+	VkDescriptorSetLayoutBinding HybridMesh::layoutBinding(uint32_t index) {
+		// Binding 0 is a vertex stage uniform buffer for both, so the layout is exactly the same:
+		return m_shadowTracer.layoutBinding(index);
+	}
+
+	VkWriteDescriptorSet HybridMesh::descriptorBinding(uint32_t index) {
+		VkWriteDescriptorSet binding = m_shadowTracer.descriptorBinding(index);
+		if (index == 0) binding.pBufferInfo = &m_vpTransformBufferInfo;
+		return binding;
+	}
+
+	void HybridMesh::updateResources() {
+		m_vpTransformBuffer.setContent(m_vpTransform.operator->());
+		m_shadowTracer.updateResources();
+	}
+
+	const RayTracedMesh::KernelOptions& HybridMesh::kernelOptions()const {
+		return m_shadowTracer.kernelOptions();
+	}
+
+	void HybridMesh::setKernelOptions(const RayTracedMesh::KernelOptions& options) {
+		m_shadowTracer.setKernelOptions(options);
+	}
+}
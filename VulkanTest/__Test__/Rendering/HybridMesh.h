@@ -0,0 +1,86 @@
+#pragma once
+#include "RayTracedMesh.h"
+
+namespace Test {
+	/**
+	 * Object, that rasterizes the scene geometry and ray-traces only the shadows (through a voxel grid).
+	 * For additional documentation of the individual functions, read RenderObject.h
+	 * Visibility comes from the rasterizer's depth test (early fragment tests, so hidden fragments cast no rays),
+	 * after which every visible fragment casts a single occlusion ray towards the light with the same code RayTracedMesh uses for its secondary rays.
+	 * Bindings are the same as the ones of the voxel grid RayTracedMesh (that is used internally to provide them), except the first one holds the View-Projection transform,
+	 * just like with RasterizedMesh.
+	 */
+	class HybridMesh : public IRenderObject {
+	public:
+		/**
+		Creates a hybrid renderer.
+		@param mesh Scene geometry.
+		@param transform Reference to the View-Projection transformation.
+		@param light Information about scene lighing.
+		@param voxelGrid Voxel grid for the shadow rays.
+		@param triangleRecords Precomputed triangle intersection records (optional; have to be built from the same geometry as the mesh).
+		@param lightVisibility Cached shadow ray occluders (optional; have to be built from the same geometry as the mesh).
+		@param mailboxSize Number of recently tested triangles, each shadow ray remembers (0 disables mailboxing).
+		@param traversal Voxel grid cell walk implementation.
+		@param logFn Logging function for error reporting (optional).
+		*/
+		HybridMesh(const std::shared_ptr<Mesh>& mesh,
+			const std::shared_ptr<VPTransform>& transform, const std::shared_ptr<PointLight>& light,
+			const std::shared_ptr<VoxelGrid>& voxelGrid, const std::shared_ptr<TriangleRecords>& triangleRecords = nullptr,
+			const std::shared_ptr<LightVisibility>& lightVisibility = nullptr, uint32_t mailboxSize = RayTracedMesh::DEFAULT_MAILBOX_SIZE, VoxelTraversal::Mode traversal = VoxelTraversal::MODE_CELL_STEPPING,
+			void(*logFn)(const char*) = nullptr);
+
+		/** Destructor */
+		virtual ~HybridMesh();
+
+		virtual bool initialized() override;
+
+		virtual const char* vertexShader() override;
+
+		virtual const char* fragmentShader() override;
+
+		virtual const VkSpecializationInfo* fragmentSpecialization() override;
+
+		virtual VkPipelineVertexInputStateCreateInfo vertexInputInfo() override;
+
+		virtual uint32_t numVertices() override;
+
+		virtual VkBuffer vertexBuffer() override;
+
+		virtual uint32_t numIndices() override;
+
+		virtual VkBuffer indexBuffer() override;
+
+		virtual uint32_t numLayoutBindings() override;
+
+		virtual VkDescriptorSetLayoutBinding layoutBinding(uint32_t index) override;
+
+		virtual VkWriteDescriptorSet descriptorBinding(uint32_t index) override;
+
+		virtual void updateResources() override;
+
+		/**
+		Current traversal kernel options of the shadow rays (see RayTracedMesh::KernelOptions; debugView has no effect, since the shading overwrites it).
+		@return kernel options.
+		*/
+		const RayTracedMesh::KernelOptions& kernelOptions()const;
+
+		/**
+		Sets traversal kernel options of the shadow rays (has to be called before the renderer gets created).
+		@param options Kernel options.
+		*/
+		void setKernelOptions(const RayTracedMesh::KernelOptions& options);
+
+
+	private:
+		const std::shared_ptr<Mesh> m_mesh;
+		const std::shared_ptr<VPTransform> m_vpTransform;
+		ConstantBuffer<VPTransform> m_vpTransformBuffer;
+		const std::shared_ptr<VoxelGrid> m_voxelGrid;
+		const std::shared_ptr<TriangleRecords> m_triangleRecords;
+		const std::shared_ptr<LightVisibility> m_lightVisibility;
+		RayTracedMesh m_shadowTracer;
+
+		VkDescriptorBufferInfo m_vpTransformBufferInfo;
+	};
+}
@@ -39,6 +39,10 @@ namespace Test {
 		return SHADER;
 	}
 
+	const VkSpecializationInfo* RasterizedMesh::fragmentSpecialization() {
+		return nullptr;
+	}
+
 	VkPipelineVertexInputStateCreateInfo RasterizedMesh::vertexInputInfo() {
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -29,6 +29,8 @@ namespace Test {
 
 		virtual const char* fragmentShader() override;
 
+		virtual const VkSpecializationInfo* fragmentSpecialization() override;
+
 		virtual VkPipelineVertexInputStateCreateInfo vertexInputInfo() override;
 
 		virtual uint32_t numVertices() override;
@@ -1,4 +1,5 @@
 #include "RayTracedMesh.h"
+#include <cstddef>
 
 namespace {
 	static const std::vector<glm::vec3> VERTEX_BUFFER = {
@@ -31,14 +32,39 @@ namespace {
 		return desc;
 	}
 	static const VkVertexInputAttributeDescription ATTRIBUTE_DESCRIPTION = VertexAttributeDescription();
+
+	inline static VkSpecializationMapEntry SpecializationMapEntry(uint32_t constantId, size_t offset, size_t size) {
+		VkSpecializationMapEntry entry = {};
+		{
+			entry.constantID = constantId;
+			entry.offset = static_cast<uint32_t>(offset);
+			entry.size = size;
+		}
+		return entry;
+	}
 }
 
 namespace Test {
+	const RayTracedMesh::KernelOptions RayTracedMesh::DEFAULT_KERNEL_OPTIONS = { false, true, 0.000025f, 0.025f };
+
+	RayTracedMesh::RayTracedMesh(const std::shared_ptr<Mesh>& mesh,
+		const std::shared_ptr<VPTransform>& transform, const std::shared_ptr<PointLight>& light,
+		const std::shared_ptr<VoxelGrid>& voxelGrid, const std::shared_ptr<TriangleRecords>& triangleRecords,
+		const std::shared_ptr<LightVisibility>& lightVisibility, uint32_t mailboxSize, VoxelTraversal::Mode traversal, void(*logFn)(const char*)) 
+		: RayTracedMesh(mesh, transform, light, voxelGrid, nullptr, triangleRecords, lightVisibility, mailboxSize, traversal, logFn) { }
+
+	RayTracedMesh::RayTracedMesh(const std::shared_ptr<Mesh>& mesh,
+		const std::shared_ptr<VPTransform>& transform, const std::shared_ptr<PointLight>& light,
+		const std::shared_ptr<BVH>& bvh, const std::shared_ptr<TriangleRecords>& triangleRecords,
+		void(*logFn)(const char*))
+		: RayTracedMesh(mesh, transform, light, nullptr, bvh, triangleRecords, nullptr, 0, VoxelTraversal::MODE_CELL_STEPPING, logFn) { }
+
 	RayTracedMesh::RayTracedMesh(const std::shared_ptr<Mesh>& mesh,
 		const std::shared_ptr<VPTransform>& transform, const std::shared_ptr<PointLight>& light,
-		const std::shared_ptr<VoxelGrid>& voxelGrid,
-		void(*logFn)(const char*)) 
-		: m_mesh(mesh), m_vpTransform(transform), m_light(light), m_voxelGrid(voxelGrid)
+		const std::shared_ptr<VoxelGrid>& voxelGrid, const std::shared_ptr<BVH>& bvh, const std::shared_ptr<TriangleRecords>& triangleRecords,
+		const std::shared_ptr<LightVisibility>& lightVisibility, uint32_t mailboxSize, VoxelTraversal::Mode traversal, void(*logFn)(const char*))
+		: m_mesh(mesh), m_vpTransform(transform), m_light(light), m_voxelGrid(voxelGrid), m_bvh(bvh), m_triangleRecords(triangleRecords)
+		, m_lightVisibility((voxelGrid != nullptr) ? lightVisibility : nullptr)
 		, m_vertexBuffer(m_mesh->device(), static_cast<uint32_t>(VERTEX_BUFFER.size()), VERTEX_BUFFER.data(), logFn)
 		, m_indexBuffer(m_mesh->device(), static_cast<uint32_t>(INDEX_BUFFER.size()), INDEX_BUFFER.data(), logFn)
 		, m_inverseTransformBuffer(m_mesh->device(), nullptr, logFn)
@@ -68,7 +94,7 @@ namespace Test {
 			m_lightBufferInfo.range = sizeof(PointLight);
 		}
 		{
-			m_voxelSettingsInfo = m_voxelGridInfo = m_voxelEntryInfo = {};
+			m_voxelSettingsInfo = m_voxelGridInfo = m_voxelEntryInfo = m_voxelEmptyDistanceInfo = {};
 			if (m_voxelGrid != nullptr) {
 				{
 					m_voxelSettingsInfo.buffer = m_voxelGrid->settings.stagingBuffer();
@@ -76,17 +102,95 @@ namespace Test {
 					m_voxelSettingsInfo.range = VK_WHOLE_SIZE;
 				}
 				{
-					m_voxelGridInfo.buffer = m_voxelGrid->voxels.buffer();
+					m_voxelGridInfo.buffer = (m_voxelGrid->layout == VoxelData::LAYOUT_COMPACT)
+						? m_voxelGrid->voxelRanges.buffer() : m_voxelGrid->voxels.buffer();
 					m_voxelGridInfo.offset = 0;
 					m_voxelGridInfo.range = VK_WHOLE_SIZE;
 				}
 				{
-					m_voxelEntryInfo.buffer = m_voxelGrid->entries.buffer();
+					m_voxelEntryInfo.buffer = (m_voxelGrid->layout == VoxelData::LAYOUT_COMPACT)
+						? m_voxelGrid->triangleRefs.buffer() : m_voxelGrid->entries.buffer();
 					m_voxelEntryInfo.offset = 0;
 					m_voxelEntryInfo.range = VK_WHOLE_SIZE;
 				}
+				{
+					m_voxelEmptyDistanceInfo.buffer = m_voxelGrid->emptyDistances.buffer();
+					m_voxelEmptyDistanceInfo.offset = 0;
+					m_voxelEmptyDistanceInfo.range = VK_WHOLE_SIZE;
+				}
+			}
+		}
+		{
+			m_bvhNodeInfo = m_bvhTriangleRefInfo = {};
+			if (m_bvh != nullptr) {
+				{
+					m_bvhNodeInfo.buffer = m_bvh->nodes.buffer();
+					m_bvhNodeInfo.offset = 0;
+					m_bvhNodeInfo.range = VK_WHOLE_SIZE;
+				}
+				{
+					m_bvhTriangleRefInfo.buffer = m_bvh->triangleRefs.buffer();
+					m_bvhTriangleRefInfo.offset = 0;
+					m_bvhTriangleRefInfo.range = VK_WHOLE_SIZE;
+				}
 			}
 		}
+		{
+			m_positionBufferInfo = {};
+			m_positionBufferInfo.buffer = m_mesh->positionBuffer();
+			m_positionBufferInfo.offset = 0;
+			m_positionBufferInfo.range = VK_WHOLE_SIZE;
+		}
+		{
+			m_triangleRecordInfo = {};
+			if (m_triangleRecords != nullptr) {
+				m_triangleRecordInfo.buffer = m_triangleRecords->records.buffer();
+				m_triangleRecordInfo.offset = 0;
+				m_triangleRecordInfo.range = VK_WHOLE_SIZE;
+			}
+		}
+		{
+			m_lightVisibilitySettingsInfo = m_lightOccluderRangeInfo = m_lightOccluderInfo = {};
+			if (m_lightVisibility != nullptr) {
+				{
+					m_lightVisibilitySettingsInfo.buffer = m_lightVisibility->settings.stagingBuffer();
+					m_lightVisibilitySettingsInfo.offset = 0;
+					m_lightVisibilitySettingsInfo.range = VK_WHOLE_SIZE;
+				}
+				{
+					m_lightOccluderRangeInfo.buffer = m_lightVisibility->cells.buffer();
+					m_lightOccluderRangeInfo.offset = 0;
+					m_lightOccluderRangeInfo.range = VK_WHOLE_SIZE;
+				}
+				{
+					m_lightOccluderInfo.buffer = m_lightVisibility->occluders.buffer();
+					m_lightOccluderInfo.offset = 0;
+					m_lightOccluderInfo.range = VK_WHOLE_SIZE;
+				}
+			}
+		}
+		{
+			m_kernelConstants = {};
+			m_kernelConstants.mailboxSize = mailboxSize;
+			m_kernelConstants.integerDDA = (traversal == VoxelTraversal::MODE_INTEGER_DDA) ? VK_TRUE : VK_FALSE;
+			setKernelOptions(DEFAULT_KERNEL_OPTIONS);
+		}
+		{
+			m_kernelConstantEntries[0] = SpecializationMapEntry(0, offsetof(KernelConstants, mailboxSize), sizeof(uint32_t));
+			m_kernelConstantEntries[1] = SpecializationMapEntry(1, offsetof(KernelConstants, integerDDA), sizeof(VkBool32));
+			m_kernelConstantEntries[2] = SpecializationMapEntry(2, offsetof(KernelConstants, debugView), sizeof(VkBool32));
+			for (uint32_t axis = 0; axis < 3; axis++)
+				m_kernelConstantEntries[3 + axis] = SpecializationMapEntry(3 + axis, offsetof(KernelConstants, gridDivisions) + (sizeof(uint32_t) * axis), sizeof(uint32_t));
+			m_kernelConstantEntries[6] = SpecializationMapEntry(6, offsetof(KernelConstants, cellPadding), sizeof(float));
+			m_kernelConstantEntries[7] = SpecializationMapEntry(7, offsetof(KernelConstants, shadowBias), sizeof(float));
+		}
+		{
+			m_kernelSpecialization = {};
+			m_kernelSpecialization.mapEntryCount = 8;
+			m_kernelSpecialization.pMapEntries = m_kernelConstantEntries;
+			m_kernelSpecialization.dataSize = sizeof(KernelConstants);
+			m_kernelSpecialization.pData = &m_kernelConstants;
+		}
 	}
 
 	RayTracedMesh::~RayTracedMesh() { }
@@ -104,8 +208,72 @@ namespace Test {
 
 	const char* RayTracedMesh::fragmentShader() {
 		static const char SHADER[] = "__Test__/Shaders/RayTracedDiffuseFrag.spv";
-		static const char SAHDER_WITH_VOXEL_GRID[] = "__Test__/Shaders/RayTracedDiffuseFragVox.spv";
-		return m_voxelGrid == nullptr ? SHADER : SAHDER_WITH_VOXEL_GRID;
+		static const char SHADER_WITH_VOXEL_GRID[] = "__Test__/Shaders/RayTracedDiffuseFragVox.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID[] = "__Test__/Shaders/RayTracedDiffuseFragVoxCompact.spv";
+		static const char SHADER_WITH_BVH[] = "__Test__/Shaders/RayTracedDiffuseFragBVH.spv";
+		static const char SHADER_WITH_RECORDS[] = "__Test__/Shaders/RayTracedDiffuseFragRec.spv";
+		static const char SHADER_WITH_VOXEL_GRID_AND_RECORDS[] = "__Test__/Shaders/RayTracedDiffuseFragVoxRec.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_AND_RECORDS[] = "__Test__/Shaders/RayTracedDiffuseFragVoxCompactRec.spv";
+		static const char SHADER_WITH_BVH_AND_RECORDS[] = "__Test__/Shaders/RayTracedDiffuseFragBVHRec.spv";
+		static const char SHADER_WITH_VOXEL_GRID_AND_VISIBILITY[] = "__Test__/Shaders/RayTracedDiffuseFragVoxVis.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_AND_VISIBILITY[] = "__Test__/Shaders/RayTracedDiffuseFragVoxCompactVis.spv";
+		static const char SHADER_WITH_VOXEL_GRID_RECORDS_AND_VISIBILITY[] = "__Test__/Shaders/RayTracedDiffuseFragVoxRecVis.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_RECORDS_AND_VISIBILITY[] = "__Test__/Shaders/RayTracedDiffuseFragVoxCompactRecVis.spv";
+		const bool records = (m_triangleRecords != nullptr);
+		const bool visibility = (m_lightVisibility != nullptr);
+		if (m_bvh != nullptr) return records ? SHADER_WITH_BVH_AND_RECORDS : SHADER_WITH_BVH;
+		else if (m_voxelGrid == nullptr) return records ? SHADER_WITH_RECORDS : SHADER;
+		else if (m_voxelGrid->layout == VoxelData::LAYOUT_COMPACT) return visibility
+			? (records ? SHADER_WITH_COMPACT_VOXEL_GRID_RECORDS_AND_VISIBILITY : SHADER_WITH_COMPACT_VOXEL_GRID_AND_VISIBILITY)
+			: (records ? SHADER_WITH_COMPACT_VOXEL_GRID_AND_RECORDS : SHADER_WITH_COMPACT_VOXEL_GRID);
+		else return visibility
+			? (records ? SHADER_WITH_VOXEL_GRID_RECORDS_AND_VISIBILITY : SHADER_WITH_VOXEL_GRID_AND_VISIBILITY)
+			: (records ? SHADER_WITH_VOXEL_GRID_AND_RECORDS : SHADER_WITH_VOXEL_GRID);
+	}
+
+	const char* RayTracedMesh::computeShader()const {
+		static const char SHADER[] = "__Test__/Shaders/RayTracedDiffuseComp.spv";
+		static const char SHADER_WITH_VOXEL_GRID[] = "__Test__/Shaders/RayTracedDiffuseCompVox.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID[] = "__Test__/Shaders/RayTracedDiffuseCompVoxCompact.spv";
+		static const char SHADER_WITH_RECORDS[] = "__Test__/Shaders/RayTracedDiffuseCompRec.spv";
+		static const char SHADER_WITH_VOXEL_GRID_AND_RECORDS[] = "__Test__/Shaders/RayTracedDiffuseCompVoxRec.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_AND_RECORDS[] = "__Test__/Shaders/RayTracedDiffuseCompVoxCompactRec.spv";
+		static const char SHADER_WITH_VOXEL_GRID_AND_VISIBILITY[] = "__Test__/Shaders/RayTracedDiffuseCompVoxVis.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_AND_VISIBILITY[] = "__Test__/Shaders/RayTracedDiffuseCompVoxCompactVis.spv";
+		static const char SHADER_WITH_VOXEL_GRID_RECORDS_AND_VISIBILITY[] = "__Test__/Shaders/RayTracedDiffuseCompVoxRecVis.spv";
+		static const char SHADER_WITH_COMPACT_VOXEL_GRID_RECORDS_AND_VISIBILITY[] = "__Test__/Shaders/RayTracedDiffuseCompVoxCompactRecVis.spv";
+		const bool records = (m_triangleRecords != nullptr);
+		const bool visibility = (m_lightVisibility != nullptr);
+		if (m_bvh != nullptr) return nullptr;
+		else if (m_voxelGrid == nullptr) return records ? SHADER_WITH_RECORDS : SHADER;
+		else if (m_voxelGrid->layout == VoxelData::LAYOUT_COMPACT) return visibility
+			? (records ? SHADER_WITH_COMPACT_VOXEL_GRID_RECORDS_AND_VISIBILITY : SHADER_WITH_COMPACT_VOXEL_GRID_AND_VISIBILITY)
+			: (records ? SHADER_WITH_COMPACT_VOXEL_GRID_AND_RECORDS : SHADER_WITH_COMPACT_VOXEL_GRID);
+		else return visibility
+			? (records ? SHADER_WITH_VOXEL_GRID_RECORDS_AND_VISIBILITY : SHADER_WITH_VOXEL_GRID_AND_VISIBILITY)
+			: (records ? SHADER_WITH_VOXEL_GRID_AND_RECORDS : SHADER_WITH_VOXEL_GRID);
+	}
+
+	const std::shared_ptr<VPTransform>& RayTracedMesh::transform()const {
+		return m_vpTransform;
+	}
+
+	const RayTracedMesh::KernelOptions& RayTracedMesh::kernelOptions()const {
+		return m_kernelOptions;
+	}
+
+	void RayTracedMesh::setKernelOptions(const KernelOptions& options) {
+		m_kernelOptions = options;
+		m_kernelConstants.debugView = m_kernelOptions.debugView ? VK_TRUE : VK_FALSE;
+		const bool fixedDivisions = (m_kernelOptions.fixedGridDivisions && m_voxelGrid != nullptr);
+		for (uint32_t axis = 0; axis < 3; axis++)
+			m_kernelConstants.gridDivisions[axis] = fixedDivisions ? m_voxelGrid->report.numDivisions[axis] : 0;
+		m_kernelConstants.cellPadding = m_kernelOptions.cellPadding;
+		m_kernelConstants.shadowBias = m_kernelOptions.shadowBias;
+	}
+
+	const VkSpecializationInfo* RayTracedMesh::fragmentSpecialization() {
+		return (&m_kernelSpecialization);
 	}
 
 	VkPipelineVertexInputStateCreateInfo RayTracedMesh::vertexInputInfo() {
@@ -135,7 +303,7 @@ namespace Test {
 	}
 
 	uint32_t RayTracedMesh::numLayoutBindings() {
-		return m_voxelGrid == nullptr ? 4 : 7;
+		return lightVisibilityBinding() + ((m_lightVisibility != nullptr) ? 3 : 0);
 	}
 
 	VkDescriptorSetLayoutBinding RayTracedMesh::layoutBinding(uint32_t index) {
@@ -147,7 +315,15 @@ namespace Test {
 			binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 			binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		}
-		else if (index == 1 || index == 2 || index == 5 || index == 6) {
+		else if (index == positionBinding() || (m_triangleRecords != nullptr && index == triangleRecordBinding())) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		}
+		else if (m_lightVisibility != nullptr && index >= lightVisibilityBinding()) {
+			binding.descriptorType = (index == lightVisibilityBinding()) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		}
+		else if (index == 1 || index == 2 || index == 5 || index == 6 || index == 7 || (index == 4 && m_bvh != nullptr)) {
 			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 			binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 		}
@@ -169,6 +345,26 @@ namespace Test {
 			binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 			binding.pBufferInfo = &m_vpTransformBufferInfo;
 		}
+		else if (index == positionBinding()) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.pBufferInfo = &m_positionBufferInfo;
+		}
+		else if (m_triangleRecords != nullptr && index == triangleRecordBinding()) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.pBufferInfo = &m_triangleRecordInfo;
+		}
+		else if (m_lightVisibility != nullptr && index == lightVisibilityBinding()) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			binding.pBufferInfo = &m_lightVisibilitySettingsInfo;
+		}
+		else if (m_lightVisibility != nullptr && index == (lightVisibilityBinding() + 1)) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.pBufferInfo = &m_lightOccluderRangeInfo;
+		}
+		else if (m_lightVisibility != nullptr && index == (lightVisibilityBinding() + 2)) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.pBufferInfo = &m_lightOccluderInfo;
+		}
 		else if (index == 1) {
 			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 			binding.pBufferInfo = &m_vertexBufferInfo;
@@ -181,6 +377,14 @@ namespace Test {
 			binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 			binding.pBufferInfo = &m_lightBufferInfo;
 		}
+		else if (index == 4 && m_bvh != nullptr) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.pBufferInfo = &m_bvhNodeInfo;
+		}
+		else if (index == 5 && m_bvh != nullptr) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.pBufferInfo = &m_bvhTriangleRefInfo;
+		}
 		else if (index == 4) {
 			binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
 			binding.pBufferInfo = &m_voxelSettingsInfo;
@@ -193,6 +397,10 @@ namespace Test {
 			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 			binding.pBufferInfo = &m_voxelEntryInfo;
 		}
+		else if (index == 7) {
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.pBufferInfo = &m_voxelEmptyDistanceInfo;
+		}
 		return binding;
 	}
 
@@ -203,4 +411,19 @@ namespace Test {
 		m_inverseTransformBuffer.setContent(&inverseTransform);
 		m_lightBuffer.setContent(m_light.operator->());
 	}
+
+
+
+	uint32_t RayTracedMesh::positionBinding()const {
+		if (m_bvh != nullptr) return 6;
+		else return m_voxelGrid == nullptr ? 4 : 8;
+	}
+
+	uint32_t RayTracedMesh::triangleRecordBinding()const {
+		return positionBinding() + 1;
+	}
+
+	uint32_t RayTracedMesh::lightVisibilityBinding()const {
+		return triangleRecordBinding() + ((m_triangleRecords != nullptr) ? 1 : 0);
+	}
 }
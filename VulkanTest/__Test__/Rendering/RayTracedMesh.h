@@ -2,6 +2,10 @@
 #include "RenderObject.h"
 #include "../Objects/Mesh.h"
 #include "../Objects/VoxelGrid.h"
+#include "../Objects/BVH.h"
+#include "../Objects/TriangleRecords.h"
+#include "../Objects/VoxelTraversal.h"
+#include "../Objects/LightVisibility.h"
 
 namespace Test {
 	/**
@@ -15,20 +19,68 @@ namespace Test {
 	 *	3. Ray is cast into the void, hitting some triangle, that's then shaded (of course, we are casting an additional ray to understand, if the surface can even be reached);
 	 *	4. We write some other color wherever we missed the geometry altogather (actually, We're filling with some color tinted gradient, that I initially used to make sure the fragments were casting rays in the right direction and than I decided it looked cool);
 	 *	5. After all this hard work, we have a ray-traced image and a terrible performance, when we are not using any accelerating data structures and/or hardware solutons (VoxelGrid helps, really).
+	 * Acceleration structure is picked per object, by choosing the constructor (no acceleration, VoxelGrid or BVH), so that frame times can be compared on the same scene.
+	 * Traversal reads vertex positions from Mesh::positionBuffer() (bound right after the acceleration structure buffers) and loads full vertices only for the closest hit.
+	 * Any of those can optionally use TriangleRecords for the intersection tests (bound right after the position buffer).
+	 * Voxel grid variants can also look up the shadow ray occluders from LightVisibility (bound last), before falling back to the grid walk.
 	 */
 	class RayTracedMesh : public IRenderObject {
 	public:
+		// Default number of recently tested triangles, each ray remembers during voxel grid traversal.
+		static const uint32_t DEFAULT_MAILBOX_SIZE = 8;
+
+		/**
+		 * Traversal kernel options, that do not change the bindings:
+		 * They reach the shaders as specialization constants (see fragmentSpecialization()), so each combination gets its own pipeline from the same SPIR-V
+		 * and the driver can fold them into the hot loop (options a shader variant has no use for are ignored by it).
+		 */
+		struct KernelOptions {
+			// If true, the acceleration structure is displayed as well (voxel grid: visited cells, triangle tests and mailbox hits; BVH: visited nodes).
+			bool debugView;
+
+			// If true, the voxel grid resolution is baked into the pipeline (has to stay the same for the lifetime of the pipeline; otherwise it is read from the grid settings).
+			bool fixedGridDivisions;
+
+			// Amount, voxel cell bounds get expanded by during cell stepping, so that the hits on the shared faces are not lost.
+			float cellPadding;
+
+			// Squared distance, subtracted from the one between the light and the shaded point, so that the surface does not shadow itself.
+			float shadowBias;
+		};
+
+		// Options, the kernels used to be compiled with.
+		static const KernelOptions DEFAULT_KERNEL_OPTIONS;
+
 		/**
 		Creates a ray-tracer.
 		@param mesh Scene geometry.
 		@param transform Reference to the View-Projection transformation.
 		@param light Information about scene lighing.
 		@param voxelGrid Voxel grid for acceleration.
+		@param triangleRecords Precomputed triangle intersection records (optional; have to be built from the same geometry as the mesh).
+		@param lightVisibility Cached shadow ray occluders (optional; have to be built from the same geometry as the mesh; ignored without the voxel grid).
+		@param mailboxSize Number of recently tested triangles, each ray remembers, so that the ones spanning several cells are not retested (0 disables mailboxing; voxel grids only).
+		@param traversal Voxel grid cell walk implementation (see VoxelTraversal for the CPU reference of both).
+		@param logFn Logging function for error reporting (optional).
+		*/
+		RayTracedMesh(const std::shared_ptr<Mesh>& mesh,
+			const std::shared_ptr<VPTransform>& transform, const std::shared_ptr<PointLight>& light,
+			const std::shared_ptr<VoxelGrid>& voxelGrid = nullptr, const std::shared_ptr<TriangleRecords>& triangleRecords = nullptr,
+			const std::shared_ptr<LightVisibility>& lightVisibility = nullptr, uint32_t mailboxSize = DEFAULT_MAILBOX_SIZE, VoxelTraversal::Mode traversal = VoxelTraversal::MODE_CELL_STEPPING,
+			void(*logFn)(const char*) = nullptr);
+
+		/**
+		Creates a ray-tracer, that uses BVH for acceleration.
+		@param mesh Scene geometry.
+		@param transform Reference to the View-Projection transformation.
+		@param light Information about scene lighing.
+		@param bvh Bounding volume hierarchy, built for the mesh.
+		@param triangleRecords Precomputed triangle intersection records (optional; have to be built from the same geometry as the mesh).
 		@param logFn Logging function for error reporting (optional).
 		*/
 		RayTracedMesh(const std::shared_ptr<Mesh>& mesh,
 			const std::shared_ptr<VPTransform>& transform, const std::shared_ptr<PointLight>& light,
-			const std::shared_ptr<VoxelGrid>& voxelGrid = nullptr,
+			const std::shared_ptr<BVH>& bvh, const std::shared_ptr<TriangleRecords>& triangleRecords = nullptr,
 			void(*logFn)(const char*) = nullptr);
 
 		/** Destructor */
@@ -40,6 +92,8 @@ namespace Test {
 
 		virtual const char* fragmentShader() override;
 
+		virtual const VkSpecializationInfo* fragmentSpecialization() override;
+
 		virtual VkPipelineVertexInputStateCreateInfo vertexInputInfo() override;
 
 		virtual uint32_t numVertices() override;
@@ -58,12 +112,45 @@ namespace Test {
 
 		virtual void updateResources() override;
 
+		/**
+		Compute shader variant of fragmentShader() for ComputeRenderer (same bindings, same specialization constants; the output image goes to descriptor set 1).
+		@return relative path to the compiled compute shader SPV file or nullptr, if there is none for the acceleration structure (BVH).
+		*/
+		const char* computeShader()const;
+
+		/**
+		View-Projection transformation, the rays get generated from (ComputeRenderer keeps the previous frame's copy for temporal reuse).
+		@return transform reference.
+		*/
+		const std::shared_ptr<VPTransform>& transform()const;
+
+		/**
+		Current traversal kernel options (DEFAULT_KERNEL_OPTIONS by default).
+		@return kernel options.
+		*/
+		const KernelOptions& kernelOptions()const;
+
+		/**
+		Sets traversal kernel options.
+		Note: Renderers read the specialization constants once, while creating the pipeline, so this has to be called before the renderer gets created.
+		@param options Kernel options.
+		*/
+		void setKernelOptions(const KernelOptions& options);
+
 
 	private:
+		RayTracedMesh(const std::shared_ptr<Mesh>& mesh,
+			const std::shared_ptr<VPTransform>& transform, const std::shared_ptr<PointLight>& light,
+			const std::shared_ptr<VoxelGrid>& voxelGrid, const std::shared_ptr<BVH>& bvh, const std::shared_ptr<TriangleRecords>& triangleRecords,
+			const std::shared_ptr<LightVisibility>& lightVisibility, uint32_t mailboxSize, VoxelTraversal::Mode traversal, void(*logFn)(const char*));
+
 		const std::shared_ptr<Mesh> m_mesh;
 		const std::shared_ptr<VPTransform> m_vpTransform;
 		const std::shared_ptr<PointLight> m_light;
-		const std::shared_ptr<VoxelGrid>& m_voxelGrid;
+		const std::shared_ptr<VoxelGrid> m_voxelGrid;
+		const std::shared_ptr<BVH> m_bvh;
+		const std::shared_ptr<TriangleRecords> m_triangleRecords;
+		const std::shared_ptr<LightVisibility> m_lightVisibility;
 
 		VertexBuffer<glm::vec3> m_vertexBuffer;
 		IndexBuffer m_indexBuffer;
@@ -78,6 +165,36 @@ namespace Test {
 		VkDescriptorBufferInfo m_voxelSettingsInfo;
 		VkDescriptorBufferInfo m_voxelGridInfo;
 		VkDescriptorBufferInfo m_voxelEntryInfo;
+		VkDescriptorBufferInfo m_voxelEmptyDistanceInfo;
+
+		VkDescriptorBufferInfo m_bvhNodeInfo;
+		VkDescriptorBufferInfo m_bvhTriangleRefInfo;
+
+		VkDescriptorBufferInfo m_positionBufferInfo;
+		VkDescriptorBufferInfo m_triangleRecordInfo;
+
+		VkDescriptorBufferInfo m_lightVisibilitySettingsInfo;
+		VkDescriptorBufferInfo m_lightOccluderRangeInfo;
+		VkDescriptorBufferInfo m_lightOccluderInfo;
+
+		KernelOptions m_kernelOptions;
+
+		// Same order as the constant ids from the shaders:
+		struct KernelConstants {
+			uint32_t mailboxSize;
+			VkBool32 integerDDA;
+			VkBool32 debugView;
+			uint32_t gridDivisions[3];
+			float cellPadding;
+			float shadowBias;
+		};
+		KernelConstants m_kernelConstants;
+		VkSpecializationMapEntry m_kernelConstantEntries[8];
+		VkSpecializationInfo m_kernelSpecialization;
+
+		uint32_t positionBinding()const;
+		uint32_t triangleRecordBinding()const;
+		uint32_t lightVisibilityBinding()const;
 	};
 }
 
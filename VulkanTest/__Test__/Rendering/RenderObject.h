@@ -36,6 +36,12 @@ namespace Test {
 		*/
 		virtual const char* fragmentShader() = 0;
 
+		/**
+		Specialization constants for the fragment shader, applied on pipeline creation (same as with vertexInputInfo, the memory has to stay alive).
+		@return specialization info or nullptr, if the shader has no specialization constants.
+		*/
+		virtual const VkSpecializationInfo* fragmentSpecialization() = 0;
+
 		/**
 		Should provide vertex input description (keep in mind, that nobody will clear binding and attribute description memories and better keep em static).
 		@return pre-filled vertex input descriptor.
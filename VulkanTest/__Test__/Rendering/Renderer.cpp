@@ -138,6 +138,7 @@ namespace Test {
 			fragShaderInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 			fragShaderInfo.module = m_fragmentShaderModule;
 			fragShaderInfo.pName = "main";
+			fragShaderInfo.pSpecializationInfo = m_object->fragmentSpecialization();
 		}
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo = m_object->vertexInputInfo();
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
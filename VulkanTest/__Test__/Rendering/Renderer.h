@@ -1,13 +1,14 @@
 #pragma once
 #include "../Objects/Buffers.h"
 #include "RenderObject.h"
+#include "FrameRenderer.h"
 
 namespace Test {
 	/**
 	 * Wrapper of the entire render pipeline, responsible for rendering to and displaying images,
 	 * hoever, still a slave to a RenderObject that ultimately dictates as of how the pipeline should behave once run.
 	 */
-	class Renderer {
+	class Renderer : public IFrameRenderer {
 	public:
 		/**
 		Instantiates a renderer.
@@ -21,18 +22,18 @@ namespace Test {
 			const std::shared_ptr<IRenderObject>& object, void(*logFn)(const char*) = nullptr);
 
 		/** Destructor (obviously) */
-		~Renderer();
+		virtual ~Renderer();
 
 		/**
 		Tells, if everything went OK during instantiation.
 		@return false, if something went wrong.
 		*/
-		bool initialized();
+		virtual bool initialized() override;
 
 		/** 
 		Renders a frame.
 		*/
-		void render();
+		virtual void render() override;
 
 
 	private:
@@ -0,0 +1,165 @@
+#include "SoftwareRenderer.h"
+#include "../CpuHelpers.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <thread>
+
+
+namespace {
+	/**
+	Everything, the pixels of a single frame need.
+	*/
+	struct Frame {
+		const Test::VoxelTraversal& traversal;
+		const std::vector<Test::PNCVertex>& verts;
+		const std::vector<uint32_t>& indices;
+		Test::VoxelTraversal::Mode mode;
+		const Test::PointLight& light;
+		glm::mat4 inverseView;
+		glm::mat4 inverseProjection;
+		uint32_t width;
+		uint32_t height;
+		float shadowBias;
+	};
+
+	/**
+	Ray counts of a single worker.
+	*/
+	struct WorkerStats {
+		size_t numRays;
+		size_t numHits;
+	};
+
+	// Mirror of background() from RayTracedDiffuseVox.glsl (negative closeness is clamped, since pow() is undefined for it in GLSL):
+	inline static glm::vec3 background(const glm::vec3& origin, const glm::vec3& direction) {
+		const float centerCloseness = std::pow(std::max(glm::dot(direction, glm::normalize(-origin)), 0.0f), 16.0f);
+		return glm::vec3(1.0f, centerCloseness, centerCloseness);
+	}
+
+	// Mirror of shade() from RayTracedDiffuseVox.glsl (without the cached shadow ray occluders):
+	inline static glm::vec3 shade(const Frame& frame, const glm::vec3& worldPos, const glm::vec3& fragNormal, const glm::vec3& pixelColor, WorkerStats& stats) {
+		const glm::vec3 deltaPos = (frame.light.position - worldPos);
+		const float sqrDistance = glm::dot(deltaPos, deltaPos);
+		const glm::vec3 color = (frame.light.color / sqrDistance);
+		const glm::vec3 dirToLight = (deltaPos / std::sqrt(sqrDistance));
+		float diffuse = glm::dot(dirToLight, fragNormal);
+		if (diffuse <= 0.0f) diffuse = 0.0f;
+
+		// Shadows:
+		stats.numRays++;
+		if (frame.traversal.occluded(frame.light.position, -dirToLight, frame.mode, 0.0f, std::sqrt(std::max(sqrDistance - frame.shadowBias, 0.0f))))
+			diffuse = 0.0f;
+
+		const glm::vec3 conserved = (frame.light.ambientStrength + diffuse);
+		return (pixelColor * color * conserved);
+	}
+
+	// Mirror of pixelRay() from RayTracedDiffuse.comp and tracePixel() from RayTracedDiffuseVox.glsl:
+	inline static glm::vec3 tracePixel(const Frame& frame, uint32_t x, uint32_t y, WorkerStats& stats) {
+		const glm::vec3 screenPosition(
+			(((x + 0.5f) / frame.width) * 2.0f) - 1.0f,
+			(((y + 0.5f) / frame.height) * 2.0f) - 1.0f, 0.5f);
+		const glm::vec4 origin = frame.inverseView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		const glm::vec3 rayOrigin = (glm::vec3(origin) / origin.w);
+		const glm::vec4 target = frame.inverseView * frame.inverseProjection * glm::vec4(screenPosition, 1.0f);
+		const glm::vec3 rayDirection = glm::normalize((glm::vec3(target) / target.w) - rayOrigin);
+
+		stats.numRays++;
+		Test::VoxelTraversal::Hit hit;
+		if (!frame.traversal.raycast(rayOrigin, rayDirection, frame.mode, hit)) return background(rayOrigin, rayDirection);
+		stats.numHits++;
+		const Test::PNCVertex& a = frame.verts[frame.indices[hit.triangle]];
+		const Test::PNCVertex& b = frame.verts[frame.indices[hit.triangle + 1]];
+		const Test::PNCVertex& c = frame.verts[frame.indices[hit.triangle + 2]];
+		const glm::vec3 fragNormal = ((a.normal * hit.barycentrics.x) + (b.normal * hit.barycentrics.y) + (c.normal * hit.barycentrics.z));
+		const glm::vec3 pixelColor = ((a.color * hit.barycentrics.x) + (b.color * hit.barycentrics.y) + (c.color * hit.barycentrics.z));
+		return shade(frame, hit.point, fragNormal, pixelColor, stats);
+	}
+
+	// Same as writing a linear color to a UNORM SRGB attachment (clamped to [0, 1] first):
+	inline static uint8_t encodeSRGB(float value) {
+		value = std::min(std::max(value, 0.0f), 1.0f);
+		const float encoded = (value <= 0.0031308f) ? (value * 12.92f) : ((1.055f * std::pow(value, 1.0f / 2.4f)) - 0.055f);
+		return static_cast<uint8_t>((encoded * 255.0f) + 0.5f);
+	}
+}
+
+namespace Test {
+	SoftwareRenderer::SoftwareRenderer(const VoxelData& data, const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		uint32_t width, uint32_t height, float shadowBias, uint32_t numThreads, uint32_t tileSize, VoxelTraversal::Mode traversal)
+		: m_traversal(data, verts, indexBuffer), m_verts(verts), m_indices(indexBuffer), m_mode(traversal)
+		, m_width(width), m_height(height), m_shadowBias(shadowBias), m_numThreads(std::max(numThreads, 1u)), m_tileSize(std::max(tileSize, 1u))
+		, m_pixels(static_cast<size_t>(width) * height * 4, 0), m_report({}) { }
+
+	const SoftwareRenderer::RenderReport& SoftwareRenderer::render(const VPTransform& transform, const PointLight& light) {
+		const std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+		const Frame frame = { m_traversal, m_verts, m_indices, m_mode, light, glm::inverse(transform.view), glm::inverse(transform.projection), m_width, m_height, m_shadowBias };
+		const uint32_t tilesX = ((m_width + m_tileSize - 1) / m_tileSize);
+		const uint32_t tilesY = ((m_height + m_tileSize - 1) / m_tileSize);
+		const uint32_t numTiles = (tilesX * tilesY);
+		const uint32_t numWorkers = std::max(std::min(m_numThreads, numTiles), 1u);
+
+		// Tiles are handed out one by one, so that the workers with the cheap tiles (background) do not end up waiting on the others:
+		std::atomic<uint32_t> nextTile(0);
+		std::vector<WorkerStats> stats(numWorkers, WorkerStats({ 0, 0 }));
+		runOnThreads(numWorkers, [&](size_t workerId) {
+			WorkerStats& workerStats = stats[workerId];
+			while (true) {
+				const uint32_t tile = nextTile.fetch_add(1);
+				if (tile >= numTiles) break;
+				const uint32_t startX = ((tile % tilesX) * m_tileSize);
+				const uint32_t startY = ((tile / tilesX) * m_tileSize);
+				const uint32_t endX = std::min(startX + m_tileSize, m_width);
+				const uint32_t endY = std::min(startY + m_tileSize, m_height);
+				for (uint32_t y = startY; y < endY; y++)
+					for (uint32_t x = startX; x < endX; x++) {
+						const glm::vec3 color = tracePixel(frame, x, y, workerStats);
+						uint8_t* pixel = (m_pixels.data() + ((static_cast<size_t>(y) * m_width) + x) * 4);
+						pixel[0] = encodeSRGB(color.r);
+						pixel[1] = encodeSRGB(color.g);
+						pixel[2] = encodeSRGB(color.b);
+						pixel[3] = 255;
+					}
+			}
+		});
+
+		m_report = {};
+		m_report.numTiles = numTiles;
+		m_report.numThreads = numWorkers;
+		for (size_t i = 0; i < stats.size(); i++) {
+			m_report.numRays += stats[i].numRays;
+			m_report.numHits += stats[i].numHits;
+		}
+		m_report.renderTime = std::chrono::duration<float>(std::chrono::system_clock::now() - start).count();
+		m_report.megaRaysPerSecond = (m_report.renderTime > 0.0f) ? (static_cast<float>(m_report.numRays) / m_report.renderTime / 1000000.0f) : 0.0f;
+		return m_report;
+	}
+
+	uint32_t SoftwareRenderer::width()const {
+		return m_width;
+	}
+
+	uint32_t SoftwareRenderer::height()const {
+		return m_height;
+	}
+
+	const std::vector<uint8_t>& SoftwareRenderer::pixels()const {
+		return m_pixels;
+	}
+
+	const SoftwareRenderer::RenderReport& SoftwareRenderer::report()const {
+		return m_report;
+	}
+
+	bool SoftwareRenderer::writePPM(const char* filename)const {
+		std::ofstream file(filename, std::ios::binary);
+		if (!file.is_open()) return false;
+		file << "P6\n" << m_width << " " << m_height << "\n255\n";
+		for (size_t i = 0; i < m_pixels.size(); i += 4)
+			file.write(reinterpret_cast<const char*>(m_pixels.data() + i), 3);
+		return file.good();
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "../Objects/VoxelTraversal.h"
+
+namespace Test {
+	/**
+	 * CPU ray tracer, that renders the same image as the voxel grid RayTracedMesh (RayTracedDiffuseVox.frag), without a graphics device:
+	 * pixel rays, grid walk (VoxelTraversal), shadow rays, shading and background are all mirrored from the shaders (shadow bias has to match RayTracedMesh::KernelOptions).
+	 * Image is split into square tiles, that the worker threads pick up one after another, and the result goes to a plain RGBA framebuffer,
+	 * that can be dumped to a file (see writePPM()).
+	 * Used as the reference for the speed comparisons and as a fallback, whenever there is no GPU to render with.
+	 */
+	class SoftwareRenderer {
+	public:
+		// Default tile width and height in pixels.
+		static const uint32_t DEFAULT_TILE_SIZE = 16;
+
+		/**
+		 * Statistics of the last render() call.
+		 */
+		struct RenderReport {
+			// Number of tiles, the image got split into.
+			uint32_t numTiles;
+
+			// Number of worker threads, the tiles got traced on.
+			uint32_t numThreads;
+
+			// Number of traced rays (primary rays and shadow rays).
+			size_t numRays;
+
+			// Number of primary rays, that hit the geometry.
+			size_t numHits;
+
+			// Render time in seconds.
+			float renderTime;
+
+			// Traced rays per second (millions).
+			float megaRaysPerSecond;
+		};
+
+		/**
+		Creates a CPU ray tracer (nothing gets copied, so the geometry and the voxel data have to outlive the object).
+		@param data Voxel data, built for the geometry.
+		@param verts Mesh vertices.
+		@param indexBuffer Mesh indices.
+		@param width Framebuffer width.
+		@param height Framebuffer height.
+		@param shadowBias Squared distance, subtracted from the one between the light and the shaded point (RayTracedMesh::KernelOptions::shadowBias of the renderer, the image is compared with).
+		@param numThreads Number of worker threads (0 and 1 both mean "render on the calling thread").
+		@param tileSize Tile width and height in pixels (0 is treated as 1).
+		@param traversal Voxel grid cell walk implementation.
+		*/
+		SoftwareRenderer(const VoxelData& data, const std::vector<PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+			uint32_t width, uint32_t height, float shadowBias, uint32_t numThreads = 1, uint32_t tileSize = DEFAULT_TILE_SIZE, VoxelTraversal::Mode traversal = VoxelTraversal::MODE_CELL_STEPPING);
+
+		/**
+		Renders an image to the framebuffer.
+		@param transform View-Projection transformation (same as the one, RayTracedMesh gets; projection is expected to have the Vulkan Y flip).
+		@param light Scene light.
+		@return render statistics.
+		*/
+		const RenderReport& render(const VPTransform& transform, const PointLight& light);
+
+		/**
+		Framebuffer width.
+		@return width in pixels.
+		*/
+		uint32_t width()const;
+
+		/**
+		Framebuffer height.
+		@return height in pixels.
+		*/
+		uint32_t height()const;
+
+		/**
+		Framebuffer content (rows go from top to bottom; each pixel is 8 bit R, G, B and A, sRGB encoded, just like the swap chain images).
+		@return pixels.
+		*/
+		const std::vector<uint8_t>& pixels()const;
+
+		/**
+		Statistics of the last render() call.
+		@return render statistics.
+		*/
+		const RenderReport& report()const;
+
+		/**
+		Dumps the framebuffer to a binary PPM file (alpha gets dropped).
+		@param filename File to write.
+		@return true, if the file got written.
+		*/
+		bool writePPM(const char* filename)const;
+
+
+	private:
+		const VoxelTraversal m_traversal;
+		const std::vector<PNCVertex>& m_verts;
+		const std::vector<uint32_t>& m_indices;
+		const VoxelTraversal::Mode m_mode;
+		const uint32_t m_width;
+		const uint32_t m_height;
+		const float m_shadowBias;
+		const uint32_t m_numThreads;
+		const uint32_t m_tileSize;
+		std::vector<uint8_t> m_pixels;
+		RenderReport m_report;
+
+		SoftwareRenderer(const SoftwareRenderer&) = delete;
+		SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+	};
+}
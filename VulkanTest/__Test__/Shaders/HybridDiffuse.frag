@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+// Fragment shader of the hybrid renderer (HybridMesh): surfaces come from the rasterizer (RasterizedDiffuse.vert),
+// only the shadow rays get traced through the voxel grid (same bindings and variants as RayTracedDiffuseVox.frag).
+
+// Fragments, hidden behind the already drawn geometry, are rejected before the shader runs, so no shadow ray is wasted on them:
+layout(early_fragment_tests) in;
+
+layout(location = 0) in vec3 surfaceNormal;
+layout(location = 1) in vec3 surfacePosition;
+layout(location = 2) in vec3 surfaceColor;
+
+layout(location = 0) out vec4 outColor;
+
+#include "RayTracedDiffuseVox.glsl"
+
+void main() {
+	outColor = shade(surfacePosition, surfaceNormal, surfaceColor);
+}
@@ -0,0 +1,162 @@
+// Brute force ray tracer body (every ray tests every triangle), shared by RayTracedDiffuse.frag and RayTracedDiffuse.comp;
+// Entry point has to declare "outColor" before including this and invoke tracePixel() for each pixel.
+
+// Defined (from compile.bat) for the variants that use precomputed triangle intersection records (TriangleRecords):
+//#define TRIANGLE_RECORDS
+
+// Squared distance, subtracted from the one between the light and the shaded point, so that the surface does not shadow itself (specialization constant, set by RayTracedMesh):
+layout(constant_id = 7) const float SHADOW_BIAS = 0.025f;
+
+struct PNCVertex {
+	vec3 position;
+	vec3 normal;
+	vec3 color;
+};
+
+struct Triangle {
+	PNCVertex a, b, c;
+};
+
+struct Ray {
+	vec3 origin, direction;
+};
+
+#include "RayTriangle.glsl"
+
+#ifdef TRIANGLE_RECORDS
+// Vertex positions of a triangle, stored next to each other (TriangleRecords::Record):
+struct TriangleRecord {
+	vec3 a;
+	vec3 b;
+	vec3 c;
+};
+#endif
+
+// Full vertices (read only for the closest hit, to interpolate normals and colors):
+layout (std430, binding = 1) buffer readonly VertexBuffer {
+	PNCVertex vertex[];
+};
+
+layout (std430, binding = 2) buffer readonly IndexBuffer { // Maybe... Without the index bffer there would be a lessened memory overhead, but let's ignore this for now...
+	uint index[];
+};
+
+layout(binding = 3) uniform Light {
+	vec3 position;
+	vec3 color;
+	vec3 ambientStrength;
+} light;
+
+// Vertex positions alone (w unused; Mesh::positionBuffer()), so that the intersection tests do not pull normals and colors through the cache:
+layout(std430, binding = 4) buffer readonly VertexPositionBuffer {
+	vec4 vertexPosition[];
+};
+
+#ifdef TRIANGLE_RECORDS
+layout(std430, binding = 5) buffer readonly TriangleRecordData {
+	TriangleRecord triangleRecord[];
+};
+#endif
+
+#define INFINITY (1.0f / 0.0f)
+
+// Casts ray on the triangle, starting at given index buffer offset (only positions are loaded, from the position stream; record gets used instead, if available):
+bool castRayOnTriangleRef(in TriangleRay ray, in uint triangleIndex, out float distance, out vec3 barycentrics) {
+#ifdef TRIANGLE_RECORDS
+	const TriangleRecord record = triangleRecord[triangleIndex / 3];
+	return castRayOnTriangle(ray, record.a, record.b, record.c, distance, barycentrics);
+#else
+	return castRayOnTriangle(ray, vertexPosition[index[triangleIndex]].xyz, vertexPosition[index[triangleIndex + 1]].xyz, vertexPosition[index[triangleIndex + 2]].xyz, distance, barycentrics);
+#endif
+}
+
+bool raycast(in Ray ray, out Triangle triangle, out float distance, out vec3 barycentrics) {
+	const TriangleRay triangleRay = prepareTriangleRay(ray);
+	float dist = INFINITY;
+	uint triangleId = 0;
+	vec3 masses = vec3(1.0f, 0.0f, 0.0f);
+	for (uint i = 0; (i + 2) < index.length(); i += 3) {
+		float dst;
+		vec3 mss;
+		if (castRayOnTriangleRef(triangleRay, i, dst, mss))
+			if (dst < dist) {
+				dist = dst;
+				masses = mss;
+				triangleId = i;
+			}
+	}
+	if (isinf(dist)) return false;
+	else {
+		distance = dist;
+		triangle.a = vertex[index[triangleId]];
+		triangle.b = vertex[index[triangleId + 1]];
+		triangle.c = vertex[index[triangleId + 2]];
+		barycentrics = masses;
+		return true;
+	}
+}
+
+// Tells, if anything gets hit within [minDistance, maxDistance) (returns on the first such hit and loads no shading attributes):
+bool occluded(in Ray ray, in float minDistance, in float maxDistance) {
+	const TriangleRay triangleRay = prepareTriangleRay(ray);
+	for (uint i = 0; (i + 2) < index.length(); i += 3) {
+		float dst;
+		vec3 mss;
+		if (castRayOnTriangleRef(triangleRay, i, dst, mss))
+			if (dst >= minDistance && dst < maxDistance) return true;
+	}
+	return false;
+}
+
+vec4 shade(in vec3 worldPos, in vec3 fragNormal, in vec3 pixelColor) {
+	vec3 deltaPos = (light.position - worldPos);
+	float sqrDistance = dot(deltaPos, deltaPos);
+	vec3 color = (light.color / sqrDistance);
+	vec3 dirToLight = (deltaPos / sqrt(sqrDistance));
+	float diffuse = dot(dirToLight, fragNormal);
+	if (diffuse <= 0) diffuse = 0.0f;
+	
+	// Shadows:
+	{
+		Ray ray;
+		ray.origin = light.position;
+		ray.direction = -dirToLight;
+		if (occluded(ray, 0.0f, sqrt(max(sqrDistance - SHADOW_BIAS, 0.0f))))
+			diffuse = 0.0f;
+	}
+	vec3 conserved = (light.ambientStrength + diffuse); 
+	return vec4(pixelColor * color * conserved, 1.0f);
+}
+
+// This is basically not a thing we should even be doing, but some bluish background makes RT mode distinct... 
+// (I had a bit of fun when developing and since this causes no harm, why not leave it be..)
+vec4 background(in Ray ray) {
+	vec3 vectorToCenter = normalize(-ray.origin);
+	float centerCloseness = dot(ray.direction, vectorToCenter);
+	centerCloseness = pow(centerCloseness, 16);
+	return vec4(centerCloseness, centerCloseness, 1.0f, 1.0f);
+}
+
+// Distance to the primary hit, the last tracePixel() call found (negative on miss; compute entry point keeps it for temporal reuse):
+float hitDistance;
+
+// Traces the pixel ray and writes the result to outColor:
+void tracePixel(in vec3 rayOrigin, in vec3 rawRayDirection) {
+	Ray ray;
+	ray.origin = rayOrigin;
+	ray.direction = normalize(rawRayDirection);
+	hitDistance = -1.0f;
+	
+	Triangle triangle;
+	float distance;
+	vec3 masses;
+
+	if (raycast(ray, triangle, distance, masses)) {
+		vec3 hitPoint = (ray.origin + (ray.direction * distance));
+		vec3 fragNormal = ((triangle.a.normal * masses.x) + (triangle.b.normal * masses.y) + (triangle.c.normal * masses.z));
+		vec3 pixelColor = ((triangle.a.color * masses.x) + (triangle.b.color * masses.y) + (triangle.c.color * masses.z));
+		outColor = shade(hitPoint, fragNormal, pixelColor);
+		hitDistance = distance;
+	}
+	else outColor = background(ray);
+}
@@ -0,0 +1,306 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+// Defined (from compile.bat) for the variants that use precomputed triangle intersection records (TriangleRecords):
+//#define TRIANGLE_RECORDS
+
+// If true, the amount of visited BVH nodes is displayed as well (specialization constant, set by RayTracedMesh; same id as DEBUG_VOXELS from RayTracedDiffuseVox.glsl):
+layout(constant_id = 2) const bool DEBUG_NODES = false;
+
+// Squared distance, subtracted from the one between the light and the shaded point, so that the surface does not shadow itself (specialization constant, set by RayTracedMesh):
+layout(constant_id = 7) const float SHADOW_BIAS = 0.025f;
+
+/** ########################################################################################################### */
+/** TYPE DEFINITIONS: */
+struct PNCVertex {
+	vec3 position;
+	vec3 normal;
+	vec3 color;
+};
+
+struct Triangle {
+	PNCVertex a, b, c;
+};
+
+struct Ray {
+	vec3 origin, direction;
+};
+
+struct AABB {
+	vec3 start;
+	vec3 end;
+};
+
+struct BVHNode {
+	vec3 boundsStart;
+	uint firstChildOrRef;
+	vec3 boundsEnd;
+	uint numRefs;
+};
+
+#ifdef TRIANGLE_RECORDS
+// Vertex positions of a triangle, stored next to each other (TriangleRecords::Record):
+struct TriangleRecord {
+	vec3 a;
+	vec3 b;
+	vec3 c;
+};
+#endif
+
+
+
+
+
+/** ########################################################################################################### */
+/** INPUTS: */
+// Full vertices (read only for the closest hit, to interpolate normals and colors):
+layout (std430, binding = 1) buffer readonly VertexBuffer {
+	PNCVertex vertex[];
+};
+
+layout (std430, binding = 2) buffer readonly IndexBuffer { // Maybe... Without the index bffer there would be a lessened memory overhead, but let's ignore this for now...
+	uint index[];
+};
+
+layout(binding = 3) uniform Light {
+	vec3 position;
+	vec3 color;
+	vec3 ambientStrength;
+} light;
+
+layout(std430, binding = 4) buffer readonly BVHNodeData {
+	BVHNode node[];
+};
+
+layout(std430, binding = 5) buffer readonly TriangleRefData {
+	uint triangleRef[];
+};
+
+// Vertex positions alone (w unused; Mesh::positionBuffer()), so that the intersection tests do not pull normals and colors through the cache:
+layout(std430, binding = 6) buffer readonly VertexPositionBuffer {
+	vec4 vertexPosition[];
+};
+
+#ifdef TRIANGLE_RECORDS
+layout(std430, binding = 7) buffer readonly TriangleRecordData {
+	TriangleRecord triangleRecord[];
+};
+#endif
+
+layout(location = 0) in vec3 rayOrigin;
+layout(location = 1) in vec3 rawRayDirection;
+
+layout(location = 0) out vec4 outColor;
+
+
+
+
+
+/** ########################################################################################################### */
+/** TRIANGLE: */
+#include "RayTriangle.glsl"
+
+// Casts ray on the triangle, starting at given index buffer offset (only positions are loaded, from the position stream; record gets used instead, if available):
+bool castRayOnTriangleRef(in TriangleRay ray, in uint triangleIndex, out float distance, out vec3 barycentrics) {
+#ifdef TRIANGLE_RECORDS
+	const TriangleRecord record = triangleRecord[triangleIndex / 3];
+	return castRayOnTriangle(ray, record.a, record.b, record.c, distance, barycentrics);
+#else
+	return castRayOnTriangle(ray, vertexPosition[index[triangleIndex]].xyz, vertexPosition[index[triangleIndex + 1]].xyz, vertexPosition[index[triangleIndex + 2]].xyz, distance, barycentrics);
+#endif
+}
+
+
+
+
+
+/** ########################################################################################################### */
+/** RAYCAST: */
+#define INFINITY (1.0f / 0.0f)
+// Traversal stack size (BVH has to be shallow enough for this, otherwise some of the far nodes will be skipped):
+#define MAX_STACK_SIZE 32
+
+float distanceToNode(in Ray ray, in vec3 invDirection, in uint nodeId, in float maxDistance) {
+	const vec3 startTime = (node[nodeId].boundsStart - ray.origin) * invDirection;
+	const vec3 endTime = (node[nodeId].boundsEnd - ray.origin) * invDirection;
+	const vec3 nearTime = min(startTime, endTime);
+	const vec3 farTime = max(startTime, endTime);
+	const float enterDistance = max(max(nearTime.x, nearTime.y), max(nearTime.z, 0.0f));
+	const float exitDistance = min(min(farTime.x, farTime.y), min(farTime.z, maxDistance));
+	return (enterDistance <= exitDistance) ? enterDistance : INFINITY;
+}
+
+bool raycast(in Ray ray, out Triangle triangle, out float distance, out vec3 barycentrics) {
+	float dist = INFINITY;
+	uint triangleId = 0;
+	vec3 masses = vec3(1.0f, 0.0f, 0.0f);
+	const vec3 invDirection = 1.0f / ray.direction;
+	const TriangleRay triangleRay = prepareTriangleRay(ray);
+
+	uint stack[MAX_STACK_SIZE];
+	uint stackSize = 0;
+	uint nodeId = 0;
+	if (isinf(distanceToNode(ray, invDirection, nodeId, dist))) return false;
+	while (true) {
+		if (DEBUG_NODES) outColor.r = min(outColor.r + 0.02f, 1.0f);
+		const BVHNode current = node[nodeId];
+		if (current.numRefs > 0) {
+			const uint endRef = (current.firstChildOrRef + current.numRefs);
+			for (uint refId = current.firstChildOrRef; refId < endRef; refId++) {
+				const uint triangleIndex = triangleRef[refId];
+				float dst;
+				vec3 mss;
+				if (castRayOnTriangleRef(triangleRay, triangleIndex, dst, mss))
+					if (dst < dist) {
+						dist = dst;
+						masses = mss;
+						triangleId = triangleIndex;
+					}
+			}
+		}
+		else {
+			// Visiting the closer child first and pushing the other one to the stack (left child is always right after the parent):
+			uint nearChild = (nodeId + 1);
+			uint farChild = current.firstChildOrRef;
+			float nearDistance = distanceToNode(ray, invDirection, nearChild, dist);
+			float farDistance = distanceToNode(ray, invDirection, farChild, dist);
+			if (farDistance < nearDistance) {
+				const uint tmpChild = nearChild; nearChild = farChild; farChild = tmpChild;
+				const float tmpDistance = nearDistance; nearDistance = farDistance; farDistance = tmpDistance;
+			}
+			if (!isinf(nearDistance)) {
+				if (!isinf(farDistance) && stackSize < MAX_STACK_SIZE) {
+					stack[stackSize] = farChild;
+					stackSize++;
+				}
+				nodeId = nearChild;
+				continue;
+			}
+		}
+
+		// Popping nodes that are still closer than the best hit:
+		bool found = false;
+		while (stackSize > 0) {
+			stackSize--;
+			nodeId = stack[stackSize];
+			if (!isinf(distanceToNode(ray, invDirection, nodeId, dist))) {
+				found = true;
+				break;
+			}
+		}
+		if (!found) break;
+	}
+
+	if (isinf(dist)) return false;
+	else {
+		distance = dist;
+		triangle.a = vertex[index[triangleId]];
+		triangle.b = vertex[index[triangleId + 1]];
+		triangle.c = vertex[index[triangleId + 2]];
+		barycentrics = masses;
+		return true;
+	}
+}
+
+// Tells, if anything gets hit within [minDistance, maxDistance) (returns on the first such hit and loads no shading attributes):
+bool occluded(in Ray ray, in float minDistance, in float maxDistance) {
+	const vec3 invDirection = 1.0f / ray.direction;
+	const TriangleRay triangleRay = prepareTriangleRay(ray);
+
+	uint stack[MAX_STACK_SIZE];
+	uint stackSize = 0;
+	uint nodeId = 0;
+	if (isinf(distanceToNode(ray, invDirection, nodeId, maxDistance))) return false;
+	while (true) {
+		const BVHNode current = node[nodeId];
+		if (current.numRefs > 0) {
+			const uint endRef = (current.firstChildOrRef + current.numRefs);
+			for (uint refId = current.firstChildOrRef; refId < endRef; refId++) {
+				float dst;
+				vec3 mss;
+				if (castRayOnTriangleRef(triangleRay, triangleRef[refId], dst, mss))
+					if (dst >= minDistance && dst < maxDistance) return true;
+			}
+		}
+		else {
+			// Any blocker will do, but the closer child is still more likely to have one:
+			uint nearChild = (nodeId + 1);
+			uint farChild = current.firstChildOrRef;
+			float nearDistance = distanceToNode(ray, invDirection, nearChild, maxDistance);
+			float farDistance = distanceToNode(ray, invDirection, farChild, maxDistance);
+			if (farDistance < nearDistance) {
+				const uint tmpChild = nearChild; nearChild = farChild; farChild = tmpChild;
+				const float tmpDistance = nearDistance; nearDistance = farDistance; farDistance = tmpDistance;
+			}
+			if (!isinf(nearDistance)) {
+				if (!isinf(farDistance) && stackSize < MAX_STACK_SIZE) {
+					stack[stackSize] = farChild;
+					stackSize++;
+				}
+				nodeId = nearChild;
+				continue;
+			}
+		}
+		if (stackSize <= 0) return false;
+		stackSize--;
+		nodeId = stack[stackSize];
+	}
+}
+
+
+
+
+
+/** ########################################################################################################### */
+/** SHADING: */
+vec4 shade(in vec3 worldPos, in vec3 fragNormal, in vec3 pixelColor) {
+	vec3 deltaPos = (light.position - worldPos);
+	float sqrDistance = dot(deltaPos, deltaPos);
+	vec3 color = (light.color / sqrDistance);
+	vec3 dirToLight = (deltaPos / sqrt(sqrDistance));
+	float diffuse = dot(dirToLight, fragNormal);
+	if (diffuse <= 0) diffuse = 0.0f;
+	
+	// Shadows:
+	{
+		Ray ray;
+		ray.origin = light.position;
+		ray.direction = -dirToLight;
+		if (occluded(ray, 0.0f, sqrt(max(sqrDistance - SHADOW_BIAS, 0.0f))))
+			diffuse = 0.0f;
+	}
+	vec3 conserved = (light.ambientStrength + diffuse); 
+	return vec4(pixelColor * color * conserved, 1.0f);
+}
+
+
+
+
+
+/** ########################################################################################################### */
+/** ENTRY POINT: */
+void main() {
+	if (DEBUG_NODES) outColor = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	Ray ray;
+	ray.origin = rayOrigin;
+	ray.direction = normalize(rawRayDirection);
+	vec3 vectorToCenter = normalize(-rayOrigin);
+	
+	Triangle triangle;
+	float distance;
+	vec3 masses;
+
+	if (raycast(ray, triangle, distance, masses)) {
+		vec3 hitPoint = (ray.origin + (ray.direction * distance));
+		vec3 fragNormal = ((triangle.a.normal * masses.x) + (triangle.b.normal * masses.y) + (triangle.c.normal * masses.z));
+		vec3 pixelColor = ((triangle.a.color * masses.x) + (triangle.b.color * masses.y) + (triangle.c.color * masses.z));
+		outColor = shade(hitPoint, fragNormal, pixelColor);
+	}
+	else if (!DEBUG_NODES) {
+		float centerCloseness = dot(ray.direction, vectorToCenter);
+		centerCloseness = pow(centerCloseness, 16);
+		outColor = vec4(1.0f, centerCloseness, centerCloseness, 1.0f);
+	}
+}
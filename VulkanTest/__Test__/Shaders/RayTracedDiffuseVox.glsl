@@ -0,0 +1,762 @@
+// Voxel grid ray tracer body, shared by RayTracedDiffuseVox.frag and RayTracedDiffuse.comp;
+// Entry point has to declare "outColor" before including this and invoke tracePixel() for each pixel.
+
+// Defined (from compile.bat) for the compact voxel layout (VoxelData::LAYOUT_COMPACT):
+//#define COMPACT_VOXELS
+
+// Defined (from compile.bat) for the variants that use precomputed triangle intersection records (TriangleRecords):
+//#define TRIANGLE_RECORDS
+
+// Defined (from compile.bat) for the variants that look up cached shadow ray occluders (LightVisibility) before walking the grid:
+//#define LIGHT_VISIBILITY
+
+// Number of recently tested triangles, each ray remembers (specialization constant, set by RayTracedMesh; 0 disables mailboxing):
+layout(constant_id = 0) const uint MAILBOX_SIZE = 8;
+
+// If true, cells are walked with the integer 3D-DDA (Amanatides-Woo) instead of stepping through padded cell bounds (specialization constant, set by RayTracedMesh):
+layout(constant_id = 1) const bool INTEGER_DDA = false;
+
+// If true, the voxel grid is displayed as well (visited cells in green, triangle tests in red, mailbox hits in blue; specialization constant, set by RayTracedMesh):
+layout(constant_id = 2) const bool DEBUG_VOXELS = false;
+
+// Number of top-level cells per axis, baked into the pipeline, so that the cell index math folds into constants
+// (specialization constants, set by RayTracedMesh; zeros mean "read gridDivisions()"):
+layout(constant_id = 3) const uint GRID_DIVISIONS_X = 0;
+layout(constant_id = 4) const uint GRID_DIVISIONS_Y = 0;
+layout(constant_id = 5) const uint GRID_DIVISIONS_Z = 0;
+
+// Amount, cell bounds get expanded by during cell stepping, so that the hits on the shared faces are not lost (specialization constant, set by RayTracedMesh):
+layout(constant_id = 6) const float CELL_PADDING = 0.000025f;
+
+// Squared distance, subtracted from the one between the light and the shaded point, so that the surface does not shadow itself (specialization constant, set by RayTracedMesh):
+layout(constant_id = 7) const float SHADOW_BIAS = 0.025f;
+
+/** ########################################################################################################### */
+/** TYPE DEFINITIONS: */
+struct PNCVertex {
+	vec3 position;
+	vec3 normal;
+	vec3 color;
+};
+
+struct Triangle {
+	PNCVertex a, b, c;
+};
+
+struct Ray {
+	vec3 origin, direction;
+};
+
+struct AABB {
+	vec3 start;
+	vec3 end;
+};
+
+#ifdef TRIANGLE_RECORDS
+// Vertex positions of a triangle, stored next to each other (TriangleRecords::Record):
+struct TriangleRecord {
+	vec3 a;
+	vec3 b;
+	vec3 c;
+};
+#endif
+
+#ifdef COMPACT_VOXELS
+// If count has SUB_GRID_FLAG set, offset is the index of the first sub-cell range (sub-cells are laid out the same way as the top-level ones):
+struct VoxelRange {
+	uint offset;
+	uint count;
+};
+#define SUB_GRID_FLAG (uint(1) << 31)
+#else
+struct VoxelEntry {
+	uint triangle;
+	uint next;
+};
+#endif
+
+#ifdef LIGHT_VISIBILITY
+// Range of cell occluders within lightOccluder (LightVisibility::CellOccluders):
+struct LightOccluderRange {
+	uint offset;
+	uint count;
+};
+#define LIGHT_TRACE_CELL (~(uint(0)))
+#endif
+
+
+
+
+
+/** ########################################################################################################### */
+/** INPUTS: */
+// Full vertices (read only for the closest hit, to interpolate normals and colors):
+layout (std430, binding = 1) buffer readonly VertexBuffer {
+	PNCVertex vertex[];
+};
+
+layout (std430, binding = 2) buffer readonly IndexBuffer { // Maybe... Without the index bffer there would be a lessened memory overhead, but let's ignore this for now...
+	uint index[];
+};
+
+layout(binding = 3) uniform Light {
+	vec3 position;
+	vec3 color;
+	vec3 ambientStrength;
+} light;
+
+layout(binding = 4) uniform GridSettings {
+	vec3 gridStart;
+	vec3 gridEnd;
+	uvec3 numDivisions;
+	uvec3 subDivisions;
+} voxelSettings;
+
+#ifdef COMPACT_VOXELS
+layout(std430, binding = 5) buffer readonly VoxelRangeData {
+	VoxelRange voxelRange[];
+};
+
+layout(std430, binding = 6) buffer readonly TriangleRefData {
+	uint triangleRef[];
+};
+#else
+layout(std430, binding = 5) buffer readonly VoxelGridData {
+	uint voxelGrid[];
+};
+
+layout(std430, binding = 6) buffer readonly VoxelEntryData {
+	VoxelEntry voxelEntry[];
+};
+#endif
+
+// Chebyshev distance (in cells) to the nearest non-empty top-level cell (0 for non-empty cells):
+layout(std430, binding = 7) buffer readonly EmptyDistanceData {
+	uint emptyDistance[];
+};
+
+// Vertex positions alone (w unused; Mesh::positionBuffer()), so that the intersection tests do not pull normals and colors through the cache:
+layout(std430, binding = 8) buffer readonly VertexPositionBuffer {
+	vec4 vertexPosition[];
+};
+
+#ifdef TRIANGLE_RECORDS
+layout(std430, binding = 9) buffer readonly TriangleRecordData {
+	TriangleRecord triangleRecord[];
+};
+#define LIGHT_VISIBILITY_BINDING 10
+#else
+#define LIGHT_VISIBILITY_BINDING 9
+#endif
+
+#ifdef LIGHT_VISIBILITY
+// Light and grid, the occluders got collected for (grid does not have to be the same as the voxel grid):
+layout(binding = LIGHT_VISIBILITY_BINDING) uniform LightVisibilitySettings {
+	vec3 lightPosition;
+	vec3 gridStart;
+	vec3 gridEnd;
+	uvec3 numDivisions;
+} lightVisibility;
+
+layout(std430, binding = (LIGHT_VISIBILITY_BINDING + 1)) buffer readonly LightOccluderRangeData {
+	LightOccluderRange lightOccluderRange[];
+};
+
+layout(std430, binding = (LIGHT_VISIBILITY_BINDING + 2)) buffer readonly LightOccluderData {
+	uint lightOccluder[];
+};
+#endif
+
+
+
+
+
+
+/** ########################################################################################################### */
+/** TRIANGLE: */
+#include "RayTriangle.glsl"
+
+// Casts ray on the triangle, starting at given index buffer offset (only positions are loaded, from the position stream; record gets used instead, if available):
+bool castRayOnTriangleRef(in TriangleRay ray, in uint triangleIndex, out float distance, out vec3 barycentrics) {
+#ifdef TRIANGLE_RECORDS
+	const TriangleRecord record = triangleRecord[triangleIndex / 3];
+	return castRayOnTriangle(ray, record.a, record.b, record.c, distance, barycentrics);
+#else
+	return castRayOnTriangle(ray, vertexPosition[index[triangleIndex]].xyz, vertexPosition[index[triangleIndex + 1]].xyz, vertexPosition[index[triangleIndex + 2]].xyz, distance, barycentrics);
+#endif
+}
+
+
+
+
+
+/** ########################################################################################################### */
+/** RAYCAST: */
+#define INFINITY (1.0f / 0.0f)
+#define NO_ENTRY (~(uint(0)))
+
+bool pointInAABB(in vec3 point, in AABB aabb) {
+	return 
+		(point.x >= aabb.start.x && point.x <= aabb.end.x) &&
+		(point.y >= aabb.start.y && point.y <= aabb.end.y) &&
+		(point.z >= aabb.start.z && point.z <= aabb.end.z);
+}
+
+uvec3 gridDivisions() {
+	if (GRID_DIVISIONS_X > 0 && GRID_DIVISIONS_Y > 0 && GRID_DIVISIONS_Z > 0) return uvec3(GRID_DIVISIONS_X, GRID_DIVISIONS_Y, GRID_DIVISIONS_Z);
+	else return voxelSettings.numDivisions;
+}
+
+vec3 cellSize() {
+	return ((voxelSettings.gridEnd - voxelSettings.gridStart) / gridDivisions());
+}
+
+// Tells, if the hit belongs to the current cell (the integer DDA tells the cells apart by the ray distance, the cell is left at; cell stepping uses padded bounds):
+bool hitInCell(in Ray ray, in float dist, in AABB cell, in float cellExit) {
+	if (INTEGER_DDA) return (dist <= cellExit);
+	else return pointInAABB(ray.origin + ray.direction * dist, cell);
+}
+
+// Ray, the triangles get tested against (raycast() prepares it once per ray):
+TriangleRay triangleRay;
+
+// Occlusion queries (occluded()) accept any hit within [rayMinDistance, rayMaxDistance) regardless of the cell and end the walk right away:
+bool anyHit;
+float rayMinDistance;
+float rayMaxDistance;
+
+// Tells, if the hit should replace the current one (dist is the closest distance so far):
+bool acceptHit(in Ray ray, in float dst, in float dist, in AABB cell, in float cellExit) {
+	if (anyHit) return (dst >= rayMinDistance && dst < rayMaxDistance);
+	else return (dst < dist && hitInCell(ray, dst, cell, cellExit));
+}
+
+// Triangles, spanning several cells, would otherwise get tested once per cell; each ray keeps a small ring of the recently tested ones instead
+// (distance is stored, since the hit point may lie outside the cell, the triangle was first tested in; misses are stored as INFINITY):
+uint mailboxTriangle[MAILBOX_SIZE + 1];
+float mailboxDistance[MAILBOX_SIZE + 1];
+vec3 mailboxMasses[MAILBOX_SIZE + 1];
+uint mailboxCount;
+uint mailboxNext;
+
+void clearMailbox() {
+	mailboxCount = 0;
+	mailboxNext = 0;
+}
+
+bool castRayOnTriangleMailboxed(in uint triangleIndex, out float distance, out vec3 barycentrics) {
+	for (uint i = 0; i < mailboxCount; i++)
+		if (mailboxTriangle[i] == triangleIndex) {
+			if (DEBUG_VOXELS) outColor.b = min(outColor.b + 0.1f, 1.0f);
+			distance = mailboxDistance[i];
+			barycentrics = mailboxMasses[i];
+			return !isinf(distance);
+		}
+	const bool hit = castRayOnTriangleRef(triangleRay, triangleIndex, distance, barycentrics);
+	if (MAILBOX_SIZE > 0) {
+		mailboxTriangle[mailboxNext] = triangleIndex;
+		mailboxDistance[mailboxNext] = hit ? distance : INFINITY;
+		mailboxMasses[mailboxNext] = hit ? barycentrics : vec3(0.0f);
+		mailboxNext = ((mailboxNext + 1) % MAILBOX_SIZE);
+		mailboxCount = min(mailboxCount + 1, MAILBOX_SIZE);
+	}
+	return hit;
+}
+
+bool findFirstCell(in Ray ray, in AABB grid, in uvec3 numDivisions, out uvec3 cellId, out vec3 point) {
+	AABB fullBox;
+	fullBox.start = grid.start + 0.000001f;
+	fullBox.end = grid.end - 0.000001f;
+	
+	vec3 invDir = 1.0f / ray.direction;
+	float ds = (grid.start.x - ray.origin.x) * invDir.x;
+	float de = (grid.end.x - ray.origin.x) * invDir.x;
+	float mn = min(ds, de), mx = max(ds, de);
+	ds = (grid.start.y - ray.origin.y) * invDir.y;
+	de = (grid.end.y - ray.origin.y) * invDir.y;
+	mn = max(mn, min(ds, de));
+	mx = min(mx, max(ds, de));
+	ds = (grid.start.z - ray.origin.z) * invDir.z;
+	de = (grid.end.z - ray.origin.z) * invDir.z;
+	mn = max(mn, min(ds, de));
+	mx = min(mx, max(ds, de));
+	if (mn > mx + 0.0001f) return false;
+	else if (mn < 0.0f) mn = 0.0f;
+	point = (ray.origin + (mn * ray.direction));
+	// To make sure, point is exactly inside the box and avoid random erros caused by floating point calculations:
+	{
+		if (point.x < fullBox.start.x) point.x = fullBox.start.x;
+		if (point.y < fullBox.start.y) point.y = fullBox.start.y;
+		if (point.z < fullBox.start.z) point.z = fullBox.start.z;
+
+		if (point.x > fullBox.end.x) point.x = fullBox.end.x;
+		if (point.y > fullBox.end.y) point.y = fullBox.end.y;
+		if (point.z > fullBox.end.z) point.z = fullBox.end.z;
+	}
+	cellId = min(uvec3((point - grid.start) / ((grid.end - grid.start) / numDivisions)), numDivisions - 1);
+	return true;
+}
+
+bool findNextCell(inout Ray invRay, in vec3 direction, in vec3 cellSz, in uvec3 numDivisions, inout AABB cell, inout uvec3 cellId) {
+	ivec3 indexDelta = ivec3(0, 0, 0);
+	float minDist = INFINITY;
+	
+	const vec3 startTime = (cell.start - invRay.origin) * invRay.direction;
+	const vec3 endTime = (cell.end - invRay.origin) * invRay.direction;
+
+	if (invRay.direction.x > 0) {
+		if (minDist > endTime.x && cellId.x < (numDivisions.x - 1)) {
+			indexDelta = ivec3(1, 0, 0);
+			minDist = endTime.x;
+		}
+	}
+	else if (invRay.direction.x < 0) {
+		if (minDist > startTime.x && cellId.x > 0) {
+			indexDelta = ivec3(-1, 0, 0);
+			minDist = startTime.x;
+		}
+	}
+
+	if (invRay.direction.y > 0) {
+		if (minDist > endTime.y && cellId.y < (numDivisions.y - 1)) {
+			indexDelta = ivec3(0, 1, 0);
+			minDist = endTime.y;
+		}
+	}
+	else if (invRay.direction.y < 0) {
+		if (minDist > startTime.y && cellId.y > 0) {
+			indexDelta = ivec3(0, -1, 0);
+			minDist = startTime.y;
+		}
+	}
+
+	if (invRay.direction.z > 0) {
+		if (minDist > endTime.z && cellId.z < (numDivisions.z - 1)) {
+			indexDelta = ivec3(0, 0, 1);
+			minDist = endTime.z;
+		}
+	}
+	else if (invRay.direction.z < 0) {
+		if (minDist > startTime.z && cellId.z > 0) {
+			indexDelta = ivec3(0, 0, -1);
+			minDist = startTime.z;
+		}
+	}
+
+	if (isinf(minDist) || minDist < 0.0f) return false;
+
+	const vec3 cellDelta = (vec3(indexDelta) * cellSz);
+	cell.start += cellDelta;
+	cell.end += cellDelta;
+	cellId = ivec3(cellId) + indexDelta;
+	invRay.origin += direction * minDist;
+	return pointInAABB(invRay.origin, cell);
+}
+
+// Jumps over the box of empty cells within (radius) cells around the current one (cell and cellId end up right after the box):
+bool skipEmptyCells(inout Ray invRay, in vec3 direction, in vec3 cellSz, in uint radius, inout AABB cell, inout uvec3 cellId) {
+	const ivec3 boxFirst = max(ivec3(cellId) - int(radius), ivec3(0, 0, 0));
+	const ivec3 boxLast = min(ivec3(cellId) + int(radius), ivec3(gridDivisions()) - 1);
+	const vec3 boxStart = (voxelSettings.gridStart + (cellSz * vec3(boxFirst)));
+	const vec3 boxEnd = (voxelSettings.gridStart + (cellSz * vec3(boxLast + 1)));
+
+	float minDist = INFINITY;
+	int exitAxis = -1;
+	for (int axis = 0; axis < 3; axis++) {
+		if (isinf(invRay.direction[axis])) continue;
+		const float dist = ((((invRay.direction[axis] > 0) ? boxEnd[axis] : boxStart[axis]) - invRay.origin[axis]) * invRay.direction[axis]);
+		if (dist < minDist) {
+			minDist = dist;
+			exitAxis = axis;
+		}
+	}
+	if (exitAxis < 0) return false;
+
+	invRay.origin += direction * max(minDist, 0.0f);
+	ivec3 nextCell = clamp(ivec3((invRay.origin - voxelSettings.gridStart) / cellSz), boxFirst, boxLast);
+	nextCell[exitAxis] = (invRay.direction[exitAxis] > 0) ? (boxLast[exitAxis] + 1) : (boxFirst[exitAxis] - 1);
+	if (nextCell[exitAxis] < 0 || nextCell[exitAxis] >= int(gridDivisions()[exitAxis])) return false;
+	cellId = uvec3(nextCell);
+	cell.start = ((cellSz * vec3(cellId)) + voxelSettings.gridStart);
+	cell.end = (cell.start + cellSz + CELL_PADDING);
+	cell.start -= CELL_PADDING;
+	return true;
+}
+
+// Integer 3D-DDA state: current cell, step direction, ray distance to the next boundary and distance between the boundaries per axis:
+struct DDA {
+	ivec3 cellId;
+	ivec3 step;
+	vec3 tMax;
+	vec3 tDelta;
+};
+
+// Ray distances, the box is entered and left at (enterDistance is never negative):
+bool rayBoxRange(in Ray ray, in vec3 boxStart, in vec3 boxEnd, out float enterDistance, out float exitDistance) {
+	enterDistance = 0.0f;
+	exitDistance = INFINITY;
+	for (int axis = 0; axis < 3; axis++) {
+		if (ray.direction[axis] == 0.0f) {
+			if (ray.origin[axis] < boxStart[axis] || ray.origin[axis] > boxEnd[axis]) return false;
+			continue;
+		}
+		const float startTime = ((boxStart[axis] - ray.origin[axis]) / ray.direction[axis]);
+		const float endTime = ((boxEnd[axis] - ray.origin[axis]) / ray.direction[axis]);
+		enterDistance = max(enterDistance, min(startTime, endTime));
+		exitDistance = min(exitDistance, max(startTime, endTime));
+	}
+	return (enterDistance <= exitDistance);
+}
+
+// Cell, containing the point at given ray distance (clamped to the grid):
+ivec3 cellAt(in Ray ray, in float dist, in vec3 gridStart, in vec3 cellSz, in uvec3 numDivisions) {
+	return clamp(ivec3(floor(((ray.origin + (ray.direction * dist)) - gridStart) / cellSz)), ivec3(0, 0, 0), ivec3(numDivisions) - 1);
+}
+
+// tMax and tDelta are computed once per cell the walk (re)starts from; after that, stepDDA only adds and compares:
+DDA startDDA(in Ray ray, in vec3 gridStart, in vec3 cellSz, in ivec3 cellId) {
+	DDA dda;
+	dda.cellId = cellId;
+	for (int axis = 0; axis < 3; axis++) {
+		if (ray.direction[axis] > 0.0f) {
+			dda.step[axis] = 1;
+			dda.tMax[axis] = ((gridStart[axis] + (cellSz[axis] * float(cellId[axis] + 1)) - ray.origin[axis]) / ray.direction[axis]);
+			dda.tDelta[axis] = (cellSz[axis] / ray.direction[axis]);
+		}
+		else if (ray.direction[axis] < 0.0f) {
+			dda.step[axis] = -1;
+			dda.tMax[axis] = ((gridStart[axis] + (cellSz[axis] * float(cellId[axis])) - ray.origin[axis]) / ray.direction[axis]);
+			dda.tDelta[axis] = (-cellSz[axis] / ray.direction[axis]);
+		}
+		else {
+			dda.step[axis] = 0;
+			dda.tMax[axis] = INFINITY;
+			dda.tDelta[axis] = INFINITY;
+		}
+	}
+	return dda;
+}
+
+float cellExitDDA(in DDA dda) {
+	return min(min(dda.tMax.x, dda.tMax.y), dda.tMax.z);
+}
+
+// Steps to the neighbour across the closest boundary (false, once the ray leaves the grid):
+bool stepDDA(inout DDA dda, in uvec3 numDivisions) {
+	const int axis = (dda.tMax.x < dda.tMax.y) ? ((dda.tMax.x < dda.tMax.z) ? 0 : 2) : ((dda.tMax.y < dda.tMax.z) ? 1 : 2);
+	dda.cellId[axis] += dda.step[axis];
+	if (dda.cellId[axis] < 0 || dda.cellId[axis] >= int(numDivisions[axis])) return false;
+	dda.tMax[axis] += dda.tDelta[axis];
+	return true;
+}
+
+// Same as skipEmptyCells, but the walk restarts from the cell right after the box:
+bool skipEmptyCellsDDA(in Ray ray, in vec3 cellSz, in uint radius, inout DDA dda) {
+	const ivec3 boxFirst = max(dda.cellId - int(radius), ivec3(0, 0, 0));
+	const ivec3 boxLast = min(dda.cellId + int(radius), ivec3(gridDivisions()) - 1);
+	float exitDistance = INFINITY;
+	int exitAxis = -1;
+	for (int axis = 0; axis < 3; axis++) {
+		if (dda.step[axis] == 0) continue;
+		const int boundary = (dda.step[axis] > 0) ? (boxLast[axis] + 1) : boxFirst[axis];
+		const float dist = ((voxelSettings.gridStart[axis] + (cellSz[axis] * float(boundary)) - ray.origin[axis]) / ray.direction[axis]);
+		if (dist < exitDistance) {
+			exitDistance = dist;
+			exitAxis = axis;
+		}
+	}
+	if (exitAxis < 0) return false;
+	ivec3 nextCell = clamp(cellAt(ray, exitDistance, voxelSettings.gridStart, cellSz, gridDivisions()), boxFirst, boxLast);
+	nextCell[exitAxis] = (dda.step[exitAxis] > 0) ? (boxLast[exitAxis] + 1) : (boxFirst[exitAxis] - 1);
+	if (nextCell[exitAxis] < 0 || nextCell[exitAxis] >= int(gridDivisions()[exitAxis])) return false;
+	dda = startDDA(ray, voxelSettings.gridStart, cellSz, nextCell);
+	return true;
+}
+
+#ifdef COMPACT_VOXELS
+void castInRange(in Ray ray, in VoxelRange range, in AABB cell, in float cellExit, inout float dist, inout uint triangleId, inout vec3 masses) {
+	const uint endRef = (range.offset + range.count);
+	for (uint refId = range.offset; refId < endRef; refId++) {
+		if (DEBUG_VOXELS) outColor.r = min(outColor.r + 0.1f, 1.0f);
+		const uint triangleIndex = triangleRef[refId];
+		float dst;
+		vec3 mss;
+		if (castRayOnTriangleMailboxed(triangleIndex, dst, mss))
+			if (acceptHit(ray, dst, dist, cell, cellExit)) {
+				dist = dst;
+				masses = mss;
+				triangleId = triangleIndex;
+				if (anyHit) return;
+			}
+	}
+}
+
+void castInSubGrid(in Ray ray, in uint firstSubCell, in AABB cell, in float cellExit, inout float dist, inout uint triangleId, inout vec3 masses) {
+	if (INTEGER_DDA) {
+		// Cell bounds are exact here; even if the ray only grazes the cell, cellAt keeps the walk inside the sub-grid:
+		float enterDistance, exitDistance;
+		rayBoxRange(ray, cell.start, cell.end, enterDistance, exitDistance);
+		const vec3 subCellSz = ((cell.end - cell.start) / voxelSettings.subDivisions);
+		DDA dda = startDDA(ray, cell.start, subCellSz, cellAt(ray, enterDistance, cell.start, subCellSz, voxelSettings.subDivisions));
+		while (true) {
+			const uint subCellIndex = firstSubCell + ((voxelSettings.subDivisions.x * ((dda.cellId.z * voxelSettings.subDivisions.y) + dda.cellId.y)) + dda.cellId.x);
+			castInRange(ray, voxelRange[subCellIndex], cell, min(cellExitDDA(dda), cellExit), dist, triangleId, masses);
+			if (!isinf(dist)) return;
+			else if (!stepDDA(dda, voxelSettings.subDivisions)) return;
+		}
+	}
+	// Top-level cell bounds are slightly expanded, so we shrink them back:
+	AABB grid;
+	{
+		grid.start = cell.start + CELL_PADDING;
+		grid.end = cell.end - CELL_PADDING;
+	}
+	uvec3 subCellId;
+	vec3 entryPoint;
+	if (!findFirstCell(ray, grid, voxelSettings.subDivisions, subCellId, entryPoint)) return;
+	Ray invRay;
+	{
+		invRay.origin = entryPoint;
+		invRay.direction = 1.0f / ray.direction;
+	}
+	const vec3 subCellSz = ((grid.end - grid.start) / voxelSettings.subDivisions);
+	AABB subCell;
+	{
+		subCell.start = ((subCellSz * vec3(subCellId)) + grid.start);
+		subCell.end = (subCell.start + subCellSz + CELL_PADDING);
+		subCell.start -= CELL_PADDING;
+	}
+	while (true) {
+		const uint subCellIndex = firstSubCell + ((voxelSettings.subDivisions.x * ((subCellId.z * voxelSettings.subDivisions.y) + subCellId.y)) + subCellId.x);
+		castInRange(ray, voxelRange[subCellIndex], subCell, cellExit, dist, triangleId, masses);
+		if (!isinf(dist)) return;
+		else if (!findNextCell(invRay, ray.direction, subCellSz, voxelSettings.subDivisions, subCell, subCellId)) return;
+	}
+}
+#endif
+
+bool castInCell(in Ray ray, in uvec3 cellId, in AABB cell, in float cellExit, out uint triangle, out float distance, out vec3 barycentrics) {
+	float dist = INFINITY;
+	uint triangleId = 0;
+	vec3 masses = vec3(1.0f, 0.0f, 0.0f);
+	const uint voxelId = ((gridDivisions().x * ((cellId.z * gridDivisions().y) + cellId.y)) + cellId.x);
+#ifdef COMPACT_VOXELS
+	const VoxelRange range = voxelRange[voxelId];
+	if ((range.count & SUB_GRID_FLAG) != 0) castInSubGrid(ray, range.offset, cell, cellExit, dist, triangleId, masses);
+	else castInRange(ray, range, cell, cellExit, dist, triangleId, masses);
+#else
+	uint entryId = voxelGrid[voxelId];
+	while (entryId != NO_ENTRY) {
+		if (DEBUG_VOXELS) outColor.r = min(outColor.r + 0.1f, 1.0f);
+		const VoxelEntry entry = voxelEntry[entryId];
+		float dst;
+		vec3 mss;
+		if (castRayOnTriangleMailboxed(entry.triangle, dst, mss))
+			if (acceptHit(ray, dst, dist, cell, cellExit)) {
+				dist = dst;
+				masses = mss;
+				triangleId = entry.triangle;
+				if (anyHit) break;
+			}
+		entryId = entry.next;
+	}
+#endif
+	if (isinf(dist)) return false;
+	else {
+		distance = dist;
+		triangle = triangleId;
+		barycentrics = masses;
+		return true;
+	}
+}
+
+bool walkGridDDA(in Ray ray, out uint triangle, out float distance, out vec3 barycentrics) {
+	float enterDistance, exitDistance;
+	if (!rayBoxRange(ray, voxelSettings.gridStart, voxelSettings.gridEnd, enterDistance, exitDistance)) return false;
+	clearMailbox();
+	triangleRay = prepareTriangleRay(ray);
+	const vec3 cellSz = cellSize();
+	DDA dda = startDDA(ray, voxelSettings.gridStart, cellSz, cellAt(ray, enterDistance, voxelSettings.gridStart, cellSz, gridDivisions()));
+	while (true) {
+		const uint skipDistance = emptyDistance[(gridDivisions().x * ((dda.cellId.z * gridDivisions().y) + dda.cellId.y)) + dda.cellId.x];
+		if (skipDistance > 1) {
+			if (!skipEmptyCellsDDA(ray, cellSz, skipDistance - 1, dda)) return false;
+		}
+		else {
+			AABB cell;
+			{
+				cell.start = ((cellSz * vec3(dda.cellId)) + voxelSettings.gridStart);
+				cell.end = (cell.start + cellSz);
+			}
+			if (castInCell(ray, uvec3(dda.cellId), cell, cellExitDDA(dda), triangle, distance, barycentrics)) return true;
+			else if (cellExitDDA(dda) >= rayMaxDistance) return false;
+			else if (!stepDDA(dda, gridDivisions())) return false;
+		}
+		if (DEBUG_VOXELS) outColor.g += 1.0f / float(gridDivisions().x + gridDivisions().y + gridDivisions().z);
+	}
+}
+
+// Walks the grid till the first cell with an accepted hit (triangle is the index buffer offset of the hit triangle):
+bool walkGrid(in Ray ray, out uint triangle, out float distance, out vec3 barycentrics) {
+	if (INTEGER_DDA) return walkGridDDA(ray, triangle, distance, barycentrics);
+	uvec3 cellId;
+	vec3 point;
+	AABB grid;
+	{
+		grid.start = voxelSettings.gridStart;
+		grid.end = voxelSettings.gridEnd;
+	}
+	if (!findFirstCell(ray, grid, gridDivisions(), cellId, point)) return false;
+	clearMailbox();
+	triangleRay = prepareTriangleRay(ray);
+	Ray invRay;
+	{
+		invRay.origin = point;
+		invRay.direction = 1.0f / ray.direction;
+	}
+	const vec3 cellSz = cellSize();
+	AABB cell;
+	{
+		cell.start = ((cellSz * vec3(cellId)) + voxelSettings.gridStart);
+		cell.end = (cell.start + cellSz + CELL_PADDING);
+		cell.start -= CELL_PADDING;
+	}
+	while (true) {
+		// Nothing past the maximal distance matters (ray direction is normalized):
+		if (dot(invRay.origin - ray.origin, ray.direction) >= rayMaxDistance) return false;
+
+		// Cells, surrounded by empty space, let us skip a few cells at once:
+		const uint skipDistance = emptyDistance[(gridDivisions().x * ((cellId.z * gridDivisions().y) + cellId.y)) + cellId.x];
+		if (skipDistance > 1) {
+			if (!skipEmptyCells(invRay, ray.direction, cellSz, skipDistance - 1, cell, cellId)) return false;
+		}
+		else if (castInCell(ray, cellId, cell, INFINITY, triangle, distance, barycentrics)) return true;
+		else if (!findNextCell(invRay, ray.direction, cellSz, gridDivisions(), cell, cellId)) return false;
+		if (DEBUG_VOXELS) outColor.g += 1.0f / float(gridDivisions().x + gridDivisions().y + gridDivisions().z);
+	}
+}
+
+// Closest hit:
+bool raycast(in Ray ray, out Triangle triangle, out float distance, out vec3 barycentrics) {
+	anyHit = false;
+	rayMinDistance = 0.0f;
+	rayMaxDistance = INFINITY;
+	uint triangleId;
+	if (!walkGrid(ray, triangleId, distance, barycentrics)) return false;
+	triangle.a = vertex[index[triangleId]];
+	triangle.b = vertex[index[triangleId + 1]];
+	triangle.c = vertex[index[triangleId + 2]];
+	return true;
+}
+
+// Tells, if anything gets hit within [minDistance, maxDistance) (returns on the first such hit and loads no shading attributes):
+bool occluded(in Ray ray, in float minDistance, in float maxDistance) {
+	anyHit = true;
+	rayMinDistance = minDistance;
+	rayMaxDistance = maxDistance;
+	uint triangleId;
+	float distance;
+	vec3 barycentrics;
+	return walkGrid(ray, triangleId, distance, barycentrics);
+}
+
+
+
+
+
+#ifdef LIGHT_VISIBILITY
+// Tests the shadow ray against the cached occluders of the cell, the point is in (known is false, if the ray has to walk the grid instead;
+// that happens for the points outside the grid, cells with too many occluders and when the light has moved since the cache got built):
+bool occludedCached(in Ray ray, in vec3 point, in float maxDistance, out bool known) {
+	known = false;
+	if (lightVisibility.lightPosition != light.position) return false;
+	const vec3 visibilityCellSize = ((lightVisibility.gridEnd - lightVisibility.gridStart) / vec3(lightVisibility.numDivisions));
+	const ivec3 cellId = ivec3(floor((point - lightVisibility.gridStart) / visibilityCellSize));
+	if (any(lessThan(cellId, ivec3(0, 0, 0))) || any(greaterThanEqual(cellId, ivec3(lightVisibility.numDivisions)))) return false;
+	const LightOccluderRange range = lightOccluderRange[(lightVisibility.numDivisions.x * ((cellId.z * lightVisibility.numDivisions.y) + cellId.y)) + cellId.x];
+	if (range.count == LIGHT_TRACE_CELL) return false;
+	known = true;
+	const TriangleRay occluderRay = prepareTriangleRay(ray);
+	const uint endOccluder = (range.offset + range.count);
+	for (uint i = range.offset; i < endOccluder; i++) {
+		float distance;
+		vec3 barycentrics;
+		if (castRayOnTriangleRef(occluderRay, lightOccluder[i], distance, barycentrics) && distance < maxDistance) return true;
+	}
+	return false;
+}
+#endif
+
+
+
+
+
+/** ########################################################################################################### */
+/** SHADING: */
+vec4 shade(in vec3 worldPos, in vec3 fragNormal, in vec3 pixelColor) {
+	vec3 deltaPos = (light.position - worldPos);
+	float sqrDistance = dot(deltaPos, deltaPos);
+	vec3 color = (light.color / sqrDistance);
+	vec3 dirToLight = (deltaPos / sqrt(sqrDistance));
+	float diffuse = dot(dirToLight, fragNormal);
+	if (diffuse <= 0) diffuse = 0.0f;
+	
+	// Shadows:
+	{
+		Ray ray;
+		ray.origin = light.position;
+		ray.direction = -dirToLight;
+		const float maxDistance = sqrt(max(sqrDistance - SHADOW_BIAS, 0.0f));
+#ifdef LIGHT_VISIBILITY
+		bool known;
+		const bool shadowed = occludedCached(ray, worldPos, maxDistance, known);
+		if (known ? shadowed : occluded(ray, 0.0f, maxDistance))
+			diffuse = 0.0f;
+#else
+		if (occluded(ray, 0.0f, maxDistance))
+			diffuse = 0.0f;
+#endif
+	}
+	vec3 conserved = (light.ambientStrength + diffuse); 
+	return vec4(pixelColor * color * conserved, 1.0f);
+}
+
+
+
+
+
+/** ########################################################################################################### */
+/** PIXEL: */
+// Reddish background for the rays that miss everything:
+vec4 background(in Ray ray) {
+	vec3 vectorToCenter = normalize(-ray.origin);
+	float centerCloseness = dot(ray.direction, vectorToCenter);
+	centerCloseness = pow(centerCloseness, 16);
+	return vec4(1.0f, centerCloseness, centerCloseness, 1.0f);
+}
+
+// Distance to the primary hit, the last tracePixel() call found (negative on miss; compute entry point keeps it for temporal reuse):
+float hitDistance;
+
+// Traces the pixel ray and writes the result to outColor:
+void tracePixel(in vec3 rayOrigin, in vec3 rawRayDirection) {
+	if (DEBUG_VOXELS) outColor = vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	Ray ray;
+	ray.origin = rayOrigin;
+	ray.direction = normalize(rawRayDirection);
+	hitDistance = -1.0f;
+	
+	Triangle triangle;
+	float distance;
+	vec3 masses;
+
+	if (raycast(ray, triangle, distance, masses)) {
+		vec3 hitPoint = (ray.origin + (ray.direction * distance));
+		vec3 fragNormal = ((triangle.a.normal * masses.x) + (triangle.b.normal * masses.y) + (triangle.c.normal * masses.z));
+		vec3 pixelColor = ((triangle.a.color * masses.x) + (triangle.b.color * masses.y) + (triangle.c.color * masses.z));
+		outColor = shade(hitPoint, fragNormal, pixelColor);
+		hitDistance = distance;
+	}
+	else if (!DEBUG_VOXELS) outColor = background(ray);
+}
@@ -0,0 +1,52 @@
+// Watertight ray/triangle intersection (Woop, Benthin & Wald, "Watertight Ray/Triangle Intersection"), shared by all the ray tracers;
+// C++ mirror (with a micro-benchmark) is RayTriangle from __Test__/Objects; math is precise, so that the hit/miss decision matches it bit for bit.
+// Including shader has to define Ray before including this.
+
+// Ray, prepared for the intersection tests (RayTriangle::Ray):
+struct TriangleRay {
+	vec3 origin;
+	mat3 shear;
+	float invScale;
+};
+
+// Moves the dominant axis of the ray direction to Z (once per ray; X and Y get swapped for negative directions, so that the winding stays the same):
+TriangleRay prepareTriangleRay(in Ray ray) {
+	const vec3 absDirection = abs(ray.direction);
+	const int kz = (absDirection.x > absDirection.y) ? ((absDirection.x > absDirection.z) ? 0 : 2) : ((absDirection.y > absDirection.z) ? 1 : 2);
+	int kx = ((kz + 1) % 3);
+	int ky = ((kx + 1) % 3);
+	if (ray.direction[kz] < 0.0f) {
+		const int tmp = kx;
+		kx = ky;
+		ky = tmp;
+	}
+	TriangleRay result;
+	result.origin = ray.origin;
+	result.shear = mat3(0.0f);
+	result.shear[kx][0] = ray.direction[kz];
+	result.shear[kz][0] = -ray.direction[kx];
+	result.shear[ky][1] = ray.direction[kz];
+	result.shear[kz][1] = -ray.direction[ky];
+	result.shear[kz][2] = (ray.direction[kz] < 0.0f) ? -1.0f : 1.0f;
+	result.invScale = (1.0f / absDirection[kz]);
+	return result;
+}
+
+// Front faces only; barycentrics are the weights of a, b and c at the hit point:
+bool castRayOnTriangle(in TriangleRay ray, in vec3 a, in vec3 b, in vec3 c, out float distance, out vec3 barycentrics) {
+	precise vec3 A = (ray.shear * (a - ray.origin));
+	precise vec3 B = (ray.shear * (b - ray.origin));
+	precise vec3 C = (ray.shear * (c - ray.origin));
+	precise float U = ((C.x * B.y) - (C.y * B.x));
+	precise float V = ((A.x * C.y) - (A.y * C.x));
+	precise float W = ((B.x * A.y) - (B.y * A.x));
+	if (U < 0.0f || V < 0.0f || W < 0.0f) return false;
+	precise float det = (U + V + W);
+	if (det <= 0.0f) return false;
+	precise float T = ((U * A.z) + (V * B.z) + (W * C.z));
+	if (T <= 0.0f) return false;
+	const float invDet = (1.0f / det);
+	distance = ((T * invDet) * ray.invScale);
+	barycentrics = (vec3(U, V, W) * invDet);
+	return true;
+}
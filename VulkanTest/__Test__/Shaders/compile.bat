@@ -1,6 +1,49 @@
-C:/VulkanSDK/1.2.131.2/Bin32/glslc.exe RasterizedDiffuse.vert -o RasterizedDiffuseVert.spv
-C:/VulkanSDK/1.2.131.2/Bin32/glslc.exe RasterizedDiffuse.frag -o RasterizedDiffuseFrag.spv
-C:/VulkanSDK/1.2.131.2/Bin32/glslc.exe RayTracedDiffuse.vert -o RayTracedDiffuseVert.spv
-C:/VulkanSDK/1.2.131.2/Bin32/glslc.exe RayTracedDiffuse.frag -o RayTracedDiffuseFrag.spv
-C:/VulkanSDK/1.2.131.2/Bin32/glslc.exe RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVox.spv
+@echo off
+rem Compiles all the shaders (and their variants) to SPIR-V; VulkanTest.vcxproj runs this before every build, so the .spv files never fall behind the sources.
+rem glslc comes from the installed Vulkan SDK (VULKAN_SDK), if there is one; the first shader that fails to compile fails the build.
+rem (no parenthesized blocks here, since the SDK path may contain parentheses itself)
+set GLSLC="C:/VulkanSDK/1.2.131.2/Bin32/glslc.exe"
+if defined VULKAN_SDK set GLSLC="%VULKAN_SDK%\Bin\glslc.exe"
+if not exist %GLSLC% echo compile.bat: glslc not found at %GLSLC% & exit /b 1
+cd /d "%~dp0"
+
+%GLSLC% RasterizedDiffuse.vert -o RasterizedDiffuseVert.spv || exit /b 1
+%GLSLC% RasterizedDiffuse.frag -o RasterizedDiffuseFrag.spv || exit /b 1
+%GLSLC% RayTracedDiffuse.vert -o RayTracedDiffuseVert.spv || exit /b 1
+%GLSLC% RayTracedDiffuse.frag -o RayTracedDiffuseFrag.spv || exit /b 1
+%GLSLC% RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVox.spv || exit /b 1
+%GLSLC% -DCOMPACT_VOXELS RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVoxCompact.spv || exit /b 1
+%GLSLC% RayTracedDiffuseBVH.frag -o RayTracedDiffuseFragBVH.spv || exit /b 1
+%GLSLC% -DTRIANGLE_RECORDS RayTracedDiffuse.frag -o RayTracedDiffuseFragRec.spv || exit /b 1
+%GLSLC% -DTRIANGLE_RECORDS RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVoxRec.spv || exit /b 1
+%GLSLC% -DCOMPACT_VOXELS -DTRIANGLE_RECORDS RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVoxCompactRec.spv || exit /b 1
+%GLSLC% -DLIGHT_VISIBILITY RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVoxVis.spv || exit /b 1
+%GLSLC% -DCOMPACT_VOXELS -DLIGHT_VISIBILITY RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVoxCompactVis.spv || exit /b 1
+%GLSLC% -DTRIANGLE_RECORDS -DLIGHT_VISIBILITY RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVoxRecVis.spv || exit /b 1
+%GLSLC% -DCOMPACT_VOXELS -DTRIANGLE_RECORDS -DLIGHT_VISIBILITY RayTracedDiffuseVox.frag -o RayTracedDiffuseFragVoxCompactRecVis.spv || exit /b 1
+%GLSLC% -DTRIANGLE_RECORDS RayTracedDiffuseBVH.frag -o RayTracedDiffuseFragBVHRec.spv || exit /b 1
+%GLSLC% RayTracedDiffuse.comp -o RayTracedDiffuseComp.spv || exit /b 1
+%GLSLC% -DVOXEL_GRID RayTracedDiffuse.comp -o RayTracedDiffuseCompVox.spv || exit /b 1
+%GLSLC% -DVOXEL_GRID -DCOMPACT_VOXELS RayTracedDiffuse.comp -o RayTracedDiffuseCompVoxCompact.spv || exit /b 1
+%GLSLC% -DTRIANGLE_RECORDS RayTracedDiffuse.comp -o RayTracedDiffuseCompRec.spv || exit /b 1
+%GLSLC% -DVOXEL_GRID -DTRIANGLE_RECORDS RayTracedDiffuse.comp -o RayTracedDiffuseCompVoxRec.spv || exit /b 1
+%GLSLC% -DVOXEL_GRID -DCOMPACT_VOXELS -DTRIANGLE_RECORDS RayTracedDiffuse.comp -o RayTracedDiffuseCompVoxCompactRec.spv || exit /b 1
+%GLSLC% -DVOXEL_GRID -DLIGHT_VISIBILITY RayTracedDiffuse.comp -o RayTracedDiffuseCompVoxVis.spv || exit /b 1
+%GLSLC% -DVOXEL_GRID -DCOMPACT_VOXELS -DLIGHT_VISIBILITY RayTracedDiffuse.comp -o RayTracedDiffuseCompVoxCompactVis.spv || exit /b 1
+%GLSLC% -DVOXEL_GRID -DTRIANGLE_RECORDS -DLIGHT_VISIBILITY RayTracedDiffuse.comp -o RayTracedDiffuseCompVoxRecVis.spv || exit /b 1
+%GLSLC% -DVOXEL_GRID -DCOMPACT_VOXELS -DTRIANGLE_RECORDS -DLIGHT_VISIBILITY RayTracedDiffuse.comp -o RayTracedDiffuseCompVoxCompactRecVis.spv || exit /b 1
+%GLSLC% HybridDiffuse.frag -o HybridDiffuseFrag.spv || exit /b 1
+%GLSLC% -DCOMPACT_VOXELS HybridDiffuse.frag -o HybridDiffuseFragCompact.spv || exit /b 1
+%GLSLC% -DTRIANGLE_RECORDS HybridDiffuse.frag -o HybridDiffuseFragRec.spv || exit /b 1
+%GLSLC% -DCOMPACT_VOXELS -DTRIANGLE_RECORDS HybridDiffuse.frag -o HybridDiffuseFragCompactRec.spv || exit /b 1
+%GLSLC% -DLIGHT_VISIBILITY HybridDiffuse.frag -o HybridDiffuseFragVis.spv || exit /b 1
+%GLSLC% -DCOMPACT_VOXELS -DLIGHT_VISIBILITY HybridDiffuse.frag -o HybridDiffuseFragCompactVis.spv || exit /b 1
+%GLSLC% -DTRIANGLE_RECORDS -DLIGHT_VISIBILITY HybridDiffuse.frag -o HybridDiffuseFragRecVis.spv || exit /b 1
+%GLSLC% -DCOMPACT_VOXELS -DTRIANGLE_RECORDS -DLIGHT_VISIBILITY HybridDiffuse.frag -o HybridDiffuseFragCompactRecVis.spv || exit /b 1
+
+%GLSLC% -DCOUNT_PASS VoxelGridBuild.comp -o VoxelGridBuildCount.spv || exit /b 1
+%GLSLC% -DSCAN_BLOCKS_PASS VoxelGridBuild.comp -o VoxelGridBuildScanBlocks.spv || exit /b 1
+%GLSLC% -DSCAN_BLOCK_SUMS_PASS VoxelGridBuild.comp -o VoxelGridBuildScanBlockSums.spv || exit /b 1
+%GLSLC% -DADD_BLOCK_OFFSETS_PASS VoxelGridBuild.comp -o VoxelGridBuildAddBlockOffsets.spv || exit /b 1
+%GLSLC% -DFILL_PASS VoxelGridBuild.comp -o VoxelGridBuildFill.spv || exit /b 1
 
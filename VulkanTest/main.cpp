@@ -1,12 +1,26 @@
 #include "__Test__/Rendering/Renderer.h"
+#include "__Test__/Rendering/ComputeRenderer.h"
 #include "__Test__/Rendering/RasterizedMesh.h"
 #include "__Test__/Rendering/RayTracedMesh.h"
+#include "__Test__/Rendering/HybridMesh.h"
+#include "__Test__/Rendering/SoftwareRenderer.h"
+#include "__Test__/Objects/VoxelGridCache.h"
+#include "__Test__/Objects/VoxelGridBuilder.h"
+#include "__Test__/Objects/VoxelTraversal.h"
+#include "__Test__/Objects/RayTriangle.h"
+#include "__Test__/Objects/TrianglePackets.h"
+#include "__Test__/Objects/LightVisibility.h"
 #include "__Test__/Helpers.h"
 #include <chrono>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <map>
+#include <iterator>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
 
 namespace {
 	/**
@@ -18,17 +32,362 @@ namespace {
 		std::cout << "<LOG> " << text << std::endl;
 	}
 
+	/**
+	 Logs voxel grid build statistics.
+	 @param name Name of the grid.
+	 @param report Build report.
+	 */
+	static void logReport(const char* name, const Test::VoxelData::BuildReport& report) {
+		std::stringstream stream;
+		stream << name << " - resolution: " << report.numDivisions.x << "x" << report.numDivisions.y << "x" << report.numDivisions.z
+			<< "; sub-grids: " << report.numSubGrids << "; cells: " << report.numCells << "; empty cells: " << (report.emptyCellRatio * 100.0f) << "%"
+			<< "; references per cell: {mean:" << report.meanRefsPerCell << "; max:" << report.maxRefsPerCell << "}"
+			<< "; total references: " << report.totalRefs << "; build time: " << (report.buildTime * 1000.0f) << "ms";
+		log(stream.str().c_str());
+	}
+
+	/**
+	 Reads back a grid, built on GPU, and compares the content of each voxel with the CPU build of the same resolution
+	 (triangle order within a voxel is ignored, since the GPU build does not keep it; missing references get reported as errors,
+	 extra ones only get logged, since the GPU overlap test is slightly conservative).
+	 @param name Name of the grid.
+	 @param grid Compact layout grid, filled in by VoxelGridBuilder.
+	 @param reference CPU build with the same grid settings and no sub-grids.
+	 @return true, if the GPU build has every reference, the CPU build has.
+	 */
+	static bool logGPUBuildMismatches(const char* name, Test::VoxelGrid& grid, const Test::VoxelData& reference) {
+		if (grid.voxelRanges.size() != reference.voxelRanges.size() || reference.report.numSubGrids != 0) {
+			log("[Error] logGPUBuildMismatches - Grid and reference do not match in resolution.");
+			return false;
+		}
+		std::vector<Test::VoxelData::VoxelRange> ranges(grid.voxelRanges.size());
+		std::vector<uint32_t> refs(grid.triangleRefs.size());
+		grid.voxelRanges.getContent(ranges.data());
+		grid.triangleRefs.getContent(refs.data());
+		size_t numMismatchingCells = 0, numMissingRefs = 0, numExtraRefs = 0;
+		std::vector<uint32_t> cell, referenceCell, difference;
+		for (size_t i = 0; i < ranges.size(); i++) {
+			const Test::VoxelData::VoxelRange& range = ranges[i];
+			const Test::VoxelData::VoxelRange& referenceRange = reference.voxelRanges[i];
+			if (static_cast<size_t>(range.offset) + range.count > refs.size()) {
+				log("[Error] logGPUBuildMismatches - GPU voxel range is out of bounds.");
+				return false;
+			}
+			cell.assign(refs.begin() + range.offset, refs.begin() + range.offset + range.count);
+			referenceCell.assign(reference.triangleRefs.begin() + referenceRange.offset, reference.triangleRefs.begin() + referenceRange.offset + referenceRange.count);
+			std::sort(cell.begin(), cell.end());
+			if (cell == referenceCell) continue;
+			numMismatchingCells++;
+			difference.clear();
+			std::set_difference(referenceCell.begin(), referenceCell.end(), cell.begin(), cell.end(), std::back_inserter(difference));
+			numMissingRefs += difference.size();
+			difference.clear();
+			std::set_difference(cell.begin(), cell.end(), referenceCell.begin(), referenceCell.end(), std::back_inserter(difference));
+			numExtraRefs += difference.size();
+		}
+		std::stringstream stream;
+		if (numMissingRefs > 0) stream << "[Error] ";
+		stream << name << " - comparison with the CPU build: {mismatching cells:" << numMismatchingCells << "/" << ranges.size()
+			<< "; missing references:" << numMissingRefs << "; extra references:" << numExtraRefs << "}";
+		log(stream.str().c_str());
+		return (numMissingRefs == 0);
+	}
+
+	/**
+	 Logs average number of top-level cells, primary rays visit with and without empty space skipping,
+	 as well as the number of triangle tests with and without mailboxing (triangle hits are ignored, so every ray walks through the entire grid).
+	 @param name Name of the grid.
+	 @param data Voxel data.
+	 @param eye Camera position.
+	 @param viewProjection Camera View-Projection matrix.
+	 */
+	static void logTraversalStats(const char* name, const Test::VoxelData& data, const glm::vec3& eye, const glm::mat4& viewProjection) {
+		const uint32_t WIDTH = 128, HEIGHT = 72;
+		const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+		size_t numVisited = 0, numVisitedWithSkipping = 0;
+		size_t numTests = 0, numTestsWithMailbox = 0, numSavedTests = 0;
+		for (uint32_t y = 0; y < HEIGHT; y++)
+			for (uint32_t x = 0; x < WIDTH; x++) {
+				const glm::vec4 target = inverseViewProjection * glm::vec4(
+					(((x + 0.5f) / WIDTH) * 2.0f) - 1.0f, (((y + 0.5f) / HEIGHT) * 2.0f) - 1.0f, 1.0f, 1.0f);
+				const glm::vec3 direction = glm::normalize((glm::vec3(target) / target.w) - eye);
+				numVisited += data.countVisitedCells(eye, direction, false);
+				numVisitedWithSkipping += data.countVisitedCells(eye, direction, true);
+				numTests += data.countTriangleTests(eye, direction, 0);
+				uint32_t savedTests = 0;
+				numTestsWithMailbox += data.countTriangleTests(eye, direction, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, &savedTests);
+				numSavedTests += savedTests;
+			}
+		std::stringstream stream;
+		stream << name << " - cells visited per ray: {without skipping:" << (static_cast<float>(numVisited) / (WIDTH * HEIGHT))
+			<< "; with skipping:" << (static_cast<float>(numVisitedWithSkipping) / (WIDTH * HEIGHT)) << "}";
+		log(stream.str().c_str());
+		stream.str("");
+		stream << name << " - triangle tests per ray: {without mailbox:" << (static_cast<float>(numTests) / (WIDTH * HEIGHT))
+			<< "; with mailbox:" << (static_cast<float>(numTestsWithMailbox) / (WIDTH * HEIGHT))
+			<< "; saved:" << (static_cast<float>(numSavedTests) / (WIDTH * HEIGHT)) << "}";
+		log(stream.str().c_str());
+	}
+
+	/**
+	 Logs time per primary ray and the number of rays that disagree with the brute force ground truth, for both voxel grid cell walks (CPU reference of the shaders).
+	 @param name Name of the grid.
+	 @param data Voxel data.
+	 @param verts Mesh vertices.
+	 @param indexBuffer Mesh indices.
+	 @param eye Camera position.
+	 @param viewProjection Camera View-Projection matrix.
+	 */
+	static void logTraversalAccuracy(const char* name, const Test::VoxelData& data, const std::vector<Test::PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		const glm::vec3& eye, const glm::mat4& viewProjection) {
+		const uint32_t WIDTH = 128, HEIGHT = 72;
+		const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+		const Test::VoxelTraversal traversal(data, verts, indexBuffer);
+		std::vector<glm::vec3> directions;
+		std::vector<bool> hits;
+		std::vector<Test::VoxelTraversal::Hit> groundTruth;
+		for (uint32_t y = 0; y < HEIGHT; y++)
+			for (uint32_t x = 0; x < WIDTH; x++) {
+				const glm::vec4 target = inverseViewProjection * glm::vec4(
+					(((x + 0.5f) / WIDTH) * 2.0f) - 1.0f, (((y + 0.5f) / HEIGHT) * 2.0f) - 1.0f, 1.0f, 1.0f);
+				directions.push_back(glm::normalize((glm::vec3(target) / target.w) - eye));
+				Test::VoxelTraversal::Hit hit = {};
+				hits.push_back(traversal.raycastBruteForce(eye, directions.back(), hit));
+				groundTruth.push_back(hit);
+			}
+		const Test::VoxelTraversal::Mode MODES[] = { Test::VoxelTraversal::MODE_CELL_STEPPING, Test::VoxelTraversal::MODE_INTEGER_DDA };
+		const char* MODE_NAMES[] = { "cell stepping", "integer DDA" };
+		for (size_t mode = 0; mode < 2; mode++) {
+			size_t numMismatches = 0;
+			const std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+			for (size_t i = 0; i < directions.size(); i++) {
+				Test::VoxelTraversal::Hit hit = {};
+				const bool wasHit = traversal.raycast(eye, directions[i], MODES[mode], hit);
+				if (wasHit != hits[i] || (wasHit && std::abs(hit.distance - groundTruth[i].distance) > 0.0001f)) numMismatches++;
+			}
+			const std::chrono::duration<float> time = (std::chrono::system_clock::now() - start);
+			std::stringstream stream;
+			stream << name << " - " << MODE_NAMES[mode] << " (CPU reference): {time per ray:" << (time.count() * 1000000.0f / directions.size())
+				<< "us; mismatches with brute force:" << numMismatches << "/" << directions.size() << "}";
+			log(stream.str().c_str());
+		}
+	}
+
+	/**
+	 Logs time per shadow ray with closest hit queries and with occlusion queries, for both voxel grid cell walks (CPU reference of the shaders),
+	 as well as the number of occlusion results that disagree with the brute force ground truth.
+	 Shadow rays go from the light to the surface points, primary rays hit, the same way shade() casts them.
+	 @param name Name of the grid.
+	 @param data Voxel data.
+	 @param verts Mesh vertices.
+	 @param indexBuffer Mesh indices.
+	 @param eye Camera position.
+	 @param viewProjection Camera View-Projection matrix.
+	 @param lightPosition Point light position.
+	 */
+	static void logShadowRayStats(const char* name, const Test::VoxelData& data, const std::vector<Test::PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		const glm::vec3& eye, const glm::mat4& viewProjection, const glm::vec3& lightPosition) {
+		const uint32_t WIDTH = 128, HEIGHT = 72;
+		const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+		const Test::VoxelTraversal traversal(data, verts, indexBuffer);
+		std::vector<glm::vec3> directions;
+		std::vector<float> maxDistances;
+		std::vector<bool> groundTruth;
+		for (uint32_t y = 0; y < HEIGHT; y++)
+			for (uint32_t x = 0; x < WIDTH; x++) {
+				const glm::vec4 target = inverseViewProjection * glm::vec4(
+					(((x + 0.5f) / WIDTH) * 2.0f) - 1.0f, (((y + 0.5f) / HEIGHT) * 2.0f) - 1.0f, 1.0f, 1.0f);
+				Test::VoxelTraversal::Hit hit = {};
+				if (!traversal.raycastBruteForce(eye, glm::normalize((glm::vec3(target) / target.w) - eye), hit)) continue;
+				const glm::vec3 delta = (hit.point - lightPosition);
+				const float sqrDistance = glm::dot(delta, delta);
+				directions.push_back(delta / std::sqrt(sqrDistance));
+				maxDistances.push_back(std::sqrt(std::max(sqrDistance - Test::RayTracedMesh::DEFAULT_KERNEL_OPTIONS.shadowBias, 0.0f)));
+				Test::VoxelTraversal::Hit blocker = {};
+				groundTruth.push_back(traversal.raycastBruteForce(lightPosition, directions.back(), blocker) && blocker.distance < maxDistances.back());
+			}
+		if (directions.empty()) return;
+		const Test::VoxelTraversal::Mode MODES[] = { Test::VoxelTraversal::MODE_CELL_STEPPING, Test::VoxelTraversal::MODE_INTEGER_DDA };
+		const char* MODE_NAMES[] = { "cell stepping", "integer DDA" };
+		for (size_t mode = 0; mode < 2; mode++) {
+			size_t numClosestHitShadows = 0;
+			std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+			for (size_t i = 0; i < directions.size(); i++) {
+				Test::VoxelTraversal::Hit hit = {};
+				if (traversal.raycast(lightPosition, directions[i], MODES[mode], hit) && hit.distance < maxDistances[i]) numClosestHitShadows++;
+			}
+			const std::chrono::duration<float> closestHitTime = (std::chrono::system_clock::now() - start);
+			size_t numShadows = 0, numMismatches = 0;
+			start = std::chrono::system_clock::now();
+			for (size_t i = 0; i < directions.size(); i++) {
+				const bool shadow = traversal.occluded(lightPosition, directions[i], MODES[mode], 0.0f, maxDistances[i]);
+				if (shadow) numShadows++;
+				if (shadow != groundTruth[i]) numMismatches++;
+			}
+			const std::chrono::duration<float> occlusionTime = (std::chrono::system_clock::now() - start);
+			std::stringstream stream;
+			stream << name << " - " << MODE_NAMES[mode] << " shadow rays (CPU reference): {time per ray with closest hit:" << (closestHitTime.count() * 1000000.0f / directions.size())
+				<< "us; with occlusion query:" << (occlusionTime.count() * 1000000.0f / directions.size()) << "us; shadowed:" << numShadows << "/" << directions.size()
+				<< " (closest hit: " << numClosestHitShadows << "); mismatches with brute force:" << numMismatches << "}";
+			log(stream.str().c_str());
+		}
+	}
+
+	/**
+	 Logs light visibility build statistics.
+	 @param name Name of the light visibility data.
+	 @param report Build report.
+	 */
+	static void logReport(const char* name, const Test::LightVisibility::BuildReport& report) {
+		std::stringstream stream;
+		stream << name << " - classified cells: " << report.numClassifiedCells << "; fully lit: " << report.numLitCells
+			<< "; listed: " << report.numListedCells << "; traced: " << report.numTracedCells << "; occluders per listed cell: " << report.meanOccluders
+			<< "; total references: " << report.totalRefs << "; build time: " << (report.buildTime * 1000.0f) << "ms";
+		log(stream.str().c_str());
+	}
+
+	/**
+	 Logs the fraction of shadow rays, cached occluders resolve without the grid walk, as well as the number of cached results that disagree with the brute force ground truth
+	 (shadow rays go from the light to the surface points, primary rays hit, just like in logShadowRayStats).
+	 @param name Name of the light visibility data.
+	 @param data Light visibility data.
+	 @param verts Mesh vertices.
+	 @param indexBuffer Mesh indices.
+	 @param eye Camera position.
+	 @param viewProjection Camera View-Projection matrix.
+	 @param voxelData Voxel data for the brute force ground truth.
+	 */
+	static void logLightVisibilityStats(const char* name, const Test::LightVisibility::VisibilityData& data, const std::vector<Test::PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		const glm::vec3& eye, const glm::mat4& viewProjection, const Test::VoxelData& voxelData) {
+		const uint32_t WIDTH = 128, HEIGHT = 72;
+		const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+		const Test::VoxelTraversal traversal(voxelData, verts, indexBuffer);
+		const glm::vec3& lightPosition = data.settings.lightPosition;
+		size_t numRays = 0, numKnown = 0, numMismatches = 0;
+		for (uint32_t y = 0; y < HEIGHT; y++)
+			for (uint32_t x = 0; x < WIDTH; x++) {
+				const glm::vec4 target = inverseViewProjection * glm::vec4(
+					(((x + 0.5f) / WIDTH) * 2.0f) - 1.0f, (((y + 0.5f) / HEIGHT) * 2.0f) - 1.0f, 1.0f, 1.0f);
+				Test::VoxelTraversal::Hit hit = {};
+				if (!traversal.raycastBruteForce(eye, glm::normalize((glm::vec3(target) / target.w) - eye), hit)) continue;
+				const glm::vec3 delta = (hit.point - lightPosition);
+				const float sqrDistance = glm::dot(delta, delta);
+				const float maxDistance = std::sqrt(std::max(sqrDistance - Test::RayTracedMesh::DEFAULT_KERNEL_OPTIONS.shadowBias, 0.0f));
+				bool known;
+				const bool shadow = data.occluded(verts, indexBuffer, hit.point, maxDistance, known);
+				numRays++;
+				if (!known) continue;
+				numKnown++;
+				Test::VoxelTraversal::Hit blocker = {};
+				if (shadow != (traversal.raycastBruteForce(lightPosition, delta / std::sqrt(sqrDistance), blocker) && blocker.distance < maxDistance)) numMismatches++;
+			}
+		std::stringstream stream;
+		stream << name << " - shadow rays resolved from the cache: " << numKnown << "/" << numRays << "; mismatches with brute force: " << numMismatches;
+		log(stream.str().c_str());
+	}
+
+	/**
+	 Logs ray/triangle kernel micro-benchmark results (CPU mirror of the shader kernel against the legacy one).
+	 @param numTests Number of ray/triangle tests to time each kernel on.
+	 */
+	static void logTriangleKernelBenchmark(size_t numTests) {
+		const Test::RayTriangle::BenchmarkReport report = Test::RayTriangle::benchmark(numTests);
+		std::stringstream stream;
+		stream << "Ray/triangle kernel - time per test: {watertight:" << report.watertightTime << "ns; legacy:" << report.legacyTime << "ns}"
+			<< "; shared edge/vertex misses: {watertight:" << report.watertightEdgeMisses << "/" << report.numEdgeRays
+			<< "; legacy:" << report.legacyEdgeMisses << "/" << report.numEdgeRays << "; watertight distance errors:" << report.watertightDistanceErrors << "}"
+			<< "; back face/parallel false hits: {watertight:" << report.watertightFalseHits << "/" << report.numInvalidRays
+			<< "; legacy:" << report.legacyFalseHits << "/" << report.numInvalidRays << "}";
+		log(stream.str().c_str());
+	}
+
+	/**
+	 Logs throughput of the eight-wide ray/triangle kernels against the scalar one (closest hit of the primary rays against every single triangle).
+	 @param name Name of the scene.
+	 @param verts Mesh vertices.
+	 @param indexBuffer Mesh indices.
+	 @param eye Camera position.
+	 @param viewProjection Camera View-Projection matrix.
+	 */
+	static void logTrianglePacketBenchmark(const char* name, const std::vector<Test::PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		const glm::vec3& eye, const glm::mat4& viewProjection) {
+		// (No acceleration structure, so the resolution is way lower than the one of logTraversalStats)
+		const uint32_t WIDTH = 32, HEIGHT = 18;
+		const glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+		std::vector<glm::vec3> origins, directions;
+		for (uint32_t y = 0; y < HEIGHT; y++)
+			for (uint32_t x = 0; x < WIDTH; x++) {
+				const glm::vec4 target = inverseViewProjection * glm::vec4(
+					(((x + 0.5f) / WIDTH) * 2.0f) - 1.0f, (((y + 0.5f) / HEIGHT) * 2.0f) - 1.0f, 1.0f, 1.0f);
+				origins.push_back(eye);
+				directions.push_back(glm::normalize((glm::vec3(target) / target.w) - eye));
+			}
+		const Test::TrianglePackets packets(verts, indexBuffer);
+		const Test::TrianglePackets::BenchmarkReport report = packets.benchmark(origins, directions);
+		std::stringstream stream;
+		stream << name << " - triangle packets: {rays:" << report.numRays << "; triangles:" << report.numTriangles
+			<< "; instruction set:" << ((report.instructionSet == Test::TrianglePackets::INSTRUCTION_SET_AVX2) ? "AVX2" : "scalar") << "}"
+			<< "; Mrays/s: {scalar:" << report.scalarRate
+			<< "; 1 ray x 8 triangles:" << report.blockFallbackRate << "(fallback)/" << report.blockAVX2Rate << "(AVX2)"
+			<< "; 8 rays x 1 triangle:" << report.packetFallbackRate << "(fallback)/" << report.packetAVX2Rate << "(AVX2)}"
+			<< "; mismatches with the scalar kernel: " << report.mismatches;
+		log(stream.str().c_str());
+	}
+
+	/**
+	 Renders the initial camera view on CPU (same image as the voxel grid ray tracer draws) and logs the render statistics.
+	 @param name Name of the render.
+	 @param data Voxel data.
+	 @param verts Mesh vertices.
+	 @param indexBuffer Mesh indices.
+	 @param light Scene light.
+	 @param width Image width.
+	 @param height Image height.
+	 @param numThreads Number of worker threads.
+	 @param filename File to dump the image to (nullptr, if the image is not needed).
+	 @return false, if the image could not be written.
+	 */
+	static bool renderOnCPU(const char* name, const Test::VoxelData& data, const std::vector<Test::PNCVertex>& verts, const std::vector<uint32_t>& indexBuffer,
+		const Test::PointLight& light, uint32_t width, uint32_t height, uint32_t numThreads, const char* filename) {
+		Test::VPTransform transform;
+		transform.view = glm::lookAt(glm::vec3(0.0f, -4.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		transform.projection = glm::perspective(glm::radians(60.0f), width / (float)height, 0.1f, 100.0f);
+		transform.projection[1][1] *= -1;
+		Test::SoftwareRenderer renderer(data, verts, indexBuffer, width, height, Test::RayTracedMesh::DEFAULT_KERNEL_OPTIONS.shadowBias, numThreads);
+		const Test::SoftwareRenderer::RenderReport& report = renderer.render(transform, light);
+		std::stringstream stream;
+		stream << name << " - resolution: " << width << "x" << height << "; tiles: " << report.numTiles << "; threads: " << report.numThreads
+			<< "; rays: " << report.numRays << "; primary hits: " << report.numHits
+			<< "; render time: " << (report.renderTime * 1000.0f) << "ms; " << report.megaRaysPerSecond << " Mrays/s";
+		log(stream.str().c_str());
+		if (filename == nullptr) return true;
+		else if (!renderer.writePPM(filename)) {
+			stream.str("");
+			stream << "[Error] main - Failed to write " << filename;
+			log(stream.str().c_str());
+			return false;
+		}
+		stream.str("");
+		stream << name << " - image written to " << filename;
+		log(stream.str().c_str());
+		return true;
+	}
+
 	/**
 	 * Render loop catches render loop events from the window and invokes necessary calls to render images.
 	 */
 	class RenderLoop {
 	private:
 		const std::shared_ptr<Test::SwapChain> m_swapChain;
-		const std::vector<std::shared_ptr<Test::Renderer> > m_renderers;
+		const std::vector<std::shared_ptr<Test::IFrameRenderer> > m_renderers;
 		const std::shared_ptr<Test::VPTransform> m_projection;
 		std::chrono::system_clock::time_point m_startDate;
 		std::chrono::system_clock::time_point m_lastUpdateDate;
 		float m_smoothFPS;
+		float m_frameTimeSum;
+		float m_renderScaleSum;
+		float m_tracedFractionSum;
+		uint32_t m_frameCount;
 		uint32_t rendererId;
 
 	public:
@@ -41,7 +400,7 @@ namespace {
 		template<typename... Renderers>
 		RenderLoop(const std::shared_ptr<Test::SwapChain>& swapChain, const std::shared_ptr<Test::VPTransform>& transform, Renderers... renderers)
 			: m_swapChain(swapChain), m_renderers({ renderers... }), m_projection(transform)
-			, m_startDate(std::chrono::system_clock::now()), m_lastUpdateDate(m_startDate), m_smoothFPS(0.0f), rendererId(0) { }
+			, m_startDate(std::chrono::system_clock::now()), m_lastUpdateDate(m_startDate), m_smoothFPS(0.0f), m_frameTimeSum(0.0f), m_renderScaleSum(0.0f), m_tracedFractionSum(0.0f), m_frameCount(0), rendererId(0) { }
 
 
 		/**
@@ -60,6 +419,12 @@ namespace {
 				std::chrono::duration<float> diff = now - m_lastUpdateDate;
 				m_lastUpdateDate = now;
 				float framerate = 1.0f / diff.count();
+				m_frameTimeSum += diff.count();
+				if (m_renderers.size() > 0) {
+					m_renderScaleSum += m_renderers[rendererId]->renderScale();
+					m_tracedFractionSum += m_renderers[rendererId]->tracedFraction();
+				}
+				m_frameCount++;
 				// When we have single digit framerate, somtimes we have a randomness in iteration time, that will show unrealistically high values,
 				// so we are biased towards lower...
 				float lerpFactor = std::min(diff.count() * 5.0f, (m_smoothFPS < framerate) ? 0.125f : 1.0f);
@@ -85,27 +450,46 @@ namespace {
 
 			// Switching the renderer if space was pressed (RT mode is slow enough for the system to be less responsive than desirable, 
 			// so you may need to hold it for for a few seconds to switch back to rasterized mode):
-			if (window->spaceTapped())
+			// (Average frame time, render scale and traced pixel fraction of the renderer we are switching from get logged, so that the modes can be compared)
+			if (window->spaceTapped()) {
+				std::stringstream stream;
+				stream << "Renderer " << rendererId << " - average frame time: " << (m_frameTimeSum * 1000.0f / std::max(m_frameCount, 1u)) << "ms over " << m_frameCount << " frames"
+					<< "; average render scale: " << (m_renderScaleSum / std::max(m_frameCount, 1u))
+					<< "; average traced fraction: " << (m_tracedFractionSum / std::max(m_frameCount, 1u));
+				log(stream.str().c_str());
+				m_frameTimeSum = 0.0f;
+				m_renderScaleSum = 0.0f;
+				m_tracedFractionSum = 0.0f;
+				m_frameCount = 0;
 				rendererId = (rendererId + 1) % static_cast<uint32_t>(m_renderers.size());
+			}
 		}
 	};
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
 	/* Note: Used shared pointers all over the place to avoid to have to care about the destruction order... */
 
-	// Window to draw on (non-resizable; resize support is not currently implemented):
-	std::shared_ptr<Test::Window> window(new Test::Window("Window", 1280, 720, true, true));
-	if (window->closed()) return 1;
-
-	// Graphics device for managing physical and logical device instances:
-	std::shared_ptr<Test::GraphicsDevice> device(new Test::GraphicsDevice(window, log));
-	if (!device->initialized()) return 2;
-
-	// Swap chain, responsible for managing frame buffers:
-	std::shared_ptr<Test::SwapChain> swapChain(new Test::SwapChain(device, log));
-	if (!swapChain->initialized()) return 3;
+	// Optional arguments are the number of cells per triangle, automatically sized voxel grids aim for, and "--stats" to log the CPU diagnostics on startup
+	// (those rebuild the voxel grid, trace a few hundred thousand rays and render a frame on CPU, so they are off by default; see Benchmark.cpp for the timings):
+	float cellsPerTriangle = Test::VoxelData::DEFAULT_CELLS_PER_TRIANGLE;
+	bool logStats = false;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--stats") == 0) {
+			logStats = true;
+			continue;
+		}
+		char* end = nullptr;
+		const float value = std::strtof(argv[i], &end);
+		if (end == argv[i] || *end != '\0' || !(value > 0.0f) || std::isinf(value)) {
+			std::stringstream stream;
+			stream << "[Error] main - Invalid argument '" << argv[i] << "' (usage: " << argv[0] << " [cellsPerTriangle > 0] [--stats])";
+			log(stream.str().c_str());
+			return 33;
+		}
+		cellsPerTriangle = value;
+	}
 
 	// Defining scene geometry by reading geometry from the file and appending the plane to it:
 	std::vector<Test::PNCVertex> vertices; 
@@ -129,32 +513,154 @@ int main() {
 		for (size_t i = 0; i < PLANE_INDICES.size(); i++)
 			indices.push_back(PLANE_INDICES[i] + baseIndex);
 	}
+	const uint32_t numThreads = std::thread::hardware_concurrency();
+	typedef Test::VoxelData VoxelData;
+	// Scene light:
+	std::shared_ptr<Test::PointLight> light(new Test::PointLight{ {-4.0f, 0.0f, 4.0f}, {10.0f, 15.0f, 10.0f}, {0.1f, 0.05f, 0.075f} });
+
+	// Without a window or a graphics device, we can still render the initial frame on CPU and dump it to a file:
+	const auto renderWithoutGPU = [&]() {
+		log("main - Graphics device unavailable; rendering on CPU instead...");
+		const VoxelData data(vertices, indices, glm::uvec3{ 32, 32, 32 }, numThreads);
+		return renderOnCPU("Software renderer", data, vertices, indices, *light, 1280, 720, numThreads, "software-render.ppm");
+	};
+
+	// Window to draw on (non-resizable; resize support is not currently implemented):
+	std::shared_ptr<Test::Window> window(new Test::Window("Window", 1280, 720, true, true));
+	if (window->closed()) return renderWithoutGPU() ? 0 : 1;
+
+	// Graphics device for managing physical and logical device instances:
+	std::shared_ptr<Test::GraphicsDevice> device(new Test::GraphicsDevice(window, log));
+	if (!device->initialized()) return renderWithoutGPU() ? 0 : 2;
+
+	// Swap chain, responsible for managing frame buffers:
+	std::shared_ptr<Test::SwapChain> swapChain(new Test::SwapChain(device, log));
+	if (!swapChain->initialized()) return 3;
 
 	// Mesh for holding the scene geometry on the graphics processor memory:
 	std::shared_ptr<Test::Mesh> mesh(new Test::Mesh(device, vertices, indices, log));
-	std::shared_ptr<Test::VoxelGrid> voxelGrid(new Test::VoxelGrid(device, vertices, indices, glm::uvec3{ 32, 32, 32 }, log));
-	if (!(mesh->initialized() && voxelGrid->initialized())) return 4;
+	// Voxel grids are cached on disk and only get rebuilt when the geometry or the settings change:
+	std::shared_ptr<Test::VoxelGrid> voxelGrid = Test::VoxelGridCache::loadOrBuild(device, "__InputGeometry__/unit-sphere.grid.cache",
+		vertices, indices, glm::uvec3{ 32, 32, 32 }, numThreads, VoxelData::LAYOUT_LINKED_LIST, 0, glm::uvec3{ 4, 4, 4 }, VoxelData::OVERLAP_CLIPPING, log);
+	std::shared_ptr<Test::VoxelGrid> compactVoxelGrid = Test::VoxelGridCache::loadOrBuild(device, "__InputGeometry__/unit-sphere.compact-grid.cache",
+		vertices, indices, VoxelData::autoDivisions(vertices, indices, cellsPerTriangle), numThreads, VoxelData::LAYOUT_COMPACT, 0, glm::uvec3{ 4, 4, 4 }, VoxelData::OVERLAP_CLIPPING, log);
+	std::shared_ptr<Test::VoxelGrid> twoLevelVoxelGrid = Test::VoxelGridCache::loadOrBuild(device, "__InputGeometry__/unit-sphere.two-level-grid.cache",
+		vertices, indices, glm::uvec3{ 16, 16, 16 }, numThreads, VoxelData::LAYOUT_COMPACT, 16, glm::uvec3{ 4, 4, 4 }, VoxelData::OVERLAP_CLIPPING, log);
+	std::shared_ptr<Test::BVH> bvh(new Test::BVH(device, vertices, indices, 4, log));
+	// Precomputed triangle intersection records (shared by all the ray tracers):
+	std::shared_ptr<Test::TriangleRecords> triangleRecords(new Test::TriangleRecords(device, vertices, indices, log));
+	if (!(mesh->initialized() && voxelGrid->initialized() && compactVoxelGrid->initialized() && twoLevelVoxelGrid->initialized() && bvh->initialized() && triangleRecords->initialized())) return 4;
+	logReport("Voxel grid", voxelGrid->report);
+	logReport("Compact voxel grid (automatic resolution)", compactVoxelGrid->report);
+	logReport("Two-level voxel grid", twoLevelVoxelGrid->report);
+	// Cached shadow ray occluders (the light does not move, so this only has to be rebuilt if the light or the geometry change; see LightVisibility::upToDate()):
+	const Test::LightVisibility::VisibilityData lightVisibilityData(vertices, indices, VoxelData::computeSettings(vertices, indices, glm::uvec3{ 32, 32, 32 }),
+		light->position, Test::LightVisibility::VisibilityData::DEFAULT_MAX_OCCLUDERS, numThreads);
+	std::shared_ptr<Test::LightVisibility> lightVisibility(new Test::LightVisibility(device, lightVisibilityData, log));
+	if (!lightVisibility->initialized()) return 28;
+	logReport("Light visibility", lightVisibility->report);
+
+	// Empty space skipping, mailboxing, cell walk and shadow ray statistics from the initial camera position (cached grids do not keep CPU data around, so the default one gets rebuilt for this;
+	// only with "--stats", since it defeats the point of the grid cache):
+	if (logStats) {
+		const glm::vec3 eye(0.0f, -4.0f, 2.0f);
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+		projection[1][1] *= -1;
+		const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		const VoxelData data(vertices, indices, glm::uvec3{ 32, 32, 32 }, numThreads);
+		logTraversalStats("Voxel grid", data, eye, projection * view);
+		logTraversalAccuracy("Voxel grid", data, vertices, indices, eye, projection * view);
+		logShadowRayStats("Voxel grid", data, vertices, indices, eye, projection * view, light->position);
+		logLightVisibilityStats("Light visibility", lightVisibilityData, vertices, indices, eye, projection * view, data);
+		// (CPU reference for the ray traced frame times, RenderLoop logs)
+		renderOnCPU("Software renderer", data, vertices, indices, *light, 1280, 720, numThreads, nullptr);
+		logTrianglePacketBenchmark("Scene", vertices, indices, eye, projection * view);
+		logTriangleKernelBenchmark(1 << 20);
+	}
+
+	// Voxel grid, built on GPU straight from the mesh buffers (same resolution as the linked list one, so its reference count tells us how much space we need):
+	std::shared_ptr<Test::VoxelGrid> gpuVoxelGrid(new Test::VoxelGrid(device, VoxelData::computeSettings(vertices, indices, glm::uvec3{ 32, 32, 32 }),
+		static_cast<uint32_t>(voxelGrid->report.totalRefs + (voxelGrid->report.totalRefs / 8) + 1), log));
+	if (!gpuVoxelGrid->initialized()) return 17;
+	std::shared_ptr<Test::VoxelGridBuilder> gpuVoxelGridBuilder(new Test::VoxelGridBuilder(mesh, gpuVoxelGrid, log));
+	if (!gpuVoxelGridBuilder->initialized()) return 18;
+	{
+		const std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+		const bool built = gpuVoxelGridBuilder->build();
+		const std::chrono::duration<float> buildTime = (std::chrono::system_clock::now() - start);
+		std::stringstream stream;
+		stream << "GPU voxel grid - total references: " << gpuVoxelGridBuilder->numReferences() << "; capacity: " << gpuVoxelGrid->triangleRefs.size()
+			<< "; build time: " << (buildTime.count() * 1000.0f) << "ms";
+		log(stream.str().c_str());
+		if (!built) log("[Error] main - GPU voxel grid does not fit in the triangle reference buffer.");
+		// One-time check of the GPU build against the CPU one (same settings, so the cells line up):
+		else logGPUBuildMismatches("GPU voxel grid", *gpuVoxelGrid, VoxelData(vertices, indices, glm::uvec3{ 32, 32, 32 }, numThreads, VoxelData::LAYOUT_COMPACT));
+	}
 
 	// View-Projection transform that acts as our camera:
 	std::shared_ptr<Test::VPTransform> transform(new Test::VPTransform());
-	std::shared_ptr<Test::PointLight> light(new Test::PointLight{ {-4.0f, 0.0f, 4.0f}, {10.0f, 15.0f, 10.0f}, {0.1f, 0.05f, 0.075f} });
 
 	// Target Object for rasterized mode ("Object" being an abstraction for a renderable item, alongside all the information about camera and lighting):
 	std::shared_ptr<Test::IRenderObject> rasterizedMesh(new Test::RasterizedMesh(mesh, transform, light, log));
 	if (!rasterizedMesh->initialized()) return 5;
 
+	// Target Object for hybrid mode (rasterized visibility, ray-traced shadows):
+	std::shared_ptr<Test::IRenderObject> hybridMesh(new Test::HybridMesh(mesh, transform, light, voxelGrid, triangleRecords, lightVisibility, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
+	if (!hybridMesh->initialized()) return 26;
+
 	// Target Object for ray-traced mode:
-	std::shared_ptr<Test::IRenderObject> rayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, nullptr, log));
+	std::shared_ptr<Test::IRenderObject> rayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, std::shared_ptr<Test::VoxelGrid>(), triangleRecords, nullptr, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
 	if (!rayTracedMesh->initialized()) return 6;
 
 	// Target Object for voxelized ray-traced mode:
-	std::shared_ptr<Test::IRenderObject> voxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, voxelGrid, log));
+	std::shared_ptr<Test::IRenderObject> voxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, voxelGrid, triangleRecords, nullptr, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
 	if (!rayTracedMesh->initialized()) return 7;
 
+	// Target Object for voxelized ray-traced mode with cached shadow ray occluders:
+	std::shared_ptr<Test::IRenderObject> cachedShadowVoxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, voxelGrid, triangleRecords, lightVisibility, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
+	if (!cachedShadowVoxelizedRayTracedMesh->initialized()) return 29;
+
+	// Target Object for voxelized ray-traced mode with the voxel grid displayed (same SPIR-V, different specialization constants):
+	std::shared_ptr<Test::RayTracedMesh> debugVoxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, voxelGrid, triangleRecords, nullptr, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
+	if (!debugVoxelizedRayTracedMesh->initialized()) return 31;
+	{
+		Test::RayTracedMesh::KernelOptions options = Test::RayTracedMesh::DEFAULT_KERNEL_OPTIONS;
+		options.debugView = true;
+		debugVoxelizedRayTracedMesh->setKernelOptions(options);
+	}
+
+	// Target Object for voxelized ray-traced mode with integer DDA cell walk:
+	std::shared_ptr<Test::IRenderObject> ddaVoxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, voxelGrid, triangleRecords, nullptr, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_INTEGER_DDA, log));
+	if (!ddaVoxelizedRayTracedMesh->initialized()) return 21;
+
+	// Target Object for voxelized ray-traced mode with compact voxel layout (and automatic resolution):
+	std::shared_ptr<Test::IRenderObject> compactVoxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, compactVoxelGrid, triangleRecords, nullptr, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
+	if (!compactVoxelizedRayTracedMesh->initialized()) return 11;
+
+	// Target Object for BVH ray-traced mode:
+	std::shared_ptr<Test::IRenderObject> bvhRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, bvh, triangleRecords, log));
+	if (!bvhRayTracedMesh->initialized()) return 13;
+
+	// Target Object for voxelized ray-traced mode with two-level voxel grid:
+	std::shared_ptr<Test::IRenderObject> twoLevelVoxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, twoLevelVoxelGrid, triangleRecords, nullptr, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
+	if (!twoLevelVoxelizedRayTracedMesh->initialized()) return 15;
+
+	// Target Object for voxelized ray-traced mode with GPU-built voxel grid:
+	std::shared_ptr<Test::IRenderObject> gpuVoxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, gpuVoxelGrid, triangleRecords, nullptr, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
+	if (!gpuVoxelizedRayTracedMesh->initialized()) return 19;
+
+	// Target Object for voxelized ray-traced mode, traced from a compute shader:
+	std::shared_ptr<Test::RayTracedMesh> computeVoxelizedRayTracedMesh(new Test::RayTracedMesh(mesh, transform, light, voxelGrid, triangleRecords, nullptr, Test::RayTracedMesh::DEFAULT_MAILBOX_SIZE, Test::VoxelTraversal::MODE_CELL_STEPPING, log));
+	if (!computeVoxelizedRayTracedMesh->initialized()) return 23;
+
 	// Renderer for rasterized mode:
 	std::shared_ptr<Test::Renderer> rasterized(new Test::Renderer(device, swapChain, rasterizedMesh, log));
 	if (!rasterized->initialized()) return 8;
 
+	// Renderer for hybrid mode:
+	std::shared_ptr<Test::Renderer> hybrid(new Test::Renderer(device, swapChain, hybridMesh, log));
+	if (!hybrid->initialized()) return 27;
+
 	// Renderer for ray-traced mode:
 	std::shared_ptr<Test::Renderer> rayTraced(new Test::Renderer(device, swapChain, rayTracedMesh, log));
 	if (!rayTraced->initialized()) return 9;
@@ -163,8 +669,50 @@ int main() {
 	std::shared_ptr<Test::Renderer> voxelizedRayTraced(new Test::Renderer(device, swapChain, voxelizedRayTracedMesh, log));
 	if (!voxelizedRayTraced->initialized()) return 10;
 
+	// Renderer for voxelized ray-traced mode with cached shadow ray occluders:
+	std::shared_ptr<Test::Renderer> cachedShadowVoxelizedRayTraced(new Test::Renderer(device, swapChain, cachedShadowVoxelizedRayTracedMesh, log));
+	if (!cachedShadowVoxelizedRayTraced->initialized()) return 30;
+
+	// Renderer for voxelized ray-traced mode with the voxel grid displayed:
+	std::shared_ptr<Test::Renderer> debugVoxelizedRayTraced(new Test::Renderer(device, swapChain, debugVoxelizedRayTracedMesh, log));
+	if (!debugVoxelizedRayTraced->initialized()) return 32;
+
+	// Renderer for voxelized ray-traced mode with integer DDA cell walk:
+	std::shared_ptr<Test::Renderer> ddaVoxelizedRayTraced(new Test::Renderer(device, swapChain, ddaVoxelizedRayTracedMesh, log));
+	if (!ddaVoxelizedRayTraced->initialized()) return 22;
+
+	// Renderer for voxelized ray-traced mode with compact voxel layout:
+	std::shared_ptr<Test::Renderer> compactVoxelizedRayTraced(new Test::Renderer(device, swapChain, compactVoxelizedRayTracedMesh, log));
+	if (!compactVoxelizedRayTraced->initialized()) return 12;
+
+	// Renderer for BVH ray-traced mode:
+	std::shared_ptr<Test::Renderer> bvhRayTraced(new Test::Renderer(device, swapChain, bvhRayTracedMesh, log));
+	if (!bvhRayTraced->initialized()) return 14;
+
+	// Renderer for voxelized ray-traced mode with two-level voxel grid:
+	std::shared_ptr<Test::Renderer> twoLevelVoxelizedRayTraced(new Test::Renderer(device, swapChain, twoLevelVoxelizedRayTracedMesh, log));
+	if (!twoLevelVoxelizedRayTraced->initialized()) return 16;
+
+	// Renderer for voxelized ray-traced mode with GPU-built voxel grid:
+	std::shared_ptr<Test::Renderer> gpuVoxelizedRayTraced(new Test::Renderer(device, swapChain, gpuVoxelizedRayTracedMesh, log));
+	if (!gpuVoxelizedRayTraced->initialized()) return 20;
+
+	// Renderer for voxelized ray-traced mode, traced from a compute shader and blitted to the swap chain:
+	std::shared_ptr<Test::ComputeRenderer> computeVoxelizedRayTraced(new Test::ComputeRenderer(device, swapChain, computeVoxelizedRayTracedMesh, log));
+	if (!computeVoxelizedRayTraced->initialized()) return 24;
+	// (Resolution drops, whenever tracing takes longer than 60 FPS allows)
+	computeVoxelizedRayTraced->setDynamicResolution({ 1000.0f / 60.0f, 0.25f, 1.0f, 0.1f });
+	// (Shading gets reused from the previous frames, whenever the surface can be reprojected; every pixel gets retraced at least once per 16 frames)
+	computeVoxelizedRayTraced->setTemporalReuse({ 16, false });
+
+	// Same as above, but the traced pixels are highlighted (debug view for the temporal reuse):
+	std::shared_ptr<Test::ComputeRenderer> computeVoxelizedRayTracedDebug(new Test::ComputeRenderer(device, swapChain, computeVoxelizedRayTracedMesh, log));
+	if (!computeVoxelizedRayTracedDebug->initialized()) return 25;
+	computeVoxelizedRayTracedDebug->setDynamicResolution(computeVoxelizedRayTraced->dynamicResolution());
+	computeVoxelizedRayTracedDebug->setTemporalReuse({ 16, true });
+
 	// RenderLoop just makes sure, the image render commands are issued from correct renderers:
-	RenderLoop loop(swapChain, transform, rasterized, rayTraced, voxelizedRayTraced);
+	RenderLoop loop(swapChain, transform, rasterized, hybrid, rayTraced, voxelizedRayTraced, cachedShadowVoxelizedRayTraced, debugVoxelizedRayTraced, ddaVoxelizedRayTraced, computeVoxelizedRayTraced, computeVoxelizedRayTracedDebug, compactVoxelizedRayTraced, twoLevelVoxelizedRayTraced, gpuVoxelizedRayTraced, bvhRayTraced);
 	Test::Window::RenderLoopEventId eventId = window->addRenderLoopEvent(std::bind(&RenderLoop::renderLoopEvent, &loop, std::placeholders::_1));
 
 	// In case something fails, window is configured to closed automatically, so we have to wait here: